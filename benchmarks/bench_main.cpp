@@ -0,0 +1,15 @@
+#include <benchmark/benchmark.h>
+#include <spdlog/spdlog.h>
+
+int main(int argc, char** argv) {
+    // Migration and sql loading logs would otherwise dominate the output
+    spdlog::set_level(spdlog::level::off);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
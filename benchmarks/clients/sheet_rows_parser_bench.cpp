@@ -0,0 +1,63 @@
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "clients/sheet-rows-parser.hpp"
+
+using namespace bot;
+
+namespace {
+
+/// libcurl hands the body over in chunks of up to CURL_MAX_WRITE_SIZE
+constexpr size_t kCurlChunkSize = 16 * 1024;
+
+/// ValueRange body recorded from the Sheets API, ~500 rows of 7 columns
+const std::string& Payload() {
+    static const std::string payload = [] {
+        std::ifstream file(std::string(BENCH_DATA_DIR) + "/sheet_values.json");
+        if (!file) {
+            throw std::runtime_error("Missing benchmarks/data/sheet_values.json");
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        return buffer.str();
+    }();
+    return payload;
+}
+
+}    // namespace
+
+static void BM_SheetRowsParserChunked(benchmark::State& state) {
+    const std::string& payload = Payload();
+    for (auto _ : state) {
+        size_t rows = 0;
+        SheetRowsParser parser(kDefaultRowBatchSize,
+                               [&rows](std::vector<SheetRow>&& batch) {
+                                   rows += batch.size();
+                               });
+        for (size_t offset = 0; offset < payload.size(); offset += kCurlChunkSize) {
+            parser.Feed(std::string_view(payload).substr(offset, kCurlChunkSize));
+        }
+        parser.Finish();
+        benchmark::DoNotOptimize(rows);
+    }
+    state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BM_SheetRowsParserChunked);
+
+/// The DOM parse used for batchGet responses, as a reference point
+static void BM_SheetJsonDomParse(benchmark::State& state) {
+    const std::string& payload = Payload();
+    for (auto _ : state) {
+        nlohmann::json response = nlohmann::json::parse(payload);
+        benchmark::DoNotOptimize(response.at("values").size());
+    }
+    state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BM_SheetJsonDomParse);
@@ -0,0 +1,57 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <string_view>
+
+#include "commands/command_router.hpp"
+
+using namespace bot;
+
+namespace {
+
+struct BenchCommand {
+    int64_t calls = 0;
+
+    explicit BenchCommand(DiContainer&) {}
+};
+
+struct PingCommand : BenchCommand {
+    static constexpr std::string_view kName = "/ping";
+    using BenchCommand::BenchCommand;
+
+    void Handle(const CommandContext&) { ++calls; }
+};
+
+struct RoleCommand : BenchCommand {
+    static constexpr std::string_view kName = "/role";
+    using BenchCommand::BenchCommand;
+
+    void Handle(const CommandContext&, int64_t user_id, std::string_view role) {
+        calls += user_id + static_cast<int64_t>(role.size());
+    }
+};
+
+struct NoteCommand : BenchCommand {
+    static constexpr std::string_view kName = "/note";
+    using BenchCommand::BenchCommand;
+
+    void Handle(const CommandContext&, RestOfLine text) {
+        calls += static_cast<int64_t>(text.text.size());
+    }
+};
+
+using BenchRouter = CommandRouter<PingCommand, RoleCommand, NoteCommand>;
+
+}    // namespace
+
+// Parse, lookup and argument conversion for one typed command, no handler work
+static void BM_CommandRouterRoute(benchmark::State& state) {
+    DiContainer di;
+    BenchRouter router(di, "bench_bot");
+    TgBot::Message message;
+    message.text = "/role@bench_bot 42 admin";
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(router.Route(message));
+    }
+}
+BENCHMARK(BM_CommandRouterRoute);
@@ -0,0 +1,62 @@
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <format>
+#include <memory>
+
+#include "db/migration_manager.hpp"
+#include "db/queries_manager.hpp"
+#include "temp_sql_dir.hpp"
+
+using namespace bot;
+
+namespace {
+
+/// Project internal scripts plus `count` small migrations that each add a table
+std::shared_ptr<QueriesManager> MakeMigrations(const TempSqlDir& dir, int64_t count) {
+    dir.CopyInternalScripts();
+    for (int64_t i = 0; i < count; ++i) {
+        dir.Write(std::format("migrations/{:03}_table_{}.sql", i + 1, i),
+                  std::format("CREATE TABLE table_{} (id INTEGER PRIMARY KEY, "
+                              "value TEXT NOT NULL);\n"
+                              "CREATE INDEX table_{}_value ON table_{} (value);",
+                              i, i, i));
+    }
+    return std::make_shared<QueriesManager>(dir.Path());
+}
+
+std::shared_ptr<SQLite::Database> MakeDatabase() {
+    return std::make_shared<SQLite::Database>(":memory:", SQLite::OPEN_READWRITE |
+                                                              SQLite::OPEN_CREATE);
+}
+
+}    // namespace
+
+/// Fresh database: every migration is applied
+static void BM_MigrationApplyAll(benchmark::State& state) {
+    TempSqlDir dir("migration_bench");
+    auto queries = MakeMigrations(dir, state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto db = MakeDatabase();
+        state.ResumeTiming();
+
+        MigrationManager(db, queries, Config{}).Run();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MigrationApplyAll)->Arg(10)->Arg(100)->Arg(500);
+
+/// Up-to-date database: the startup cost of validating applied migrations
+static void BM_MigrationValidateApplied(benchmark::State& state) {
+    TempSqlDir dir("migration_bench");
+    auto queries = MakeMigrations(dir, state.range(0));
+    auto db = MakeDatabase();
+    MigrationManager(db, queries, Config{}).Run();
+
+    for (auto _ : state) {
+        MigrationManager(db, queries, Config{}).Run();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MigrationValidateApplied)->Arg(10)->Arg(100)->Arg(500);
@@ -0,0 +1,72 @@
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <format>
+#include <string>
+#include <vector>
+
+#include "db/queries_manager.hpp"
+#include "temp_sql_dir.hpp"
+
+using namespace bot;
+
+namespace {
+
+constexpr size_t kScriptsPerDir = 64;
+const std::vector<std::string> kDirs = {"dao", "internal", "migrations", "reports"};
+
+/// sql/ sized like a grown project: a few directories with a few dozen scripts each
+QueriesManager& Manager() {
+    static TempSqlDir dir("queries_manager_bench");
+    static QueriesManager manager = [] {
+        for (const auto& subdir : kDirs) {
+            for (size_t i = 0; i < kScriptsPerDir; ++i) {
+                dir.Write(std::format("{}/{:03}_script.sql", subdir, i),
+                          std::format("SELECT id, name FROM {} WHERE id = ?1; -- {}",
+                                      subdir, i));
+            }
+        }
+        return QueriesManager(dir.Path());
+    }();
+    return manager;
+}
+
+std::vector<std::string> ScriptPaths() {
+    std::vector<std::string> paths;
+    for (const auto& subdir : kDirs) {
+        for (size_t i = 0; i < kScriptsPerDir; ++i) {
+            paths.push_back(std::format("{}/{:03}_script.sql", subdir, i));
+        }
+    }
+    return paths;
+}
+
+}    // namespace
+
+static void BM_QueriesManagerGet(benchmark::State& state) {
+    QueriesManager& manager = Manager();
+    std::vector<std::string> paths = ScriptPaths();
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(manager.Get(paths[next++ % paths.size()]));
+    }
+}
+BENCHMARK(BM_QueriesManagerGet);
+
+static void BM_QueriesManagerGetView(benchmark::State& state) {
+    QueriesManager& manager = Manager();
+    std::vector<std::string> paths = ScriptPaths();
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(manager.GetView(paths[next++ % paths.size()]));
+    }
+}
+BENCHMARK(BM_QueriesManagerGetView);
+
+static void BM_QueriesManagerListSubdirFiles(benchmark::State& state) {
+    QueriesManager& manager = Manager();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(manager.ListSubdirFiles("migrations"));
+    }
+    state.SetItemsProcessed(state.iterations() * kScriptsPerDir);
+}
+BENCHMARK(BM_QueriesManagerListSubdirFiles);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace bot {
+
+/// Scratch sql/ tree under the temp directory, removed on destruction
+class TempSqlDir {
+private:
+    std::filesystem::path path_;
+
+public:
+    explicit TempSqlDir(const std::string& name)
+        : path_(std::filesystem::temp_directory_path() / name) {
+        std::filesystem::remove_all(path_);
+        std::filesystem::create_directories(path_);
+    }
+
+    ~TempSqlDir() { std::filesystem::remove_all(path_); }
+
+    TempSqlDir(const TempSqlDir&) = delete;
+    TempSqlDir& operator=(const TempSqlDir&) = delete;
+
+    void Write(const std::filesystem::path& relative, const std::string& content) const {
+        std::filesystem::create_directories((path_ / relative).parent_path());
+        std::ofstream(path_ / relative) << content;
+    }
+
+    /// Copies the project's sql/internal scripts, so migrations run the real queries
+    void CopyInternalScripts() const {
+        std::filesystem::copy(std::filesystem::path(BENCH_SQL_DIR) / "internal",
+                              path_ / "internal",
+                              std::filesystem::copy_options::recursive);
+    }
+
+    const std::filesystem::path& Path() const { return path_; }
+};
+
+}    // namespace bot
@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <thread>
+
+#include "di/di.hpp"
+
+using namespace bot;
+
+namespace {
+
+struct BenchService {
+    int value = 42;
+};
+
+struct OtherService {};
+
+}    // namespace
+
+static void BM_DiGetByType(benchmark::State& state) {
+    DiContainer ctx;
+    REGISTER(ctx, BenchService);
+    REGISTER(ctx, OtherService);
+    GET(ctx, BenchService);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(GET(ctx, BenchService));
+    }
+}
+// Contention only shows with real parallelism, so thread counts follow the cores
+BENCHMARK(BM_DiGetByType)
+    ->ThreadRange(1, static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+
+static void BM_DiGetByName(benchmark::State& state) {
+    DiContainer ctx;
+    ctx.Register<BenchService>("bench", [](DiContainer&) {
+        return std::make_shared<BenchService>();
+    });
+    ctx.Get<BenchService>("bench");
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ctx.Get<BenchService>("bench"));
+    }
+}
+BENCHMARK(BM_DiGetByName);
+
+static void BM_DiScopedDereference(benchmark::State& state) {
+    DiContainer ctx;
+    REGISTER(ctx, BenchService);
+    Scoped<BenchService> service = Scope<BenchService>(ctx);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(service->value);
+    }
+}
+BENCHMARK(BM_DiScopedDereference);
@@ -0,0 +1,17 @@
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+
+#include "env/env_manager.hpp"
+
+using namespace bot;
+
+static void BM_EnvManagerGet(benchmark::State& state) {
+    setenv("BOT_TOKEN", "bench-token", 0);
+    setenv("GOOGLE_SHEETS_API_KEY", "bench-key", 0);
+    EnvManager env;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(env.Get("UPDATE_QUEUE_CAPACITY"));
+    }
+}
+BENCHMARK(BM_EnvManagerGet);
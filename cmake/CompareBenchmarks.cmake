@@ -0,0 +1,199 @@
+# Compares two Google Benchmark JSON reports and fails when a benchmark in RESULT is
+# more than THRESHOLD percent slower than in BASELINE. The fastest repetition's
+# cpu_time is compared: noise only ever adds time, so the minimum is far steadier
+# than the mean or median. Reports holding aggregates only fall back to the median.
+#
+# Every benchmark present in both reports is gated. The summary warns about the ones
+# whose coefficient of variation exceeds MAX_CV percent in either report, and about
+# baseline benchmarks that did not run (e.g. thread counts above the machine's cores).
+#
+#   cmake -DBASELINE=<file.json> -DRESULT=<file.json> -DTHRESHOLD=<percent>
+#         [-DMAX_CV=<percent>] -P CompareBenchmarks.cmake
+
+cmake_minimum_required(VERSION 3.19)
+
+if(NOT DEFINED THRESHOLD)
+    set(THRESHOLD 10)
+endif()
+if(NOT DEFINED MAX_CV)
+    set(MAX_CV 5)
+endif()
+
+# CMake math is integer only, so values are scaled by 10^SHIFT and truncated. The
+# reporter prints doubles in scientific notation, e.g. 1.2345678901234567e+02.
+function(to_fixed VALUE SHIFT OUT)
+    if(NOT VALUE MATCHES "^([0-9]+)\\.?([0-9]*)[eE]?([+-]?[0-9]*)$")
+        message(FATAL_ERROR "Unexpected benchmark time: ${VALUE}")
+    endif()
+    set(DIGITS "${CMAKE_MATCH_1}${CMAKE_MATCH_2}")
+    string(LENGTH "${CMAKE_MATCH_1}" POINT)
+    set(EXPONENT "${CMAKE_MATCH_3}")
+    if(EXPONENT STREQUAL "")
+        set(EXPONENT 0)
+    endif()
+
+    math(EXPR POINT "${POINT} + ${EXPONENT} + ${SHIFT}")
+    if(POINT LESS_EQUAL 0)
+        set(${OUT} 0 PARENT_SCOPE)
+        return()
+    endif()
+    if(POINT GREATER 17)
+        message(FATAL_ERROR "Benchmark time out of range: ${VALUE} ${UNIT}")
+    endif()
+
+    string(LENGTH "${DIGITS}" LENGTH)
+    while(LENGTH LESS POINT)
+        string(APPEND DIGITS "0")
+        math(EXPR LENGTH "${LENGTH} + 1")
+    endwhile()
+    string(SUBSTRING "${DIGITS}" 0 ${POINT} DIGITS)
+    string(REGEX REPLACE "^0+([0-9])" "\\1" DIGITS "${DIGITS}")
+    set(${OUT} ${DIGITS} PARENT_SCOPE)
+endfunction()
+
+function(to_picoseconds VALUE UNIT OUT)
+    set(UNIT_SHIFT 3)
+    if(UNIT STREQUAL "us")
+        set(UNIT_SHIFT 6)
+    elseif(UNIT STREQUAL "ms")
+        set(UNIT_SHIFT 9)
+    elseif(UNIT STREQUAL "s")
+        set(UNIT_SHIFT 12)
+    endif()
+    to_fixed(${VALUE} ${UNIT_SHIFT} RESULT)
+    set(${OUT} ${RESULT} PARENT_SCOPE)
+endfunction()
+
+# Sets <PREFIX>_NAMES and <PREFIX>_<key> = cpu time in picoseconds, where key is the
+# benchmark name made a valid identifier ("BM_Get/threads:2" -> "BM_Get_threads_2").
+# Reports with aggregates also set <PREFIX>_<key>_CV = cv in tenths of a percent.
+function(load_report FILE PREFIX)
+    if(NOT EXISTS ${FILE})
+        message(FATAL_ERROR "Benchmark report ${FILE} does not exist")
+    endif()
+    file(READ ${FILE} JSON)
+    string(JSON COUNT LENGTH "${JSON}" benchmarks)
+    set(NAMES "")
+    if(COUNT EQUAL 0)
+        set(${PREFIX}_NAMES "" PARENT_SCOPE)
+        return()
+    endif()
+    math(EXPR LAST "${COUNT} - 1")
+
+    foreach(I RANGE ${LAST})
+        string(JSON RUN_TYPE GET "${JSON}" benchmarks ${I} run_type)
+        string(JSON NAME GET "${JSON}" benchmarks ${I} run_name)
+        string(JSON CPU_TIME GET "${JSON}" benchmarks ${I} cpu_time)
+        string(MAKE_C_IDENTIFIER "${NAME}" KEY)
+        if(NOT NAME IN_LIST NAMES)
+            list(APPEND NAMES ${NAME})
+        endif()
+
+        if(RUN_TYPE STREQUAL "aggregate")
+            string(JSON AGGREGATE GET "${JSON}" benchmarks ${I} aggregate_name)
+            if(AGGREGATE STREQUAL "cv")
+                to_fixed(${CPU_TIME} 3 PERMILLE)
+                set(${PREFIX}_${KEY}_CV ${PERMILLE} PARENT_SCOPE)
+                continue()
+            elseif(NOT AGGREGATE STREQUAL "median")
+                continue()
+            endif()
+        endif()
+
+        string(JSON UNIT GET "${JSON}" benchmarks ${I} time_unit)
+        to_picoseconds(${CPU_TIME} ${UNIT} PICOSECONDS)
+        if(RUN_TYPE STREQUAL "aggregate")
+            set(MEDIAN_${KEY} ${PICOSECONDS})
+        elseif(NOT DEFINED MIN_${KEY} OR PICOSECONDS LESS MIN_${KEY})
+            set(MIN_${KEY} ${PICOSECONDS})
+        endif()
+    endforeach()
+
+    foreach(NAME ${NAMES})
+        string(MAKE_C_IDENTIFIER "${NAME}" KEY)
+        if(DEFINED MIN_${KEY})
+            set(${PREFIX}_${KEY} ${MIN_${KEY}} PARENT_SCOPE)
+        else()
+            set(${PREFIX}_${KEY} ${MEDIAN_${KEY}} PARENT_SCOPE)
+        endif()
+    endforeach()
+    set(${PREFIX}_NAMES ${NAMES} PARENT_SCOPE)
+endfunction()
+
+load_report(${BASELINE} BASE)
+load_report(${RESULT} CURRENT)
+
+set(REGRESSIONS "")
+set(NOISY "")
+set(MISSING "")
+set(GATED 0)
+math(EXPR CV_LIMIT "${MAX_CV} * 10")
+math(EXPR LIMIT "${THRESHOLD} * 10")
+foreach(NAME ${CURRENT_NAMES})
+    string(MAKE_C_IDENTIFIER "${NAME}" KEY)
+    set(CURRENT_TIME ${CURRENT_${KEY}})
+    if(NOT DEFINED BASE_${KEY})
+        message(STATUS "${NAME}: new benchmark, no baseline")
+        continue()
+    endif()
+    set(BASE_TIME ${BASE_${KEY}})
+    if(BASE_TIME EQUAL 0)
+        set(BASE_TIME 1)
+    endif()
+
+    # Change in tenths of a percent, rounded towards zero
+    math(EXPR CHANGE "(${CURRENT_TIME} - ${BASE_TIME}) * 1000 / ${BASE_TIME}")
+    math(EXPR CHANGE_INT "${CHANGE} / 10")
+    math(EXPR CHANGE_FRAC "(${CHANGE} % 10 + 10) % 10")
+    if(CHANGE LESS 0 AND CHANGE_INT EQUAL 0)
+        set(CHANGE_INT "-0")
+    endif()
+    set(LINE "${NAME}: ${CHANGE_INT}.${CHANGE_FRAC}%")
+
+    foreach(CV IN ITEMS "${BASE_${KEY}_CV}" "${CURRENT_${KEY}_CV}")
+        if(NOT CV STREQUAL "" AND CV GREATER CV_LIMIT AND NOT NAME IN_LIST NOISY)
+            list(APPEND NOISY ${NAME})
+            string(APPEND LINE "  noisy")
+        endif()
+    endforeach()
+
+    math(EXPR GATED "${GATED} + 1")
+    if(CHANGE GREATER LIMIT)
+        list(APPEND REGRESSIONS "${LINE}")
+        message(STATUS "${LINE}  REGRESSION")
+    else()
+        message(STATUS "${LINE}")
+    endif()
+endforeach()
+
+foreach(NAME ${BASE_NAMES})
+    string(MAKE_C_IDENTIFIER "${NAME}" KEY)
+    if(NOT DEFINED CURRENT_${KEY})
+        list(APPEND MISSING ${NAME})
+        message(STATUS "${NAME}: missing from the current run")
+    endif()
+endforeach()
+
+message(STATUS "${GATED} benchmark(s) compared against the baseline")
+list(LENGTH NOISY NOISY_COUNT)
+if(NOISY_COUNT GREATER 0)
+    list(JOIN NOISY "\n  " REPORT)
+    message(WARNING "${NOISY_COUNT} benchmark(s) have a cv above ${MAX_CV}%, so even "
+                    "their minimum may be off. Re-record the baseline on a quieter "
+                    "machine:\n  ${REPORT}")
+endif()
+list(LENGTH MISSING MISSING_COUNT)
+if(MISSING_COUNT GREATER 0)
+    list(JOIN MISSING "\n  " REPORT)
+    message(WARNING "${MISSING_COUNT} baseline benchmark(s) did not run and were not "
+                    "checked:\n  ${REPORT}")
+endif()
+
+list(LENGTH REGRESSIONS REGRESSION_COUNT)
+if(REGRESSION_COUNT GREATER 0)
+    list(JOIN REGRESSIONS "\n  " REPORT)
+    message(FATAL_ERROR
+            "${REGRESSION_COUNT} benchmark(s) slower than baseline by more than "
+            "${THRESHOLD}%:\n  ${REPORT}")
+endif()
+message(STATUS "No benchmark regressed by more than ${THRESHOLD}%")
@@ -0,0 +1,71 @@
+# Generates a C++ source with every *.sql file under SQL_DIR embedded as a byte array
+# and indexed by a compile-time perfect hash.
+#
+#   cmake -DSQL_DIR=<dir> -DOUTPUT=<file.cpp> -DEMBED=ON|OFF -P EmbedSql.cmake
+
+if(EMBED)
+    file(GLOB_RECURSE SQL_FILES RELATIVE ${SQL_DIR} ${SQL_DIR}/*.sql)
+    list(SORT SQL_FILES)
+else()
+    set(SQL_FILES "")
+endif()
+
+list(LENGTH SQL_FILES SQL_COUNT)
+
+set(ARRAYS "")
+set(ENTRIES "")
+set(INDEX 0)
+foreach(SQL_FILE ${SQL_FILES})
+    file(READ ${SQL_DIR}/${SQL_FILE} HEX_CONTENT HEX)
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "'\\\\x\\1', " BYTES "${HEX_CONTENT}")
+    string(APPEND ARRAYS "constexpr char kScript${INDEX}[] = {${BYTES}'\\0'};\n")
+    string(APPEND ENTRIES
+           "    EmbeddedScript{\"${SQL_FILE}\", {kScript${INDEX}, sizeof(kScript${INDEX}) - 1}},\n")
+    math(EXPR INDEX "${INDEX} + 1")
+endforeach()
+
+set(CONTENT "// Generated by cmake/EmbedSql.cmake from sql/. Do not edit.
+#include \"db/embedded_sql.hpp\"
+#include \"utils/perfect_hash.hpp\"
+#include <array>
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <utility>
+
+namespace bot {
+
+namespace {
+
+${ARRAYS}
+constexpr std::array<EmbeddedScript, ${SQL_COUNT}> kScripts = {
+${ENTRIES}};
+
+constexpr auto MakeIndex() {
+    std::array<std::pair<std::string_view, std::string_view>, kScripts.size()> entries{};
+    for (size_t i = 0; i < kScripts.size(); ++i) {
+        entries[i] = {kScripts[i].path, kScripts[i].script};
+    }
+    return PerfectHashMap<std::string_view, kScripts.size()>(entries);
+}
+
+constexpr auto kIndex = MakeIndex();
+
+}    // namespace
+
+std::span<const EmbeddedScript> EmbeddedScripts() { return kScripts; }
+
+const std::string_view* FindEmbeddedScript(std::string_view path) {
+    return kIndex.Find(path);
+}
+
+}    // namespace bot
+")
+
+# Rewriting an identical file would rebuild the bot on every build
+if(EXISTS ${OUTPUT})
+    file(READ ${OUTPUT} OLD_CONTENT)
+endif()
+if(NOT "${OLD_CONTENT}" STREQUAL "${CONTENT}")
+    file(WRITE ${OUTPUT} "${CONTENT}")
+endif()
@@ -0,0 +1 @@
+DELETE FROM session_ WHERE expires_at <= ?1;
@@ -0,0 +1 @@
+DELETE FROM session_ WHERE chat_id = ?1;
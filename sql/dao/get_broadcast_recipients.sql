@@ -0,0 +1,4 @@
+SELECT id, tg_id, COALESCE(role, 'user') FROM user_
+WHERE id > ?1 AND tg_id IS NOT NULL
+ORDER BY id
+LIMIT ?2;
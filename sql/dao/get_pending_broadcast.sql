@@ -0,0 +1,4 @@
+SELECT id, message, last_user_id FROM broadcast_
+WHERE is_done = 0
+ORDER BY id
+LIMIT 1;
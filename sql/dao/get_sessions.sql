@@ -0,0 +1,4 @@
+SELECT chat_id, state, data, expires_at
+FROM session_
+WHERE expires_at > ?1
+ORDER BY expires_at;
@@ -0,0 +1,2 @@
+SELECT body, etag, fetched_at FROM sheet_cache_
+WHERE key = ?;
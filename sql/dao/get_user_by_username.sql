@@ -0,0 +1,2 @@
+SELECT id, username, role, tg_id FROM user_
+WHERE username = ?1;
@@ -0,0 +1,3 @@
+SELECT id, username, role, tg_id FROM user_
+ORDER BY id DESC
+LIMIT ?1;
@@ -0,0 +1,2 @@
+INSERT INTO broadcast_(message) VALUES(?)
+RETURNING id;
@@ -0,0 +1,2 @@
+UPDATE sheet_cache_ SET fetched_at = ?2
+WHERE key = ?1;
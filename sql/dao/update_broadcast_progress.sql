@@ -0,0 +1,3 @@
+UPDATE broadcast_
+SET last_user_id = ?2, sent = sent + ?3, failed = failed + ?4, is_done = ?5
+WHERE id = ?1;
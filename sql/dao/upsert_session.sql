@@ -0,0 +1,6 @@
+INSERT INTO session_(chat_id, state, data, expires_at)
+VALUES(?1, ?2, ?3, ?4)
+ON CONFLICT(chat_id) DO UPDATE SET
+    state = excluded.state,
+    data = excluded.data,
+    expires_at = excluded.expires_at;
@@ -0,0 +1,6 @@
+INSERT INTO sheet_cache_(key, body, etag, fetched_at)
+VALUES(?1, ?2, ?3, ?4)
+ON CONFLICT(key) DO UPDATE SET
+    body = excluded.body,
+    etag = excluded.etag,
+    fetched_at = excluded.fetched_at;
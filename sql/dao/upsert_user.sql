@@ -0,0 +1,6 @@
+INSERT INTO user_(username, email, role, tg_id)
+VALUES(?1, ?2, COALESCE(?3, 'user'), ?4)
+ON CONFLICT(username) DO UPDATE SET
+    email = COALESCE(?2, email),
+    role = COALESCE(?3, role),
+    tg_id = COALESCE(?4, tg_id);
@@ -1,2 +0,0 @@
-SELECT COUNT(*) FROM versions_
-WHERE version = ? AND name = ? AND hash = ?
@@ -0,0 +1,7 @@
+CREATE TABLE IF NOT EXISTS online_migrations_(
+    name TEXT PRIMARY KEY,
+    hash TEXT NOT NULL,
+    last_key INTEGER NOT NULL DEFAULT -9223372036854775808,
+    rows_done INTEGER NOT NULL DEFAULT 0,
+    is_done INTEGER NOT NULL DEFAULT 0
+);
@@ -0,0 +1 @@
+SELECT version, name, hash FROM versions_;
@@ -0,0 +1,2 @@
+SELECT hash, last_key, is_done FROM online_migrations_
+WHERE name = ?;
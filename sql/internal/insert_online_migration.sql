@@ -0,0 +1,2 @@
+INSERT OR IGNORE INTO online_migrations_(name, hash)
+VALUES(?1, ?2);
@@ -0,0 +1,2 @@
+UPDATE versions_ SET hash = ?1
+WHERE version = ?2 AND name = ?3;
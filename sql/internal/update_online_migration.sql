@@ -0,0 +1,3 @@
+UPDATE online_migrations_
+SET last_key = ?2, rows_done = rows_done + ?3, is_done = ?4
+WHERE name = ?1;
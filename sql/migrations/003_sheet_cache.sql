@@ -0,0 +1,6 @@
+CREATE TABLE sheet_cache_ (
+    key TEXT PRIMARY KEY,
+    body TEXT NOT NULL,
+    etag TEXT,
+    fetched_at INTEGER NOT NULL
+);
@@ -0,0 +1,8 @@
+CREATE TABLE session_ (
+    chat_id INTEGER PRIMARY KEY,
+    state TEXT NOT NULL,
+    data TEXT NOT NULL DEFAULT '',
+    expires_at INTEGER NOT NULL
+);
+
+CREATE INDEX session_expires_at_idx ON session_(expires_at);
@@ -0,0 +1 @@
+CREATE INDEX IF NOT EXISTS idx_users_tg_id ON user_(tg_id);
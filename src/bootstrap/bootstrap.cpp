@@ -1,60 +1,200 @@
 #include "bootstrap.hpp"
+#include "broadcast/broadcaster.hpp"
+#include "commands/basic_commands.hpp"
+#include "clients/cached-sheets-client.hpp"
+#include "clients/google-sheets-client.hpp"
+#include "db/connection_pool.hpp"
+#include "db/embedded_queries_manager.hpp"
 #include "db/migration_manager.hpp"
+#include "db/online_migration_runner.hpp"
 #include "db/queries_manager.hpp"
+#include "db/sql_dir_watcher.hpp"
+#include "db/user_cache.hpp"
+#include "db/user_write_behind.hpp"
 #include "di/di.hpp"
 #include "env/env_manager.hpp"
+#include "logging/logger.hpp"
+#include "metrics/metrics.hpp"
+#include "metrics/metrics_server.hpp"
+#include "session/session_store.hpp"
+#include "tg/send_scheduler.hpp"
+#include "tg/update_pipeline.hpp"
+#include "tg/update_source.hpp"
+#include "tg/webhook_server.hpp"
+#include "tracing/tracer.hpp"
 #include <SQLiteCpp/SQLiteCpp.h>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
 #include <memory>
-#include <spdlog/common.h>
-#include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <string>
 #include <tgbot/tgbot.h>
+#include <utility>
 
 namespace bot {
 
+namespace {
+
+void SkipUpdate(const TgBot::Update::Ptr& update) {
+    SPDLOG_DEBUG("No handler for update = {}", update->updateId);
+}
+
+void RouteUpdate(BotCommandRouter& router, const TgBot::Update::Ptr& update) {
+    if (!update->message) {
+        SkipUpdate(update);
+        return;
+    }
+    switch (router.Route(*update->message)) {
+    case RouteResult::kHandled:
+        return;
+    case RouteResult::kNotCommand:
+        SkipUpdate(update);
+        return;
+    case RouteResult::kUnknownCommand:
+        SPDLOG_DEBUG("Unknown command in update = {}", update->updateId);
+        return;
+    case RouteResult::kBadArguments:
+        SPDLOG_DEBUG("Bad command arguments in update = {}", update->updateId);
+        return;
+    }
+}
+
+std::filesystem::path GetSqlDir(IEnvManager& env) {
+    std::string sql_dir = env.Get("SQL_DIR");
+    return sql_dir.empty() ? "sql" : sql_dir;
+}
+
+}    // namespace
+
+void Bootstraper::AddStages() {
+    // Each stage registers its services and resolves the expensive ones, so the work
+    // happens inside the stage and overlaps with stages it does not depend on
+    // The logger is configured from env, so env checks still log to the default sink
+    stages_.Add("env", {}, [this] { StepTwoCheckAllTokens(); });
+    stages_.Add("logger", {"env"}, [this] { StepOneLoggerSetup(); });
+    stages_.Add("sql_scripts", {"logger"}, [this] { StepFiveLoadSqlScripts(); });
+    stages_.Add("tg_bot", {"logger"}, [this] { StepFourInitTgBot(); });
+    stages_.Add("database", {"sql_scripts"}, [this] { StepThreeInitDatabase(); });
+    stages_.Add("migrations", {"database"}, [this] { StepSixRunMigrations(); });
+    stages_.Add("send_scheduler", {"tg_bot"},
+                [this] { StepThirteenInitSendScheduler(); });
+    stages_.Add("dao", {"migrations"}, [this] { StepEightInitDaoLayer(); });
+    stages_.Add("sheets_client", {"migrations"}, [this] { StepNineInitSheetsClient(); });
+    stages_.Add("online_migrations", {"migrations", "dao"},
+                [this] { StepTenInitOnlineMigrations(); });
+    stages_.Add("broadcasts", {"migrations", "send_scheduler"},
+                [this] { StepFourteenInitBroadcasts(); });
+    stages_.Add("sessions", {"migrations"}, [this] { StepFifteenInitSessions(); });
+    stages_.Add("update_pipeline", {"tg_bot", "dao", "sessions", "send_scheduler"},
+                [this] { StepSevenInitUpdatePipeline(); });
+    stages_.Add("metrics", {"logger"}, [this] { StepElevenInitMetrics(); });
+    stages_.Add("tracing", {"metrics"}, [this] { StepTwelveInitTracing(); });
+}
+
 void Bootstraper::Bootstrap() {
-    StepOneLoggerSetup();
-    StepTwoCheckAllTokens();
-    StepThreeInitDatabase();
-    StepFourInitTgBot();
-    StepFiveLoadSqlScripts();
-    StepSixRunMigrations();
+    AddStages();
+    try {
+        stages_.Run();
+    } catch (...) {
+        ExportStartupReport();
+        throw;
+    }
+    ExportStartupReport();
     spdlog::info("Done");
 }
 
-void Bootstraper::StepOneLoggerSetup() {
+void Bootstraper::ExportStartupReport() {
+    spdlog::info("{}", stages_.Report());
 
-    auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+    std::string path;
+    try {
+        path = GET_ENV(ctx_, "BOOTSTRAP_REPORT_PATH");
+    } catch (const std::exception&) {
+        return;
+    }
+    if (path.empty()) {
+        return;
+    }
 
-    console_sink->set_pattern("[%H:%M:%S] [%^%L%$]   %v");
-    console_sink->set_color_mode(spdlog::color_mode::always);
+    std::ofstream report(path);
+    report << stages_.ReportJson() << '\n';
+    if (!report) {
+        spdlog::warn("Failed to write startup report to {}", path);
+    }
+}
 
-    auto logger = std::make_shared<spdlog::logger>("default_logger", console_sink);
+void Bootstraper::Run() {
+    GET(ctx_, OnlineMigrationRunner)->Start();
+    GET(ctx_, SendScheduler)->Start();
+    GET(ctx_, Broadcaster)->Start();
+    GET(ctx_, SessionStore)->Start();
+    if (GET_ENV(ctx_, "UPDATE_MODE") == "polling") {
+        GET(ctx_, UpdatePipeline)->Run();
+        return;
+    }
 
-    spdlog::set_default_logger(logger);
+    GET(ctx_, UpdatePipeline)->Start();
+    auto server = GET(ctx_, WebhookServer);
+    server->Start();
+    if (std::string url = GET_ENV(ctx_, "WEBHOOK_URL"); !url.empty()) {
+        GET(ctx_, TgBot::Bot)
+            ->getApi()
+            .setWebhook(url, nullptr, 40, nullptr, "", false,
+                        GET_ENV(ctx_, "WEBHOOK_SECRET"));
+        spdlog::info("Webhook set to {}", url);
+    }
+    server->Wait();
+}
 
-    spdlog::set_level(spdlog::level::trace);
+void Bootstraper::StepOneLoggerSetup() {
+    SetupLogger(MakeLogConfig(*GET(ctx_, IEnvManager)));
     spdlog::info("Bootstrap. Stage 1");
 }
 
 void Bootstraper::StepTwoCheckAllTokens() {
     spdlog::info("Bootstrap. Stage 2");
     REGISTER_I(ctx_, IEnvManager, EnvManager);
+    GET(ctx_, IEnvManager);
 }
 
 void Bootstraper::StepThreeInitDatabase() {
     spdlog::info("Bootstrap. Stage 3");
-    REGISTER(ctx_, SQLite::Database, GET_ENV(ctx_, "DB_PATH"), SQLite::OPEN_READWRITE);
+    REGISTER(ctx_, ConnectionPool, MakePoolConfig(*GET(ctx_, IEnvManager)),
+             GET(ctx_, IQueriesManager));
+    GET(ctx_, ConnectionPool);
 }
 
 void Bootstraper::StepFourInitTgBot() {
     spdlog::info("Bootstrap. Stage 4");
     REGISTER(ctx_, TgBot::Bot, GET_ENV(ctx_, "BOT_TOKEN"));
+    GET(ctx_, TgBot::Bot);
 }
 
 void Bootstraper::StepFiveLoadSqlScripts() {
     spdlog::info("Bootstrap. Stage 5");
-    REGISTER_I(ctx_, IQueriesManager, QueriesManager, GET_ENV(ctx_, "SQL_DIR"));
+    if (GET_ENV(ctx_, "SQL_DIR").empty() && HasEmbeddedScripts()) {
+        spdlog::info("Using sql scripts embedded into the binary");
+        REGISTER_I(ctx_, IQueriesManager, EmbeddedQueriesManager);
+        GET(ctx_, IQueriesManager);
+        return;
+    }
+
+    spdlog::info("Loading sql scripts from {}",
+                 GetSqlDir(*GET(ctx_, IEnvManager)).string());
+    REGISTER(ctx_, QueriesManager, GetSqlDir(*GET(ctx_, IEnvManager)));
+    ctx_.Register<IQueriesManager>([this](DiContainer&) {
+        return std::static_pointer_cast<IQueriesManager>(GET(ctx_, QueriesManager));
+    });
+    GET(ctx_, IQueriesManager);
+
+    if (GET_ENV(ctx_, "SQL_HOT_RELOAD") == "1") {
+        REGISTER(ctx_, SqlDirWatcher, GetSqlDir(*GET(ctx_, IEnvManager)),
+                 [queries = GET(ctx_, QueriesManager)] { queries->Reload(); });
+        GET(ctx_, SqlDirWatcher);
+    }
 }
 
 void Bootstraper::StepSixRunMigrations() {
@@ -62,4 +202,115 @@ void Bootstraper::StepSixRunMigrations() {
     ApplyMigrations(ctx_);
 }
 
+void Bootstraper::StepSevenInitUpdatePipeline() {
+    spdlog::info("Bootstrap. Stage 7");
+    REGISTER_I(ctx_, IUpdateSource, LongPollUpdateSource, GET(ctx_, TgBot::Bot));
+    // Commands resolve their services here, once, not per update
+    REGISTER(ctx_, BotCommandRouter, ctx_, GET_ENV(ctx_, "BOT_USERNAME"),
+             GET(ctx_, UserCache));
+    REGISTER(ctx_, UpdatePipeline, GET(ctx_, IUpdateSource),
+             [router = GET(ctx_, BotCommandRouter)](const TgBot::Update::Ptr& update) {
+                 RouteUpdate(*router, update);
+             },
+             PipelineConfig{std::stoul(GET_ENV(ctx_, "UPDATE_WORKERS")),
+                            std::stoul(GET_ENV(ctx_, "UPDATE_QUEUE_CAPACITY"))});
+
+    std::string mode = GET_ENV(ctx_, "UPDATE_MODE");
+    if (mode == "polling") {
+        return;
+    }
+    if (mode != "webhook") {
+        throw std::invalid_argument("Unknown UPDATE_MODE = " + mode);
+    }
+    // Submit blocks while the pipeline is full, which holds the HTTP response and
+    // makes Telegram slow down instead of dropping updates
+    REGISTER(ctx_, WebhookServer, MakeWebhookConfig(*GET(ctx_, IEnvManager)),
+             [pipeline = GET(ctx_, UpdatePipeline)](TgBot::Update::Ptr update) {
+                 return pipeline->Submit(std::move(update));
+             });
+    GET(ctx_, WebhookServer);
+}
+
+void Bootstraper::StepEightInitDaoLayer() {
+    spdlog::info("Bootstrap. Stage 8");
+    REGISTER(ctx_, UserCache, GET(ctx_, ConnectionPool),
+             MakeUserCacheConfig(*GET(ctx_, IEnvManager)));
+    REGISTER(ctx_, UserWriteBehind, GET(ctx_, ConnectionPool),
+             MakeWriteBehindConfig(*GET(ctx_, IEnvManager)),
+             [cache = GET(ctx_, UserCache)](const UserRecord& record) {
+                 cache->Invalidate(record);
+             });
+    GET(ctx_, UserCache)->WarmUp();
+}
+
+void Bootstraper::StepNineInitSheetsClient() {
+    spdlog::info("Bootstrap. Stage 9");
+    REGISTER_I(ctx_, IGoogleSheetsClient, CachedSheetsClient,
+               std::make_shared<GoogleSheetsClient>(
+                   GET_ENV(ctx_, "GOOGLE_SHEETS_API_KEY"),
+                   GET_ENV(ctx_, "GOOGLE_SHEETS_BASE_URL"),
+                   std::stoul(GET_ENV(ctx_, "GOOGLE_SHEETS_CONCURRENCY"))),
+               GET(ctx_, ConnectionPool), MakeSheetsCacheConfig(*GET(ctx_, IEnvManager)));
+    GET(ctx_, IGoogleSheetsClient);
+}
+
+void Bootstraper::StepTenInitOnlineMigrations() {
+    spdlog::info("Bootstrap. Stage 10");
+    REGISTER(ctx_, OnlineMigrationRunner, GET(ctx_, ConnectionPool),
+             GET(ctx_, IQueriesManager),
+             MakeOnlineMigrationConfig(*GET(ctx_, IEnvManager)),
+             // Chunks may change any user_ row, e.g. backfilling roles
+             [cache = GET(ctx_, UserCache)](const std::string&) {
+                 cache->InvalidateAll();
+             });
+}
+
+void Bootstraper::StepElevenInitMetrics() {
+    spdlog::info("Bootstrap. Stage 11");
+    auto port = static_cast<uint16_t>(std::stoul(GET_ENV(ctx_, "METRICS_PORT")));
+    if (port == 0) {
+        spdlog::info("Metrics endpoint is disabled");
+        return;
+    }
+    REGISTER(ctx_, MetricsServer, Metrics(), GET_ENV(ctx_, "METRICS_ADDRESS"), port);
+    GET(ctx_, MetricsServer);
+}
+
+void Bootstraper::StepTwelveInitTracing() {
+    spdlog::info("Bootstrap. Stage 12");
+    Tracing().Configure(MakeTracerConfig(*GET(ctx_, IEnvManager)));
+    if (std::stoul(GET_ENV(ctx_, "METRICS_PORT")) == 0) {
+        return;
+    }
+
+    // Spans are exported on demand, e.g. curl 127.0.0.1:9464/debug/trace > trace.json
+    auto server = GET(ctx_, MetricsServer);
+    server->AddRoute("/debug/trace", "application/json",
+                     [] { return Tracing().ExportChromeJson(); });
+    server->AddRoute("/debug/trace/otlp", "application/json",
+                     [] { return Tracing().ExportOtlpJson(); });
+}
+
+void Bootstraper::StepThirteenInitSendScheduler() {
+    spdlog::info("Bootstrap. Stage 13");
+    // Replies go through the scheduler instead of getApi(), so bursts are paced to
+    // the Bot API flood limits rather than answered with 429s
+    REGISTER_I(ctx_, ISendTransport, TgApiSendTransport, GET(ctx_, TgBot::Bot));
+    REGISTER(ctx_, SendScheduler, GET(ctx_, ISendTransport),
+             MakeSendSchedulerConfig(*GET(ctx_, IEnvManager)));
+}
+
+void Bootstraper::StepFourteenInitBroadcasts() {
+    spdlog::info("Bootstrap. Stage 14");
+    REGISTER(ctx_, Broadcaster, GET(ctx_, ConnectionPool), GET(ctx_, SendScheduler),
+             MakeBroadcastConfig(*GET(ctx_, IEnvManager)));
+}
+
+void Bootstraper::StepFifteenInitSessions() {
+    spdlog::info("Bootstrap. Stage 15");
+    REGISTER(ctx_, SessionStore, GET(ctx_, ConnectionPool),
+             MakeSessionStoreConfig(*GET(ctx_, IEnvManager)));
+    GET(ctx_, SessionStore)->Restore();
+}
+
 }    // namespace bot
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "bootstrap/stage_graph.hpp"
 #include "di/di.hpp"
 #include <SQLiteCpp/Database.h>
 #include <tgbot/Bot.h>
@@ -9,9 +10,13 @@ namespace bot {
 class Bootstraper {
 private:
     DiContainer ctx_;
+    StageGraph stages_;
 
 public:
+    /// Declares the startup stages without running them, Bootstrap calls it
+    void AddStages();
     void Bootstrap();
+    void Run();
 
 private:
     void StepOneLoggerSetup();
@@ -20,9 +25,17 @@ private:
     void StepFourInitTgBot();
     void StepFiveLoadSqlScripts();
     void StepSixRunMigrations();
-    // void StepFiveInitSheetsViewer();
-    // void Step
-    // void StepSevenInitDaoLayer();
+    void StepSevenInitUpdatePipeline();
+    void StepEightInitDaoLayer();
+    void StepNineInitSheetsClient();
+    void StepTenInitOnlineMigrations();
+    void StepElevenInitMetrics();
+    void StepTwelveInitTracing();
+    void StepThirteenInitSendScheduler();
+    void StepFourteenInitBroadcasts();
+    void StepFifteenInitSessions();
+
+    void ExportStartupReport();
 };
 
 }    // namespace bot
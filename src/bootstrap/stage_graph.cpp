@@ -0,0 +1,152 @@
+#include "stage_graph.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <format>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace bot {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::chrono::milliseconds ToMillis(Clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(duration);
+}
+
+}    // namespace
+
+void StageGraph::Add(std::string name, std::vector<std::string> dependencies,
+                     std::function<void()> action) {
+    auto has_stage = [this](const std::string& stage_name) {
+        return std::ranges::any_of(
+            stages_, [&](const Stage& stage) { return stage.name == stage_name; });
+    };
+
+    if (has_stage(name)) {
+        throw std::invalid_argument("Stage (" + name + ") already exists");
+    }
+    for (const auto& dependency : dependencies) {
+        if (!has_stage(dependency)) {
+            throw std::invalid_argument("Stage (" + name + ") depends on unknown " +
+                                        "stage (" + dependency + ")");
+        }
+    }
+    stages_.push_back({std::move(name), std::move(dependencies), std::move(action)});
+}
+
+void StageGraph::Run() {
+    size_t count = stages_.size();
+    std::vector<size_t> pending(count);
+    std::vector<std::vector<size_t>> dependents(count);
+    std::deque<size_t> ready;
+
+    for (size_t i = 0; i < count; ++i) {
+        for (const auto& dependency : stages_[i].dependencies) {
+            auto it = std::ranges::find(stages_, dependency, &Stage::name);
+            dependents[it - stages_.begin()].push_back(i);
+        }
+        pending[i] = stages_[i].dependencies.size();
+        if (pending[i] == 0) {
+            ready.push_back(i);
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable finished_cv;
+    size_t running = 0;
+    std::exception_ptr error;
+    std::vector<StageTiming> timings;
+    Clock::time_point start = Clock::now();
+
+    std::vector<std::jthread> threads;
+    threads.reserve(count);
+
+    std::unique_lock lock(mutex);
+    while (true) {
+        while (!ready.empty() && !error) {
+            size_t index = ready.front();
+            ready.pop_front();
+            ++running;
+
+            threads.emplace_back([&, index] {
+                Clock::time_point stage_start = Clock::now();
+                std::exception_ptr stage_error;
+                try {
+                    stages_[index].action();
+                } catch (...) {
+                    stage_error = std::current_exception();
+                }
+                Clock::time_point stage_end = Clock::now();
+
+                std::lock_guard stage_lock(mutex);
+                timings.push_back({stages_[index].name, ToMillis(stage_start - start),
+                                   ToMillis(stage_end - stage_start), !!stage_error});
+                if (stage_error) {
+                    if (!error) {
+                        error = stage_error;
+                    }
+                } else {
+                    for (size_t dependent : dependents[index]) {
+                        if (--pending[dependent] == 0) {
+                            ready.push_back(dependent);
+                        }
+                    }
+                }
+                --running;
+                finished_cv.notify_one();
+            });
+        }
+
+        if (running == 0) {
+            break;
+        }
+        finished_cv.wait(lock);
+    }
+    lock.unlock();
+    threads.clear();
+
+    std::ranges::sort(timings, {}, &StageTiming::started_at);
+    timings_ = std::move(timings);
+    total_ = ToMillis(Clock::now() - start);
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+const std::vector<StageTiming>& StageGraph::Timings() const { return timings_; }
+
+std::chrono::milliseconds StageGraph::Total() const { return total_; }
+
+std::string StageGraph::Report() const {
+    std::string report = std::format("Startup took {} ms", total_.count());
+    for (const auto& timing : timings_) {
+        report += std::format("\n  {:<32} +{:>6} ms {:>6} ms{}", timing.name,
+                              timing.started_at.count(), timing.duration.count(),
+                              timing.is_failed ? "  FAILED" : "");
+    }
+    return report;
+}
+
+std::string StageGraph::ReportJson() const {
+    nlohmann::json stages = nlohmann::json::array();
+    for (const auto& timing : timings_) {
+        stages.push_back({{"name", timing.name},
+                          {"started_at_ms", timing.started_at.count()},
+                          {"duration_ms", timing.duration.count()},
+                          {"failed", timing.is_failed}});
+    }
+    return nlohmann::json{{"total_ms", total_.count()}, {"stages", stages}}.dump(4);
+}
+
+}    // namespace bot
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bot {
+
+struct StageTiming {
+    std::string name;
+    std::chrono::milliseconds started_at{0};    ///< Offset from the graph start
+    std::chrono::milliseconds duration{0};
+    bool is_failed = false;
+};
+
+/// Set of named stages with declared dependencies. Run starts every stage as soon as
+/// all of its dependencies finished, so independent stages overlap.
+class StageGraph final {
+private:
+    struct Stage {
+        std::string name;
+        std::vector<std::string> dependencies;
+        std::function<void()> action;
+    };
+
+    std::vector<Stage> stages_;
+    std::vector<StageTiming> timings_;
+    std::chrono::milliseconds total_{0};
+
+public:
+    /// Dependencies must be added before the stage that names them
+    void Add(std::string name, std::vector<std::string> dependencies,
+             std::function<void()> action);
+
+    /// Blocks until every stage finished. When a stage throws, stages that depend on
+    /// it are skipped, running ones are awaited and the first error is rethrown
+    void Run();
+
+    /// Timings in start order, filled by Run
+    const std::vector<StageTiming>& Timings() const;
+    std::chrono::milliseconds Total() const;
+
+    /// Human readable table with one line per stage
+    std::string Report() const;
+    std::string ReportJson() const;
+};
+
+}    // namespace bot
@@ -0,0 +1,338 @@
+#include "broadcaster.hpp"
+#include "logging/log_limiter.hpp"
+#include "metrics/metrics.hpp"
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <string_view>
+
+namespace bot {
+
+namespace {
+
+constexpr std::chrono::milliseconds kStopPollInterval{100};
+
+constexpr std::string_view kRolePlaceholder = "{role}";
+
+struct BroadcastMetrics {
+    Counter& sent = Metrics().GetCounter("broadcast_messages_sent_total",
+                                         "Broadcast messages accepted by the Bot API");
+    Counter& failed = Metrics().GetCounter("broadcast_messages_failed_total",
+                                           "Broadcast messages the Bot API rejected");
+    Gauge& last_user_id = Metrics().GetGauge("broadcast_last_user_id",
+                                             "Cursor of the running broadcast");
+};
+
+BroadcastMetrics& GetBroadcastMetrics() {
+    static BroadcastMetrics metrics;
+    return metrics;
+}
+
+std::string ToJson(const BroadcastMessage& message) {
+    return nlohmann::json{{"text", message.text}, {"role_texts", message.role_texts}}
+        .dump();
+}
+
+BroadcastMessage FromJson(const std::string& json) {
+    nlohmann::json parsed = nlohmann::json::parse(json);
+    BroadcastMessage message;
+    message.text = parsed.at("text").get<std::string>();
+    message.role_texts = parsed.value("role_texts", std::map<std::string, std::string>{});
+    return message;
+}
+
+}    // namespace
+
+std::string RenderBroadcast(const BroadcastMessage& message, const std::string& role) {
+    auto it = message.role_texts.find(role);
+    const std::string& text = it == message.role_texts.end() ? message.text : it->second;
+
+    std::string rendered;
+    rendered.reserve(text.size());
+    size_t position = 0;
+    while (true) {
+        size_t found = text.find(kRolePlaceholder, position);
+        rendered.append(text, position, found - position);
+        if (found == std::string::npos) {
+            return rendered;
+        }
+        rendered += role;
+        position = found + kRolePlaceholder.size();
+    }
+}
+
+BroadcastConfig MakeBroadcastConfig(IEnvManager& env) {
+    BroadcastConfig config;
+    config.page_size = std::stoul(env.Get("BROADCAST_PAGE_SIZE"));
+    return config;
+}
+
+Broadcaster::Broadcaster(const std::shared_ptr<ConnectionPool>& pool,
+                         const std::shared_ptr<SendScheduler>& scheduler,
+                         const BroadcastConfig& config)
+    : pool_(pool), scheduler_(scheduler), config_(config) {
+    if (config_.page_size == 0) {
+        throw std::invalid_argument("Broadcast page size must be positive");
+    }
+}
+
+Broadcaster::~Broadcaster() { Stop(); }
+
+void Broadcaster::Start() {
+    worker_ = std::jthread([this](std::stop_token stop) { WorkerLoop(stop); });
+}
+
+void Broadcaster::Stop() {
+    if (worker_.joinable()) {
+        worker_.request_stop();
+        worker_.join();
+    }
+    std::lock_guard lock(mutex_);
+    is_idle_ = true;
+    cv_.notify_all();
+}
+
+int64_t Broadcaster::Create(const BroadcastMessage& message) {
+    int64_t id = 0;
+    {
+        ConnectionLease writer = pool_->AcquireWriter();
+        auto insert = writer.Statements()->Acquire(config_.insert_broadcast);
+        insert->bind(1, ToJson(message));
+        insert->executeStep();
+        id = insert->getColumn(0).getInt64();
+        insert->reset();
+    }
+    spdlog::info("Created broadcast = {}", id);
+
+    std::lock_guard lock(mutex_);
+    has_new_ = true;
+    is_idle_ = false;
+    cv_.notify_all();
+    return id;
+}
+
+void Broadcaster::WaitIdle() {
+    std::unique_lock lock(mutex_);
+    if (!worker_.joinable()) {
+        return;
+    }
+    cv_.wait(lock, [this] { return is_idle_; });
+}
+
+BroadcastStats Broadcaster::Stats() const {
+    std::lock_guard lock(mutex_);
+    return stats_;
+}
+
+void Broadcaster::WorkerLoop(std::stop_token stop) {
+    while (!stop.stop_requested()) {
+        {
+            std::lock_guard lock(mutex_);
+            has_new_ = false;
+        }
+
+        // Cancelled sends are not a reason to give up on the broadcast: it is still
+        // pending and is not idle, so it is run again like a failed one
+        bool is_retried = false;
+        try {
+            RunResult result = RunResult::kDone;
+            while (!stop.stop_requested() && result == RunResult::kDone) {
+                result = RunNext(stop);
+            }
+            is_retried = result == RunResult::kInterrupted;
+        } catch (const std::exception& ex) {
+            spdlog::error("Broadcast stopped. Error = {}", ex.what());
+            is_retried = true;
+        }
+
+        std::unique_lock lock(mutex_);
+        if (is_retried) {
+            cv_.wait_for(lock, stop, config_.retry_delay, [this] { return has_new_; });
+            continue;
+        }
+        if (!has_new_) {
+            is_idle_ = true;
+            cv_.notify_all();
+        }
+        cv_.wait(lock, stop, [this] { return has_new_; });
+    }
+}
+
+Broadcaster::RunResult Broadcaster::RunNext(std::stop_token stop) {
+    int64_t id = 0;
+    int64_t cursor = 0;
+    BroadcastMessage message;
+    {
+        ConnectionLease reader = pool_->AcquireReader();
+        auto select = reader.Statements()->Acquire(config_.get_pending_broadcast);
+        if (!select->executeStep()) {
+            return RunResult::kNothingPending;
+        }
+        id = select->getColumn(0).getInt64();
+        message = FromJson(select->getColumn(1).getString());
+        cursor = select->getColumn(2).getInt64();
+        select->reset();
+    }
+    spdlog::info("Run broadcast = {} after user = {}", id, cursor);
+
+    // Roles are few, so every template is rendered once per run, not once per user
+    std::unordered_map<std::string, std::string> rendered;
+    // The next page is queued while the previous one is being sent, so the scheduler
+    // never runs dry between pages
+    std::deque<Page> in_flight;
+    bool is_exhausted = false;
+    bool is_interrupted = false;
+
+    while (!is_exhausted && !stop.stop_requested()) {
+        Page page = SendPage(cursor, message, rendered);
+        is_exhausted = page.sends.size() < config_.page_size;
+        if (page.sends.empty()) {
+            break;
+        }
+        cursor = page.last_user_id;
+        in_flight.push_back(std::move(page));
+
+        if (in_flight.size() > 1) {
+            if (!Checkpoint(id, in_flight.front(), stop)) {
+                is_interrupted = true;
+                break;
+            }
+            in_flight.pop_front();
+        }
+    }
+
+    while (!in_flight.empty() && !is_interrupted) {
+        is_interrupted = !Checkpoint(id, in_flight.front(), stop);
+        in_flight.pop_front();
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        stats_.renders += rendered.size();
+    }
+
+    if (!is_exhausted || is_interrupted) {
+        spdlog::info("Broadcast = {} interrupted", id);
+        return RunResult::kInterrupted;
+    }
+
+    UpdateProgress(id, cursor, 0, 0, true);
+    std::lock_guard lock(mutex_);
+    ++stats_.broadcasts_done;
+    spdlog::info("Broadcast = {} done", id);
+    return RunResult::kDone;
+}
+
+Broadcaster::Page
+Broadcaster::SendPage(int64_t after_user_id, const BroadcastMessage& message,
+                      std::unordered_map<std::string, std::string>& rendered) {
+    struct Recipient {
+        int64_t user_id;
+        int64_t tg_id;
+        std::string role;
+    };
+
+    std::vector<Recipient> recipients;
+    recipients.reserve(config_.page_size);
+    {
+        ConnectionLease reader = pool_->AcquireReader();
+        auto select = reader.Statements()->Acquire(config_.get_recipients);
+        select->bind(1, after_user_id);
+        select->bind(2, static_cast<int64_t>(config_.page_size));
+        while (select->executeStep()) {
+            recipients.push_back({select->getColumn(0).getInt64(),
+                                  select->getColumn(1).getInt64(),
+                                  select->getColumn(2).getString()});
+        }
+        select->reset();
+    }
+
+    Page page;
+    page.last_user_id = after_user_id;
+    page.sends.reserve(recipients.size());
+    for (auto& recipient : recipients) {
+        auto [it, is_new_role] = rendered.try_emplace(recipient.role);
+        if (is_new_role) {
+            it->second = RenderBroadcast(message, recipient.role);
+        }
+
+        OutgoingMessage outgoing;
+        outgoing.chat_id = recipient.tg_id;
+        outgoing.text = it->second;
+        page.sends.emplace_back(recipient.user_id,
+                                scheduler_->Enqueue(std::move(outgoing),
+                                                    SendPriority::kBulk));
+        page.last_user_id = recipient.user_id;
+    }
+    return page;
+}
+
+bool Broadcaster::Checkpoint(int64_t broadcast_id, Page& page, std::stop_token stop) {
+    uint64_t sent = 0;
+    uint64_t failed = 0;
+    std::optional<int64_t> undelivered;
+    int64_t last_user_id = page.last_user_id;
+
+    for (auto& [user_id, future] : page.sends) {
+        if (undelivered) {
+            break;
+        }
+        // On Stop the page is not awaited, the rest of it is sent again on resume
+        while (future.wait_for(kStopPollInterval) != std::future_status::ready) {
+            if (stop.stop_requested()) {
+                undelivered = user_id;
+                break;
+            }
+        }
+        if (undelivered) {
+            break;
+        }
+
+        try {
+            future.get();
+            ++sent;
+        } catch (const SendCancelledError&) {
+            undelivered = user_id;
+        } catch (const std::exception& ex) {
+            // Mostly users who blocked the bot, they are not retried
+            LOG_RATE_LIMITED(spdlog::level::warn, 1, "Broadcast to user = {} failed: {}",
+                             user_id, ex.what());
+            ++failed;
+        }
+    }
+
+    if (undelivered) {
+        last_user_id = *undelivered - 1;
+    }
+
+    UpdateProgress(broadcast_id, last_user_id, sent, failed, false);
+    GetBroadcastMetrics().sent.Add(sent);
+    GetBroadcastMetrics().failed.Add(failed);
+    GetBroadcastMetrics().last_user_id.Set(last_user_id);
+
+    std::lock_guard lock(mutex_);
+    ++stats_.pages;
+    stats_.sent += sent;
+    stats_.failed += failed;
+    return !undelivered;
+}
+
+void Broadcaster::UpdateProgress(int64_t broadcast_id, int64_t last_user_id,
+                                 uint64_t sent, uint64_t failed, bool is_done) {
+    ConnectionLease writer = pool_->AcquireWriter();
+    auto update = writer.Statements()->Acquire(config_.update_progress);
+    update->bind(1, broadcast_id);
+    update->bind(2, last_user_id);
+    update->bind(3, static_cast<int64_t>(sent));
+    update->bind(4, static_cast<int64_t>(failed));
+    update->bind(5, is_done ? 1 : 0);
+    update->exec();
+    update->reset();
+}
+
+}    // namespace bot
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "db/connection_pool.hpp"
+#include "env/env_manager.hpp"
+#include "tg/send_scheduler.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace bot {
+
+struct BroadcastMessage {
+    std::string text;    ///< "{role}" is replaced with the role of the recipient
+    std::map<std::string, std::string> role_texts;    ///< Replaces text for a role
+};
+
+/// Text a recipient with the role receives
+std::string RenderBroadcast(const BroadcastMessage& message, const std::string& role);
+
+struct BroadcastConfig {
+    size_t page_size = 500;
+    /// Pause before a broadcast that failed or had sends cancelled is run again
+    std::chrono::milliseconds retry_delay = std::chrono::seconds(5);
+    std::string insert_broadcast = "dao/insert_broadcast.sql";
+    std::string get_pending_broadcast = "dao/get_pending_broadcast.sql";
+    std::string get_recipients = "dao/get_broadcast_recipients.sql";
+    std::string update_progress = "dao/update_broadcast_progress.sql";
+};
+
+BroadcastConfig MakeBroadcastConfig(IEnvManager& env);
+
+struct BroadcastStats {
+    uint64_t broadcasts_done = 0;
+    uint64_t pages = 0;
+    uint64_t sent = 0;
+    uint64_t failed = 0;
+    uint64_t renders = 0;    ///< Templates rendered, one per role and broadcast run
+};
+
+/// Sends a message to every user_ with a tg_id. Recipients are read in pages by a
+/// keyset cursor on id and handed to the SendScheduler as bulk messages, at most two
+/// pages at a time, so memory does not grow with the number of users. After a page is
+/// delivered its last id is stored in broadcast_, and an interrupted broadcast resumes
+/// after it. Delivery is at least once: the unconfirmed part of a page in flight
+/// during Stop or a crash is sent again.
+class Broadcaster final {
+private:
+    enum class RunResult {
+        kDone,
+        kNothingPending,
+        kInterrupted,    ///< By Stop or by cancelled sends; the broadcast stays pending
+    };
+
+    struct Page {
+        std::vector<std::pair<int64_t, std::future<int32_t>>> sends;    ///< By user id
+        int64_t last_user_id = 0;
+    };
+
+    std::shared_ptr<ConnectionPool> pool_;
+    std::shared_ptr<SendScheduler> scheduler_;
+    BroadcastConfig config_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable_any cv_;
+    BroadcastStats stats_;
+    bool has_new_ = true;    ///< Broadcasts may be waiting from a previous run
+    bool is_idle_ = false;
+    std::jthread worker_;
+
+public:
+    Broadcaster(const std::shared_ptr<ConnectionPool>& pool,
+                const std::shared_ptr<SendScheduler>& scheduler,
+                const BroadcastConfig& config = {});
+    ~Broadcaster();
+
+    Broadcaster(const Broadcaster&) = delete;
+    Broadcaster& operator=(const Broadcaster&) = delete;
+
+    /// Resumes unfinished broadcasts, then runs new ones in creation order
+    void Start();
+
+    /// Stores the progress of the pages delivered so far
+    void Stop();
+
+    /// Stores the broadcast and returns its id. It is sent once the running ones finish.
+    int64_t Create(const BroadcastMessage& message);
+
+    /// Blocks until every created broadcast finished or the broadcaster was stopped
+    void WaitIdle();
+
+    BroadcastStats Stats() const;
+
+private:
+    void WorkerLoop(std::stop_token stop);
+
+    RunResult RunNext(std::stop_token stop);
+
+    Page SendPage(int64_t after_user_id, const BroadcastMessage& message,
+                  std::unordered_map<std::string, std::string>& rendered);
+
+    /// Waits for the page and stores its progress. Returns false when the page was
+    /// not fully delivered because of Stop or a cancelled send; the cursor then stops
+    /// before the first undelivered user.
+    bool Checkpoint(int64_t broadcast_id, Page& page, std::stop_token stop);
+
+    void UpdateProgress(int64_t broadcast_id, int64_t last_user_id, uint64_t sent,
+                        uint64_t failed, bool is_done);
+};
+
+}    // namespace bot
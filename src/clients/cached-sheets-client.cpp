@@ -0,0 +1,328 @@
+#include "cached-sheets-client.hpp"
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <chrono>
+#include <exception>
+#include <format>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bot {
+
+std::string GetCacheKey(const RequestParams& params) {
+    return std::format("{}/{}!{}:{}", params.sheet_id, params.list_name,
+                       params.first_idx, params.last_idx);
+}
+
+SheetsCacheConfig MakeSheetsCacheConfig(IEnvManager& env) {
+    SheetsCacheConfig config;
+    config.ttl = std::chrono::seconds(std::stoll(env.Get("SHEETS_CACHE_TTL_SEC")));
+    config.stale_ttl =
+        std::chrono::seconds(std::stoll(env.Get("SHEETS_CACHE_STALE_SEC")));
+    return config;
+}
+
+CachedSheetsClient::CachedSheetsClient(const std::shared_ptr<IGoogleSheetsClient>& client,
+                                       const std::shared_ptr<ConnectionPool>& pool,
+                                       const SheetsCacheConfig& config)
+    : client_(client), pool_(pool), config_(config),
+      refresher_(&CachedSheetsClient::RefresherLoop, this) {}
+
+CachedSheetsClient::~CachedSheetsClient() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    refresh_cv_.notify_one();
+    refresher_.join();
+}
+
+std::string CachedSheetsClient::Pull(const RequestParams& params) const {
+    std::string key = GetCacheKey(params);
+    if (auto body = Lookup(params, key)) {
+        return std::move(*body);
+    }
+
+    std::promise<std::string> leader;
+    if (auto load = JoinLoad(key, leader)) {
+        return load->get();
+    }
+    try {
+        std::string body = Refresh(params, key);
+        FinishLoad(key, leader, nullptr, body);
+        return body;
+    } catch (...) {
+        FinishLoad(key, leader, std::current_exception());
+        throw;
+    }
+}
+
+std::vector<std::string>
+CachedSheetsClient::PullBatch(const std::vector<RequestParams>& params) const {
+    std::vector<std::string> results(params.size());
+    std::vector<RequestParams> missing;
+    std::vector<size_t> missing_positions;
+    std::vector<std::promise<std::string>> leaders;
+    std::vector<std::pair<size_t, std::shared_future<std::string>>> joined;
+
+    for (size_t i = 0; i < params.size(); ++i) {
+        std::string key = GetCacheKey(params[i]);
+        if (auto body = Lookup(params[i], key)) {
+            results[i] = std::move(*body);
+            continue;
+        }
+        std::promise<std::string> leader;
+        if (auto load = JoinLoad(key, leader)) {
+            joined.emplace_back(i, std::move(*load));
+            continue;
+        }
+        missing.push_back(params[i]);
+        missing_positions.push_back(i);
+        leaders.push_back(std::move(leader));
+    }
+
+    if (!missing.empty()) {
+        std::vector<std::string> fetched;
+        try {
+            fetched = client_->PullBatch(missing);
+        } catch (...) {
+            for (size_t i = 0; i < missing.size(); ++i) {
+                FinishLoad(GetCacheKey(missing[i]), leaders[i], std::current_exception());
+            }
+            throw;
+        }
+        for (size_t i = 0; i < missing.size(); ++i) {
+            std::string key = GetCacheKey(missing[i]);
+            Store(key, fetched[i], "");
+            FinishLoad(key, leaders[i], nullptr, fetched[i]);
+            results[missing_positions[i]] = std::move(fetched[i]);
+        }
+    }
+
+    // Waited last: the ranges this call leads are already published
+    for (auto& [position, load] : joined) {
+        results[position] = load.get();
+    }
+    return results;
+}
+
+void CachedSheetsClient::PullRows(const RequestParams& params, size_t batch_size,
+                                  const RowBatchSink& sink) const {
+    client_->PullRows(params, batch_size, sink);
+}
+
+ConditionalPull CachedSheetsClient::PullIfChanged(const RequestParams& params,
+                                                  const std::string& etag) const {
+    return client_->PullIfChanged(params, etag);
+}
+
+SheetsCacheStats CachedSheetsClient::Stats(const RequestParams& params) const {
+    std::lock_guard lock(mutex_);
+    auto it = entries_.find(GetCacheKey(params));
+    return it == entries_.end() ? SheetsCacheStats{} : it->second.stats;
+}
+
+SheetsCacheStats CachedSheetsClient::TotalStats() const {
+    std::lock_guard lock(mutex_);
+    SheetsCacheStats total;
+    for (const auto& [key, entry] : entries_) {
+        total.hits += entry.stats.hits;
+        total.stale_hits += entry.stats.stale_hits;
+        total.misses += entry.stats.misses;
+        total.coalesced_misses += entry.stats.coalesced_misses;
+        total.refreshes += entry.stats.refreshes;
+        total.unchanged_refreshes += entry.stats.unchanged_refreshes;
+    }
+    return total;
+}
+
+std::optional<std::string> CachedSheetsClient::Lookup(const RequestParams& params,
+                                                      const std::string& key) const {
+    std::unique_lock lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        lock.unlock();
+        std::optional<Entry> stored = Load(key);
+        lock.lock();
+        it = entries_.try_emplace(key, stored.value_or(Entry{})).first;
+    }
+
+    Entry& entry = it->second;
+    auto age = Clock::now() - entry.fetched_at;
+
+    if (!entry.body.empty() && age < config_.ttl) {
+        ++entry.stats.hits;
+        return entry.body;
+    }
+
+    if (!entry.body.empty() && age < config_.ttl + config_.stale_ttl) {
+        ++entry.stats.stale_hits;
+        if (!entry.is_refreshing) {
+            entry.is_refreshing = true;
+            refresh_queue_.push_back(params);
+            refresh_cv_.notify_one();
+        }
+        return entry.body;
+    }
+
+    ++entry.stats.misses;
+    return std::nullopt;
+}
+
+std::string CachedSheetsClient::Refresh(const RequestParams& params,
+                                        const std::string& key) const {
+    std::string etag;
+    {
+        std::lock_guard lock(mutex_);
+        etag = entries_[key].etag;
+    }
+
+    ConditionalPull result = client_->PullIfChanged(params, etag);
+    if (result.is_modified) {
+        Store(key, result.body, result.etag);
+        return result.body;
+    }
+
+    Entry snapshot;
+    {
+        std::lock_guard lock(mutex_);
+        Entry& entry = entries_[key];
+        entry.fetched_at = Clock::now();
+        entry.is_refreshing = false;
+        ++entry.stats.refreshes;
+        ++entry.stats.unchanged_refreshes;
+        snapshot = entry;
+    }
+    Persist(key, snapshot, false);
+    return snapshot.body;
+}
+
+std::optional<std::shared_future<std::string>>
+CachedSheetsClient::JoinLoad(const std::string& key,
+                             std::promise<std::string>& leader) const {
+    std::lock_guard lock(mutex_);
+    auto [it, inserted] = loading_.try_emplace(key);
+    if (!inserted) {
+        ++entries_[key].stats.coalesced_misses;
+        return it->second;
+    }
+    it->second = leader.get_future().share();
+    return std::nullopt;
+}
+
+void CachedSheetsClient::FinishLoad(const std::string& key,
+                                    std::promise<std::string>& leader,
+                                    std::exception_ptr error,
+                                    const std::string& body) const {
+    {
+        // Later misses find the stored entry instead of this load
+        std::lock_guard lock(mutex_);
+        loading_.erase(key);
+    }
+    if (error) {
+        leader.set_exception(error);
+    } else {
+        leader.set_value(body);
+    }
+}
+
+void CachedSheetsClient::Store(const std::string& key, std::string body,
+                               std::string etag) const {
+    Entry snapshot;
+    bool is_body_changed = false;
+    {
+        std::lock_guard lock(mutex_);
+        Entry& entry = entries_[key];
+        is_body_changed = entry.body != body || entry.etag != etag;
+        entry.body = std::move(body);
+        entry.etag = std::move(etag);
+        entry.fetched_at = Clock::now();
+        entry.is_refreshing = false;
+        ++entry.stats.refreshes;
+        if (!is_body_changed) {
+            ++entry.stats.unchanged_refreshes;
+        }
+        snapshot = entry;
+    }
+    Persist(key, snapshot, is_body_changed);
+}
+
+std::optional<CachedSheetsClient::Entry>
+CachedSheetsClient::Load(const std::string& key) const {
+    try {
+        ConnectionLease reader = pool_->AcquireReader();
+        auto select = reader.Statements()->Acquire(config_.get_entry);
+        select->bind(1, key);
+        if (!select->executeStep()) {
+            return std::nullopt;
+        }
+
+        Entry entry;
+        entry.body = select->getColumn(0).getString();
+        entry.etag = select->getColumn(1).getString();
+        entry.fetched_at =
+            Clock::time_point(std::chrono::seconds(select->getColumn(2).getInt64()));
+        select->reset();
+        return entry;
+    } catch (std::exception& ex) {
+        spdlog::warn("Failed to load cached range = {}. Error = {}", key, ex.what());
+        return std::nullopt;
+    }
+}
+
+void CachedSheetsClient::Persist(const std::string& key, const Entry& entry,
+                                 bool is_body_changed) const {
+    int64_t fetched_at = std::chrono::duration_cast<std::chrono::seconds>(
+                             entry.fetched_at.time_since_epoch())
+                             .count();
+    try {
+        ConnectionLease writer = pool_->AcquireWriter();
+        if (is_body_changed) {
+            auto upsert = writer.Statements()->Acquire(config_.upsert_entry);
+            upsert->bind(1, key);
+            upsert->bind(2, entry.body);
+            upsert->bind(3, entry.etag);
+            upsert->bind(4, fetched_at);
+            upsert->exec();
+        } else {
+            auto touch = writer.Statements()->Acquire(config_.touch_entry);
+            touch->bind(1, key);
+            touch->bind(2, fetched_at);
+            touch->exec();
+        }
+    } catch (std::exception& ex) {
+        spdlog::warn("Failed to persist cached range = {}. Error = {}", key, ex.what());
+    }
+}
+
+void CachedSheetsClient::RefresherLoop() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+        refresh_cv_.wait(lock, [this] { return stopping_ || !refresh_queue_.empty(); });
+        if (stopping_) {
+            return;
+        }
+
+        RequestParams params = std::move(refresh_queue_.front());
+        refresh_queue_.pop_front();
+        std::string key = GetCacheKey(params);
+
+        lock.unlock();
+        try {
+            Refresh(params, key);
+        } catch (std::exception& ex) {
+            spdlog::warn("Failed to refresh cached range = {}. Error = {}", key,
+                         ex.what());
+            std::lock_guard error_lock(mutex_);
+            entries_[key].is_refreshing = false;
+        }
+        lock.lock();
+    }
+}
+
+}    // namespace bot
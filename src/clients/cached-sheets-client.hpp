@@ -0,0 +1,115 @@
+#pragma once
+
+#include "clients/google-sheets-client.hpp"
+#include "db/connection_pool.hpp"
+#include "env/env_manager.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace bot {
+
+struct SheetsCacheConfig {
+    std::chrono::seconds ttl{300};    ///< Younger entries are served without a request
+    /// Entries up to ttl + stale_ttl old are served at once and refreshed in background
+    std::chrono::seconds stale_ttl{3600};
+    std::string get_entry = "dao/get_sheet_cache.sql";
+    std::string upsert_entry = "dao/upsert_sheet_cache.sql";
+    std::string touch_entry = "dao/touch_sheet_cache.sql";
+};
+
+SheetsCacheConfig MakeSheetsCacheConfig(IEnvManager& env);
+
+struct SheetsCacheStats {
+    uint64_t hits = 0;
+    uint64_t stale_hits = 0;
+    uint64_t misses = 0;
+    uint64_t coalesced_misses = 0;    ///< Misses that waited for another caller's fetch
+    uint64_t refreshes = 0;
+    uint64_t unchanged_refreshes = 0;
+};
+
+/// Read-through cache in front of IGoogleSheetsClient. Ranges live in memory and in
+/// the sheet_cache_ table, so a restart does not refetch everything. Refreshes send the
+/// stored ETag; when the API gives none, an unchanged body is detected by comparison
+/// and only the timestamp is written back. Concurrent misses of one range share a
+/// single request.
+class CachedSheetsClient final : public IGoogleSheetsClient {
+private:
+    using Clock = std::chrono::system_clock;
+
+    struct Entry {
+        std::string body;
+        std::string etag;
+        Clock::time_point fetched_at;
+        bool is_refreshing = false;
+        SheetsCacheStats stats;
+    };
+
+    std::shared_ptr<IGoogleSheetsClient> client_;
+    std::shared_ptr<ConnectionPool> pool_;
+    SheetsCacheConfig config_;
+
+    mutable std::mutex mutex_;
+    mutable std::unordered_map<std::string, Entry> entries_;
+    /// Misses being fetched; concurrent misses of the same range wait for that fetch
+    mutable std::unordered_map<std::string, std::shared_future<std::string>> loading_;
+
+    mutable std::deque<RequestParams> refresh_queue_;
+    mutable std::condition_variable refresh_cv_;
+    bool stopping_ = false;
+    std::thread refresher_;
+
+public:
+    CachedSheetsClient(const std::shared_ptr<IGoogleSheetsClient>& client,
+                       const std::shared_ptr<ConnectionPool>& pool,
+                       const SheetsCacheConfig& config = {});
+    ~CachedSheetsClient();
+
+    std::string Pull(const RequestParams& params) const override;
+
+    /// Cached ranges are answered locally; the rest go out in one batch
+    std::vector<std::string>
+    PullBatch(const std::vector<RequestParams>& params) const override;
+
+    /// Streaming reads bypass the cache
+    void PullRows(const RequestParams& params, size_t batch_size,
+                  const RowBatchSink& sink) const override;
+
+    ConditionalPull PullIfChanged(const RequestParams& params,
+                                  const std::string& etag) const override;
+
+    SheetsCacheStats Stats(const RequestParams& params) const;
+    SheetsCacheStats TotalStats() const;
+
+private:
+    std::optional<std::string> Lookup(const RequestParams& params,
+                                      const std::string& key) const;
+    std::string Refresh(const RequestParams& params, const std::string& key) const;
+    /// Returns the fetch of the range in flight. Otherwise registers `leader` for the
+    /// range and returns nullopt; the caller fetches it and calls FinishLoad.
+    std::optional<std::shared_future<std::string>>
+    JoinLoad(const std::string& key, std::promise<std::string>& leader) const;
+    void FinishLoad(const std::string& key, std::promise<std::string>& leader,
+                    std::exception_ptr error, const std::string& body = {}) const;
+    void Store(const std::string& key, std::string body, std::string etag) const;
+
+    std::optional<Entry> Load(const std::string& key) const;
+    void Persist(const std::string& key, const Entry& entry, bool is_body_changed) const;
+
+    void RefresherLoop();
+};
+
+std::string GetCacheKey(const RequestParams& params);
+
+}    // namespace bot
@@ -0,0 +1,182 @@
+#include "curl-handle-pool.hpp"
+#include <curl/curl.h>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace bot {
+
+namespace {
+
+constexpr int kPollTimeoutMs = 1000;
+
+}    // namespace
+
+CurlLease::~CurlLease() {
+    if (pool_) {
+        pool_->Return(handle_);
+    }
+}
+
+CurlLease::CurlLease(CurlLease&& other) noexcept
+    : pool_(std::exchange(other.pool_, nullptr)),
+      handle_(std::exchange(other.handle_, nullptr)) {}
+
+CurlHandlePool::CurlHandlePool() {
+    static std::once_flag global_init;
+    std::call_once(global_init, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+
+    share_ = curl_share_init();
+    if (!share_) {
+        throw std::runtime_error("Failed to create CURL share handle");
+    }
+
+    curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, Lock);
+    curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, Unlock);
+    curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+    multi_ = curl_multi_init();
+    if (!multi_) {
+        curl_share_cleanup(share_);
+        throw std::runtime_error("Failed to create CURL multi handle");
+    }
+    curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+    worker_ = std::jthread([this](std::stop_token stop) { Loop(std::move(stop)); });
+}
+
+CurlHandlePool::~CurlHandlePool() {
+    worker_.request_stop();
+    curl_multi_wakeup(multi_);
+    worker_.join();
+
+    for (CURL* handle : idle_) {
+        curl_easy_cleanup(handle);
+    }
+    curl_multi_cleanup(multi_);
+    curl_share_cleanup(share_);
+}
+
+CurlLease CurlHandlePool::Acquire() {
+    CURL* handle = nullptr;
+    {
+        std::lock_guard lock(mutex_);
+        if (!idle_.empty()) {
+            handle = idle_.back();
+            idle_.pop_back();
+        }
+    }
+
+    if (!handle) {
+        handle = curl_easy_init();
+        if (!handle) {
+            throw std::runtime_error("Failed to create CURL handle");
+        }
+    }
+
+    SetDefaults(handle);
+    return CurlLease(this, handle);
+}
+
+void CurlHandlePool::Start(const CurlLease& lease, CurlDoneCallback on_done) {
+    {
+        std::lock_guard lock(mutex_);
+        starting_.emplace_back(lease.get(), std::move(on_done));
+    }
+    curl_multi_wakeup(multi_);
+}
+
+CURLcode CurlHandlePool::Perform(const CurlLease& lease) {
+    std::promise<CURLcode> done;
+    std::future<CURLcode> result = done.get_future();
+    Start(lease, [&done](CURLcode code) { done.set_value(code); });
+    return result.get();
+}
+
+void CurlHandlePool::Resume(const CurlLease& lease) {
+    {
+        std::lock_guard lock(mutex_);
+        resuming_.push_back(lease.get());
+    }
+    curl_multi_wakeup(multi_);
+}
+
+void CurlHandlePool::Return(CURL* handle) {
+    // Reset drops per-request options; connections live in the multi handle
+    curl_easy_reset(handle);
+
+    std::lock_guard lock(mutex_);
+    idle_.push_back(handle);
+}
+
+void CurlHandlePool::SetDefaults(CURL* handle) {
+    curl_easy_setopt(handle, CURLOPT_SHARE, share_);
+    curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+}
+
+void CurlHandlePool::Loop(std::stop_token stop) {
+    while (!stop.stop_requested()) {
+        std::vector<CURL*> resuming;
+        {
+            std::lock_guard lock(mutex_);
+            for (auto& [handle, on_done] : starting_) {
+                curl_multi_add_handle(multi_, handle);
+                running_.emplace(handle, std::move(on_done));
+            }
+            starting_.clear();
+            resuming.swap(resuming_);
+        }
+        // A transfer may have timed out while paused, its handle is not ours then
+        for (CURL* handle : resuming) {
+            if (running_.contains(handle)) {
+                curl_easy_pause(handle, CURLPAUSE_CONT);
+            }
+        }
+
+        int running = 0;
+        curl_multi_perform(multi_, &running);
+
+        int queued = 0;
+        while (CURLMsg* message = curl_multi_info_read(multi_, &queued)) {
+            if (message->msg != CURLMSG_DONE) {
+                continue;
+            }
+            CURL* handle = message->easy_handle;
+            CURLcode result = message->data.result;
+            curl_multi_remove_handle(multi_, handle);
+            auto node = running_.extract(handle);
+            node.mapped()(result);
+        }
+
+        curl_multi_poll(multi_, nullptr, 0, kPollTimeoutMs, nullptr);
+    }
+
+    // Nobody may wait forever on a transfer the pool will not run
+    std::lock_guard lock(mutex_);
+    for (auto& [handle, on_done] : running_) {
+        curl_multi_remove_handle(multi_, handle);
+        on_done(CURLE_ABORTED_BY_CALLBACK);
+    }
+    running_.clear();
+    for (auto& [handle, on_done] : starting_) {
+        on_done(CURLE_ABORTED_BY_CALLBACK);
+    }
+    starting_.clear();
+}
+
+void CurlHandlePool::Lock(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+    static_cast<CurlHandlePool*>(userptr)->share_locks_[data].lock();
+}
+
+void CurlHandlePool::Unlock(CURL*, curl_lock_data data, void* userptr) {
+    static_cast<CurlHandlePool*>(userptr)->share_locks_[data].unlock();
+}
+
+}    // namespace bot
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <curl/curl.h>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace bot {
+
+class CurlHandlePool;
+
+/// Borrowed easy handle. Goes back to the pool when the lease is destroyed.
+class CurlLease final {
+private:
+    CurlHandlePool* pool_;
+    CURL* handle_;
+
+public:
+    CurlLease(CurlHandlePool* pool, CURL* handle) : pool_(pool), handle_(handle) {}
+    ~CurlLease();
+
+    CurlLease(CurlLease&& other) noexcept;
+    CurlLease& operator=(CurlLease&& other) = delete;
+    CurlLease(const CurlLease&) = delete;
+    CurlLease& operator=(const CurlLease&) = delete;
+
+    CURL* get() const { return handle_; }
+};
+
+/// Called with the transfer result on the pool's transfer thread
+using CurlDoneCallback = std::function<void(CURLcode)>;
+
+/// Reusable easy handles driven by one multi handle on a background thread. The multi
+/// handle owns the connection cache, so concurrent requests to the same host share one
+/// HTTP/2 connection as multiplexed streams (handles wait for it instead of opening a
+/// new one), and sequential requests skip the TCP and TLS handshakes. DNS and TLS
+/// sessions are shared as well.
+class CurlHandlePool final {
+private:
+    friend class CurlLease;
+
+    CURLSH* share_;
+    std::array<std::mutex, CURL_LOCK_DATA_LAST> share_locks_;
+    CURLM* multi_;
+
+    std::mutex mutex_;
+    std::vector<CURL*> idle_;
+    std::vector<std::pair<CURL*, CurlDoneCallback>> starting_;
+    std::vector<CURL*> resuming_;
+
+    std::unordered_map<CURL*, CurlDoneCallback> running_;    ///< Transfer thread only
+    std::jthread worker_;
+
+public:
+    CurlHandlePool();
+    ~CurlHandlePool();
+
+    CurlHandlePool(const CurlHandlePool&) = delete;
+    CurlHandlePool& operator=(const CurlHandlePool&) = delete;
+
+    CurlLease Acquire();
+
+    /// Adds the configured handle to the multi handle. Its callbacks and on_done run
+    /// on the transfer thread, so they must be short; the lease must outlive on_done.
+    void Start(const CurlLease& lease, CurlDoneCallback on_done);
+
+    /// Start and wait
+    CURLcode Perform(const CurlLease& lease);
+
+    /// Unpauses a transfer whose write callback returned CURL_WRITEFUNC_PAUSE. libcurl
+    /// only allows that on the thread driving the multi handle, so it happens there.
+    void Resume(const CurlLease& lease);
+
+private:
+    void Return(CURL* handle);
+    void SetDefaults(CURL* handle);
+    void Loop(std::stop_token stop);
+
+    static void Lock(CURL* handle, curl_lock_data data, curl_lock_access access,
+                     void* userptr);
+    static void Unlock(CURL* handle, curl_lock_data data, void* userptr);
+};
+
+}    // namespace bot
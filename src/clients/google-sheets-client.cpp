@@ -1,13 +1,85 @@
 #include "google-sheets-client.hpp"
+#include "logging/log_limiter.hpp"
+#include "metrics/metrics.hpp"
+#include "tracing/tracer.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
 #include <curl/curl.h>
 #include <curl/urlapi.h>
+#include <deque>
+#include <exception>
 #include <format>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
 #include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace bot {
 
+namespace {
+
+struct SheetsMetrics {
+    Histogram& duration = Metrics().GetHistogram(
+        "sheets_request_duration_seconds", "Google Sheets API request latency");
+    Counter& response_bytes = Metrics().GetCounter(
+        "sheets_response_bytes_total", "Bytes received from Google Sheets API");
+    Histogram& buffered_bytes =
+        Metrics().GetHistogram("sheets_buffered_bytes",
+                               "Response bytes buffered for the sink at a time", {}, 1);
+    Counter& pauses = Metrics().GetCounter(
+        "sheets_transfer_pauses_total", "Transfers paused because the sink lagged");
+    Counter& success = Responses("200");
+    Counter& not_modified = Responses("304");
+    /// Requests that got no HTTP response, e.g. network errors and aborted transfers
+    Counter& failure = Responses("error");
+
+    /// Other codes are rare, so they are looked up in the registry when they happen
+    static Counter& Responses(const std::string& code) {
+        return Metrics().GetCounter("sheets_responses_total",
+                                    "Google Sheets API responses by HTTP code",
+                                    {{"code", code}});
+    }
+};
+
+SheetsMetrics& GetSheetsMetrics() {
+    static SheetsMetrics metrics;
+    return metrics;
+}
+
+/// Sheet names may hold spaces and other characters that are not valid in a URL
+std::string EscapeRange(const std::string& range) {
+    std::unique_ptr<char, void (*)(void*)> escaped(
+        curl_easy_escape(nullptr, range.c_str(), static_cast<int>(range.size())),
+        curl_free);
+    return escaped.get();
+}
+
+}    // namespace
+
+GoogleSheetsClient::Transfer::~Transfer() {
+    Cancel();
+    std::unique_lock lock(mutex);
+    cv.wait(lock, [this] { return is_done; });
+}
+
+void GoogleSheetsClient::Transfer::Cancel() {
+    is_cancelled = true;
+    std::unique_lock lock(mutex);
+    if (std::exchange(is_paused, false)) {
+        lock.unlock();
+        pool.Resume(curl);
+    }
+}
+
 std::string GoogleSheetsClient::Pull(const RequestParams& params) const {
+    Span span("sheets.pull");
     std::string range = GetRange(params);
 
     std::string url = GetUrl(params, range);
@@ -17,53 +89,237 @@ std::string GoogleSheetsClient::Pull(const RequestParams& params) const {
     return Perform(url);
 }
 
-std::string GoogleSheetsClient::Perform(const std::string& url) {
+std::vector<std::string>
+GoogleSheetsClient::PullBatch(const std::vector<RequestParams>& params) const {
+    std::vector<SheetBatch> batches;
+    std::unordered_map<std::string, size_t> batch_by_sheet;
+    for (size_t i = 0; i < params.size(); ++i) {
+        auto [it, inserted] =
+            batch_by_sheet.try_emplace(params[i].sheet_id, batches.size());
+        if (inserted) {
+            batches.push_back(SheetBatch{params[i].sheet_id, {}});
+        }
+        batches[it->second].positions.push_back(i);
+    }
+
+    // Every spreadsheet is one transfer on the pool's multi handle, at most
+    // max_concurrency in flight; responses are read in request order meanwhile
+    Span span("sheets.pull_batch");
+    std::vector<std::string> results(params.size());
+    std::deque<std::unique_ptr<Transfer>> in_flight;
+    size_t started = 0;
+
+    for (size_t i = 0; i < batches.size(); ++i) {
+        for (; started < batches.size() && started < i + max_concurrency_; ++started) {
+            std::string url = GetBatchUrl(params, batches[started]);
+            LogUrl(url);
+            in_flight.push_back(Start(url));
+        }
+
+        std::unique_ptr<Transfer> transfer = std::move(in_flight.front());
+        in_flight.pop_front();
+        std::string body;
+        Finish(*transfer, [&body](std::string_view chunk) { body.append(chunk); });
+        UnpackBatch(batches[i], std::move(body), results);
+    }
+    return results;
+}
+
+void GoogleSheetsClient::UnpackBatch(const SheetBatch& batch, std::string body,
+                                     std::vector<std::string>& results) const {
+    if (batch.positions.size() == 1) {
+        results[batch.positions.front()] = std::move(body);
+        return;
+    }
+
+    nlohmann::json response = nlohmann::json::parse(body);
+    const auto& value_ranges = response.at("valueRanges");
+    if (value_ranges.size() != batch.positions.size()) {
+        throw std::runtime_error("Google Sheets API returned wrong amount of ranges");
+    }
+
+    for (size_t i = 0; i < batch.positions.size(); ++i) {
+        results[batch.positions[i]] = value_ranges[i].dump();
+    }
+}
+
+void GoogleSheetsClient::PullRows(const RequestParams& params, size_t batch_size,
+                                  const RowBatchSink& sink) const {
+    std::string url = GetUrl(params, GetRange(params));
+
+    LogUrl(url);
+
+    SheetRowsParser parser(batch_size, sink);
+    Perform(url, [&parser](std::string_view chunk) { parser.Feed(chunk); });
+    parser.Finish();
+}
+
+ConditionalPull GoogleSheetsClient::PullIfChanged(const RequestParams& params,
+                                                  const std::string& etag) const {
+    std::string url = GetUrl(params, GetRange(params));
+
+    LogUrl(url);
+
+    ConditionalPull result;
+    auto new_etag = Perform(
+        url, [&result](std::string_view chunk) { result.body.append(chunk); }, etag);
+
+    result.is_modified = new_etag.has_value();
+    result.etag = new_etag.value_or(etag);
+    return result;
+}
 
-    std::unique_ptr<CURL, void (*)(CURL*)> curl(curl_easy_init(), curl_easy_cleanup);
-    CURLcode res;
+std::string GoogleSheetsClient::Perform(const std::string& url) const {
     std::string buffer;
+    Perform(url, [&buffer](std::string_view chunk) { buffer.append(chunk); });
+    return buffer;
+}
 
-    if (curl) {
-        curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &buffer);
-        curl_easy_setopt(curl.get(), CURLOPT_TIMEOUT, kDefaultTimeout);
-        curl_easy_setopt(curl.get(), CURLOPT_CONNECTTIMEOUT, kDefaultTimeout);
-        curl_easy_setopt(curl.get(), CURLOPT_NOSIGNAL, 1L);
+std::optional<std::string>
+GoogleSheetsClient::Perform(const std::string& url, const ChunkSink& sink,
+                            const std::string& if_none_match) const {
+    std::unique_ptr<Transfer> transfer = Start(url, if_none_match);
+    return Finish(*transfer, sink, if_none_match);
+}
 
-        res = curl_easy_perform(curl.get());
+std::unique_ptr<GoogleSheetsClient::Transfer>
+GoogleSheetsClient::Start(const std::string& url,
+                          const std::string& if_none_match) const {
+    auto transfer = std::make_unique<Transfer>(*curl_pool_, curl_pool_->Acquire());
+    CURL* curl = transfer->curl.get();
 
-        if (res != CURLE_OK) {
-            spdlog::error("CURL transport error: {}", curl_easy_strerror(res));
-            throw std::runtime_error("Network error while calling Google API");
-        }
+    if (!if_none_match.empty()) {
+        std::string header = "If-None-Match: " + if_none_match;
+        transfer->headers.reset(curl_slist_append(nullptr, header.c_str()));
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, transfer->headers.get());
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, transfer.get());
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, transfer.get());
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, ProgressCallback);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, transfer.get());
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, kDefaultTimeout);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, kDefaultTimeout);
 
-        long http_code = 0;
-        curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &http_code);
+    transfer->started_at = std::chrono::steady_clock::now();
+    transfer->is_done = false;
+    curl_pool_->Start(transfer->curl, [raw = transfer.get()](CURLcode result) {
+        // Notify under the lock: the waiter may destroy the transfer once it sees it
+        std::lock_guard lock(raw->mutex);
+        raw->result = result;
+        raw->is_done = true;
+        raw->cv.notify_all();
+    });
+    return transfer;
+}
 
-        if (http_code != 200) {
-            spdlog::warn("Google API returned error code {}. Body: \n{}", http_code,
-                         buffer);
-            throw std::runtime_error("Google Sheets API logical error");
+std::optional<std::string>
+GoogleSheetsClient::Finish(Transfer& transfer, const ChunkSink& sink,
+                           const std::string& if_none_match) const {
+    SheetsMetrics& metrics = GetSheetsMetrics();
+    std::exception_ptr error;
+
+    std::unique_lock lock(transfer.mutex);
+    while (true) {
+        transfer.cv.wait(
+            lock, [&transfer] { return transfer.is_done || !transfer.pending.empty(); });
+        std::string chunk = std::exchange(transfer.pending, {});
+        bool is_done = transfer.is_done;
+        bool is_paused = std::exchange(transfer.is_paused, false);
+        lock.unlock();
+        if (is_paused) {
+            curl_pool_->Resume(transfer.curl);
+        }
+        if (!chunk.empty() && !error) {
+            metrics.buffered_bytes.Record(chunk.size());
+            try {
+                sink(chunk);
+            } catch (...) {
+                error = std::current_exception();
+                transfer.Cancel();
+            }
+        }
+        lock.lock();
+        if (is_done && transfer.pending.empty()) {
+            break;
         }
     }
-    return buffer;
+    CURLcode res = transfer.result;
+    lock.unlock();
+
+    auto duration = std::chrono::steady_clock::now() - transfer.started_at;
+    metrics.duration.Record(duration);
+    long http_code = 0;
+    curl_easy_getinfo(transfer.curl.get(), CURLINFO_RESPONSE_CODE, &http_code);
+    if (CurrentTraceContext().IsSampled()) {
+        RecordFinishedSpan("sheets.request", duration,
+                           std::format("http_code = {}", http_code));
+    }
+
+    if (error) {
+        metrics.failure.Add();
+        std::rethrow_exception(error);
+    }
+
+    if (res != CURLE_OK) {
+        metrics.failure.Add();
+        spdlog::error("CURL transport error: {}", curl_easy_strerror(res));
+        throw std::runtime_error("Network error while calling Google API");
+    }
+
+    if (http_code == 304 && !if_none_match.empty()) {
+        metrics.not_modified.Add();
+        return std::nullopt;
+    }
+
+    if (http_code != 200) {
+        SheetsMetrics::Responses(std::to_string(http_code)).Add();
+        LOG_RATE_LIMITED(spdlog::level::warn, 1,
+                         "Google API returned error code {}. Body: \n{}", http_code,
+                         transfer.error_body);
+        throw std::runtime_error("Google Sheets API logical error");
+    }
+    metrics.success.Add();
+    return transfer.etag;
 }
 
 std::string GoogleSheetsClient::GetUrl(const RequestParams& params,
                                        const std::string& range) const {
+    return std::format(kRowUrl, base_url_, params.sheet_id, EscapeRange(range), api_key_);
+}
+
+std::string GoogleSheetsClient::GetBatchUrl(const std::vector<RequestParams>& params,
+                                            const SheetBatch& batch) const {
+    // A single range goes to the plain endpoint, so its result has Pull's shape as is
+    if (batch.positions.size() == 1) {
+        const RequestParams& single = params[batch.positions.front()];
+        return GetUrl(single, GetRange(single));
+    }
 
-    return std::format(kRowUrl, params.sheet_id, range, api_key_);
+    std::string ranges;
+    for (size_t position : batch.positions) {
+        ranges += std::format("ranges={}&", EscapeRange(GetRange(params[position])));
+    }
+    return std::format(kBatchUrl, base_url_, batch.sheet_id, ranges, api_key_);
 }
 
 void GoogleSheetsClient::LogUrl(const std::string& url) const {
+    // Masking copies the url, so skip it unless the message is actually written
+    if (!IsLogLevelActive(spdlog::level::trace) ||
+        !spdlog::should_log(spdlog::level::trace)) {
+        return;
+    }
     std::string masked_url = url;
     size_t key_pos = masked_url.find("key=");
     if (key_pos != std::string::npos) {
         masked_url.replace(key_pos + 4, std::string::npos,
-                           std::string('*', api_key_.size()));
+                           std::string(api_key_.size(), '*'));
     }
-    spdlog::trace("Sending request to: {}", masked_url);
+    SPDLOG_TRACE("Sending request to: {}", masked_url);
 }
 
 std::string GoogleSheetsClient::GetRange(const RequestParams& params) {
@@ -71,9 +327,55 @@ std::string GoogleSheetsClient::GetRange(const RequestParams& params) {
 }
 
 size_t GoogleSheetsClient::WriteCallback(void* contents, size_t size, size_t nmemb,
-                                         std::string* userp) {
-    userp->append((char*)contents, size * nmemb);
-    return size * nmemb;
+                                         Transfer* transfer) {
+    std::string_view chunk(static_cast<char*>(contents), size * nmemb);
+    if (transfer->is_cancelled) {
+        return 0;    // Aborts the transfer
+    }
+
+    if (transfer->http_code == 0) {
+        curl_easy_getinfo(transfer->curl.get(), CURLINFO_RESPONSE_CODE,
+                          &transfer->http_code);
+    }
+    // Error bodies are small; keep them for the log instead of passing them on
+    if (transfer->http_code != 200) {
+        transfer->error_body.append(chunk);
+        return chunk.size();
+    }
+    std::lock_guard lock(transfer->mutex);
+    // The chunk is not taken: libcurl hands it over again once resumed
+    if (transfer->pending.size() >= kMaxPendingBytes) {
+        transfer->is_paused = true;
+        GetSheetsMetrics().pauses.Add();
+        return CURL_WRITEFUNC_PAUSE;
+    }
+    GetSheetsMetrics().response_bytes.Add(chunk.size());
+    transfer->pending.append(chunk);
+    transfer->cv.notify_all();
+    return chunk.size();
+}
+
+int GoogleSheetsClient::ProgressCallback(Transfer* transfer, curl_off_t, curl_off_t,
+                                         curl_off_t, curl_off_t) {
+    return transfer->is_cancelled ? 1 : 0;
+}
+
+size_t GoogleSheetsClient::HeaderCallback(char* buffer, size_t size, size_t nitems,
+                                          Transfer* transfer) {
+    std::string_view header(buffer, size * nitems);
+    static constexpr std::string_view kEtag = "etag:";
+
+    if (header.size() > kEtag.size() &&
+        std::equal(kEtag.begin(), kEtag.end(), header.begin(),
+                   [](char lhs, char rhs) { return lhs == std::tolower(rhs); })) {
+        header.remove_prefix(kEtag.size());
+        size_t begin = header.find_first_not_of(" \t");
+        size_t end = header.find_last_not_of(" \t\r\n");
+        if (begin != std::string_view::npos) {
+            transfer->etag = header.substr(begin, end - begin + 1);
+        }
+    }
+    return size * nitems;
 }
 
 }    // namespace bot
@@ -1,11 +1,26 @@
 #pragma once
 
+#include "clients/curl-handle-pool.hpp"
+#include "clients/sheet-rows-parser.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <sys/stat.h>
+#include <vector>
 
 namespace bot {
 
 static const int kDefaultTimeout = 10;
+static const size_t kDefaultBatchConcurrency = 4;
+
+using ChunkSink = std::function<void(std::string_view chunk)>;
 
 struct RequestParams {
     std::string sheet_id;
@@ -14,29 +29,129 @@ struct RequestParams {
     std::string last_idx;
 };
 
+struct ConditionalPull {
+    bool is_modified = true;
+    std::string body;    ///< Empty when the range is not modified
+    std::string etag;
+};
+
 class IGoogleSheetsClient {
 public:
     virtual std::string Pull(const RequestParams& params) const = 0;
+
+    /// Results follow the order of `params`; each one has the same shape as Pull's
+    virtual std::vector<std::string>
+    PullBatch(const std::vector<RequestParams>& params) const = 0;
+
+    /// Streams the rows of one range to `sink` without holding the whole body
+    virtual void PullRows(const RequestParams& params, size_t batch_size,
+                          const RowBatchSink& sink) const = 0;
+
+    /// Conditional Pull. An empty etag makes it unconditional.
+    virtual ConditionalPull PullIfChanged(const RequestParams& params,
+                                          const std::string& etag) const = 0;
+
     virtual ~IGoogleSheetsClient() = default;
 };
 
 class GoogleSheetsClient final : public IGoogleSheetsClient {
 private:
-    static constexpr const char* kRowUrl =
-        "https://sheets.googleapis.com/v4/spreadsheets/{}/values/{}?key={}";
+    static constexpr const char* kRowUrl = "{}/v4/spreadsheets/{}/values/{}?key={}";
+    static constexpr const char* kBatchUrl =
+        "{}/v4/spreadsheets/{}/values:batchGet?{}key={}";
+
+    /// Ranges of one spreadsheet, by their position in the PullBatch request
+    struct SheetBatch {
+        std::string sheet_id;
+        std::vector<size_t> positions;
+    };
+
+    /// One request on the pool's transfer thread. Body chunks are handed to the
+    /// calling thread, which runs the sink, so a slow sink never stalls other requests.
+    /// Once kMaxPendingBytes wait for the sink the transfer is paused until they are
+    /// taken, so a slow sink holds back the network instead of buffering the body.
+    struct Transfer {
+        CurlHandlePool& pool;
+        CurlLease curl;
+        std::unique_ptr<curl_slist, void (*)(curl_slist*)> headers{nullptr,
+                                                                   curl_slist_free_all};
+        std::chrono::steady_clock::time_point started_at;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::string pending;    ///< Received and not given to the sink yet
+        bool is_paused = false;
+        bool is_done = true;    ///< Until started
+        std::atomic<bool> is_cancelled = false;    ///< Makes the callbacks abort
+        CURLcode result = CURLE_OK;
+
+        long http_code = 0;    ///< Transfer thread only until is_done
+        std::string etag;
+        std::string error_body;
+
+        Transfer(CurlHandlePool& pool, CurlLease curl)
+            : pool(pool), curl(std::move(curl)) {}
+        /// Cancels and waits, so callbacks never outlive the transfer
+        ~Transfer();
+
+        /// Makes the callbacks abort; a paused transfer is resumed to notice it
+        void Cancel();
+    };
+
     std::string api_key_;
+    std::string base_url_;
+    size_t max_concurrency_;
+    std::shared_ptr<CurlHandlePool> curl_pool_;
 
 public:
-    GoogleSheetsClient(const std::string& api_key) : api_key_(api_key) {}
+    static constexpr const char* kDefaultBaseUrl = "https://sheets.googleapis.com";
+    /// Response bytes a request buffers for its sink at most (plus one curl chunk)
+    static constexpr size_t kMaxPendingBytes = 1 << 20;
+
+    GoogleSheetsClient(const std::string& api_key,
+                       const std::string& base_url = kDefaultBaseUrl,
+                       size_t max_concurrency = kDefaultBatchConcurrency)
+        : api_key_(api_key), base_url_(base_url),
+          max_concurrency_(max_concurrency ? max_concurrency : 1),
+          curl_pool_(std::make_shared<CurlHandlePool>()) {}
 
     std::string Pull(const RequestParams& params) const override;
 
+    /// Ranges of one spreadsheet share a values:batchGet call; different spreadsheets
+    /// are fetched in parallel over the pool's connections, at most max_concurrency
+    /// at a time, without extra threads
+    std::vector<std::string>
+    PullBatch(const std::vector<RequestParams>& params) const override;
+
+    void PullRows(const RequestParams& params, size_t batch_size,
+                  const RowBatchSink& sink) const override;
+
+    ConditionalPull PullIfChanged(const RequestParams& params,
+                                  const std::string& etag) const override;
+
 private:
     std::string GetUrl(const RequestParams& params, const std::string& range) const;
-    static std::string Perform(const std::string& url);
+    std::string GetBatchUrl(const std::vector<RequestParams>& params,
+                            const SheetBatch& batch) const;
+    /// Moves the response of one batch into results at the batch positions
+    void UnpackBatch(const SheetBatch& batch, std::string body,
+                     std::vector<std::string>& results) const;
+    std::string Perform(const std::string& url) const;
+    /// Returns the response ETag, or nullopt when if_none_match matched (HTTP 304)
+    std::optional<std::string> Perform(const std::string& url, const ChunkSink& sink,
+                                       const std::string& if_none_match = "") const;
+    std::unique_ptr<Transfer> Start(const std::string& url,
+                                    const std::string& if_none_match = "") const;
+    /// Feeds the body to the sink as it arrives and checks the response
+    std::optional<std::string> Finish(Transfer& transfer, const ChunkSink& sink,
+                                      const std::string& if_none_match = "") const;
     static std::string GetRange(const RequestParams& params);
     static size_t WriteCallback(void* contents, size_t size, size_t nmemb,
-                                std::string* userp);
+                                Transfer* transfer);
+    static size_t HeaderCallback(char* buffer, size_t size, size_t nitems,
+                                 Transfer* transfer);
+    static int ProgressCallback(Transfer* transfer, curl_off_t, curl_off_t, curl_off_t,
+                                curl_off_t);
     void LogUrl(const std::string& url) const;
 };
 
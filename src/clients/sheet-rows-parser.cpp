@@ -0,0 +1,140 @@
+#include "sheet-rows-parser.hpp"
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace bot {
+
+namespace {
+
+/// Collects the scalars of one row without building a DOM
+class RowSaxHandler final : public nlohmann::json_sax<nlohmann::json> {
+private:
+    SheetRow& row_;
+    int depth_ = 0;
+
+public:
+    explicit RowSaxHandler(SheetRow& row) : row_(row) {}
+
+    bool null() override { return Add(""); }
+    bool boolean(bool val) override { return Add(val ? "true" : "false"); }
+    bool number_integer(int64_t val) override { return Add(std::to_string(val)); }
+    bool number_unsigned(uint64_t val) override { return Add(std::to_string(val)); }
+    bool number_float(double, const string_t& val) override { return Add(val); }
+    bool string(string_t& val) override { return Add(std::move(val)); }
+    bool binary(binary_t&) override { return false; }
+    bool start_object(size_t) override { return false; }
+    bool key(string_t&) override { return false; }
+    bool end_object() override { return false; }
+    bool start_array(size_t) override { return ++depth_ == 1; }
+    bool end_array() override { return --depth_ == 0; }
+
+    bool parse_error(size_t, const std::string&,
+                     const nlohmann::detail::exception& ex) override {
+        throw std::runtime_error(std::string("Malformed sheet row: ") + ex.what());
+    }
+
+private:
+    bool Add(std::string cell) {
+        row_.push_back(std::move(cell));
+        return depth_ == 1;
+    }
+};
+
+}    // namespace
+
+SheetRowsParser::SheetRowsParser(size_t batch_size, RowBatchSink sink)
+    : batch_size_(batch_size ? batch_size : 1), sink_(std::move(sink)) {
+    batch_.reserve(batch_size_);
+}
+
+void SheetRowsParser::Feed(std::string_view chunk) {
+    for (char c : chunk) {
+        bool in_row = in_values_ && depth_ >= 3;
+        if (in_row) {
+            row_.push_back(c);
+        }
+
+        if (in_string_) {
+            if (is_escaped_) {
+                is_escaped_ = false;
+            } else if (c == '\\') {
+                is_escaped_ = true;
+            } else if (c == '"') {
+                in_string_ = false;
+                continue;
+            }
+            if (depth_ == 1) {
+                last_string_.push_back(c);
+            }
+            continue;
+        }
+
+        switch (c) {
+        case '"':
+            in_string_ = true;
+            if (depth_ == 1) {
+                last_string_.clear();
+            }
+            break;
+        case ':':
+            if (depth_ == 1) {
+                current_key_ = std::move(last_string_);
+                last_string_.clear();
+            }
+            break;
+        case '{':
+        case '[':
+            ++depth_;
+            if (depth_ == 2 && c == '[' && current_key_ == "values") {
+                in_values_ = true;
+            } else if (in_values_ && depth_ == 3) {
+                row_.assign(1, c);
+            }
+            break;
+        case '}':
+        case ']':
+            --depth_;
+            if (in_values_ && depth_ == 2) {
+                ParseRow();
+            } else if (in_values_ && depth_ == 1) {
+                in_values_ = false;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void SheetRowsParser::Finish() {
+    if (depth_ != 0 || in_string_) {
+        throw std::runtime_error("Sheet response was cut short");
+    }
+    if (!batch_.empty()) {
+        sink_(std::move(batch_));
+        batch_.clear();
+    }
+}
+
+void SheetRowsParser::ParseRow() {
+    SheetRow row;
+    RowSaxHandler handler(row);
+    if (!nlohmann::json::sax_parse(row_, &handler)) {
+        throw std::runtime_error("Sheet row is not a flat array: " + row_);
+    }
+    row_.clear();
+
+    batch_.push_back(std::move(row));
+    ++rows_parsed_;
+
+    if (batch_.size() == batch_size_) {
+        sink_(std::move(batch_));
+        batch_.clear();
+        batch_.reserve(batch_size_);
+    }
+}
+
+}    // namespace bot
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bot {
+
+static const size_t kDefaultRowBatchSize = 512;
+
+using SheetRow = std::vector<std::string>;
+using RowBatchSink = std::function<void(std::vector<SheetRow>&& rows)>;
+
+/// Push parser for a Sheets ValueRange body. Chunks are scanned as they arrive, only
+/// the row being read is buffered, and rows reach the sink in batches of batch_size.
+/// Non-string cells are passed on as their JSON text.
+class SheetRowsParser final {
+private:
+    size_t batch_size_;
+    RowBatchSink sink_;
+    std::vector<SheetRow> batch_;
+    size_t rows_parsed_ = 0;
+
+    int depth_ = 0;
+    bool in_string_ = false;
+    bool is_escaped_ = false;
+    bool in_values_ = false;
+    std::string last_string_;    ///< Last string seen directly in the top-level object
+    std::string current_key_;
+    std::string row_;
+
+public:
+    SheetRowsParser(size_t batch_size, RowBatchSink sink);
+
+    void Feed(std::string_view chunk);
+
+    /// Hands over the last partial batch. Throws if the body was cut short.
+    void Finish();
+
+    size_t RowsParsed() const { return rows_parsed_; }
+
+private:
+    void ParseRow();
+};
+
+}    // namespace bot
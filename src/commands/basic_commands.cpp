@@ -0,0 +1,43 @@
+#include "basic_commands.hpp"
+#include <cstdint>
+#include <optional>
+#include <spdlog/spdlog.h>
+#include <utility>
+
+namespace bot {
+
+StartCommand::StartCommand(DiContainer& di) : users_(Scope<UserWriteBehind>(di)) {}
+
+void StartCommand::Handle(const CommandContext& context, RestOfLine payload) {
+    const TgBot::Message& message = context.message;
+    // user_ is keyed by username, users without one are not stored
+    if (!message.from || message.from->username.empty()) {
+        SPDLOG_DEBUG("Skip /start without a username in chat = {}", message.chat->id);
+        return;
+    }
+    if (!payload.text.empty()) {
+        SPDLOG_DEBUG("/start payload = {}", payload.text);
+    }
+    // Repeated /start of a known user would only rewrite the same row
+    if (context.sender && context.sender->username == message.from->username) {
+        return;
+    }
+    // The sender's id, not the chat's: in a group the chat id is the group's
+    users_->Upsert(
+        {message.from->username, std::nullopt, std::nullopt, message.from->id});
+}
+
+CancelCommand::CancelCommand(DiContainer& di)
+    : sessions_(Scope<SessionStore>(di)), scheduler_(Scope<SendScheduler>(di)) {}
+
+void CancelCommand::Handle(const CommandContext& context) {
+    int64_t chat_id = context.message.chat->id;
+    sessions_->Erase(chat_id);
+
+    OutgoingMessage reply;
+    reply.chat_id = chat_id;
+    reply.text = "Cancelled";
+    scheduler_->Enqueue(std::move(reply), SendPriority::kInteractive);
+}
+
+}    // namespace bot
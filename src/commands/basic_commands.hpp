@@ -0,0 +1,43 @@
+#pragma once
+
+#include "commands/command_router.hpp"
+#include "db/user_write_behind.hpp"
+#include "di/di.hpp"
+#include "session/session_store.hpp"
+#include "tg/send_scheduler.hpp"
+#include <string_view>
+
+namespace bot {
+
+/// Stores the sender with their Telegram id, so broadcasts can reach them. Senders the
+/// router already found in user_ are not written again. Deep links
+/// ("t.me/bot?start=payload") arrive as "/start payload"; the payload is not used yet.
+class StartCommand final {
+private:
+    Scoped<UserWriteBehind> users_;
+
+public:
+    static constexpr std::string_view kName = "/start";
+
+    explicit StartCommand(DiContainer& di);
+
+    void Handle(const CommandContext& context, RestOfLine payload);
+};
+
+/// Drops the unfinished step of a multi-step command
+class CancelCommand final {
+private:
+    Scoped<SessionStore> sessions_;
+    Scoped<SendScheduler> scheduler_;
+
+public:
+    static constexpr std::string_view kName = "/cancel";
+
+    explicit CancelCommand(DiContainer& di);
+
+    void Handle(const CommandContext& context);
+};
+
+using BotCommandRouter = CommandRouter<StartCommand, CancelCommand>;
+
+}    // namespace bot
@@ -0,0 +1,247 @@
+#pragma once
+
+#include "db/user_cache.hpp"
+#include "di/di.hpp"
+#include "utils/perfect_hash.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tgbot/types/Message.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace bot {
+
+/// Splits command arguments on whitespace. Tokens are views into the message text.
+class ArgTokenizer final {
+private:
+    static constexpr std::string_view kSpaces = " \t\r\n";
+
+    std::string_view text_;
+
+public:
+    constexpr explicit ArgTokenizer(std::string_view text) : text_(text) {}
+
+    constexpr std::optional<std::string_view> Next() {
+        SkipSpaces();
+        if (text_.empty()) {
+            return std::nullopt;
+        }
+        std::string_view token = text_.substr(0, text_.find_first_of(kSpaces));
+        text_.remove_prefix(token.size());
+        return token;
+    }
+
+    /// Everything not taken yet, without leading whitespace
+    constexpr std::string_view Rest() {
+        SkipSpaces();
+        return std::exchange(text_, {});
+    }
+
+    constexpr bool IsEmpty() {
+        SkipSpaces();
+        return text_.empty();
+    }
+
+private:
+    constexpr void SkipSpaces() {
+        size_t start = text_.find_first_not_of(kSpaces);
+        text_.remove_prefix(start == std::string_view::npos ? text_.size() : start);
+    }
+};
+
+struct CommandCall {
+    std::string_view name;    ///< With the slash and without "@bot", e.g. "/start"
+    std::string_view args;
+};
+
+/// Splits "/name@bot args". Returns nothing for plain text and, when bot_username is
+/// set, for commands addressed to another bot.
+constexpr std::optional<CommandCall> ParseCommand(std::string_view text,
+                                                  std::string_view bot_username = {}) {
+    if (!text.starts_with('/')) {
+        return std::nullopt;
+    }
+    size_t name_end = std::min(text.find_first_of(" \t\r\n"), text.size());
+    std::string_view name = text.substr(0, name_end);
+
+    size_t at = name.find('@');
+    if (at != std::string_view::npos) {
+        if (!bot_username.empty() && name.substr(at + 1) != bot_username) {
+            return std::nullopt;
+        }
+        name = name.substr(0, at);
+    }
+    if (name.size() < 2) {
+        return std::nullopt;
+    }
+    return CommandCall{name, text.substr(name_end)};
+}
+
+/// Argument taking the rest of the message, e.g. free text after the command
+struct RestOfLine {
+    std::string_view text;
+};
+
+namespace detail {
+
+template <typename T> struct IsOptional : std::false_type {};
+template <typename T> struct IsOptional<std::optional<T>> : std::true_type {};
+
+/// Parses one argument of type T: a std::string_view, std::string, integer or floating
+/// point token, a RestOfLine, or an std::optional of those that may be missing
+template <typename T> bool ParseArg(ArgTokenizer& tokens, T& value) {
+    if constexpr (IsOptional<T>::value) {
+        if (tokens.IsEmpty()) {
+            value.reset();
+            return true;
+        }
+        return ParseArg(tokens, value.emplace());
+    } else if constexpr (std::is_same_v<T, RestOfLine>) {
+        value.text = tokens.Rest();
+        return true;
+    } else {
+        std::optional<std::string_view> token = tokens.Next();
+        if (!token) {
+            return false;
+        }
+        if constexpr (std::is_same_v<T, std::string_view>) {
+            value = *token;
+            return true;
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            value.assign(*token);
+            return true;
+        } else {
+            static_assert((std::integral<T> && !std::same_as<T, bool>) ||
+                              std::floating_point<T>,
+                          "Unsupported command argument type");
+            const char* end = token->data() + token->size();
+            auto [ptr, error] = std::from_chars(token->data(), end, value);
+            return error == std::errc{} && ptr == end;
+        }
+    }
+}
+
+template <typename Handler> struct HandlerArgs;
+
+template <typename Command, typename Context, typename... Args>
+struct HandlerArgs<void (Command::*)(Context, Args...)> {
+    using Tuple = std::tuple<std::remove_cvref_t<Args>...>;
+};
+
+template <typename Command, typename Context, typename... Args>
+struct HandlerArgs<void (Command::*)(Context, Args...) const> {
+    using Tuple = std::tuple<std::remove_cvref_t<Args>...>;
+};
+
+template <typename... Commands, size_t... I>
+constexpr auto MakeCommandIndex(std::index_sequence<I...>) {
+    using Entry = std::pair<std::string_view, size_t>;
+    return PerfectHashMap<size_t, sizeof...(Commands)>(
+        std::array<Entry, sizeof...(Commands)>{Entry{Commands::kName, I}...});
+}
+
+}    // namespace detail
+
+struct CommandContext {
+    const TgBot::Message& message;
+    std::string_view name;
+    UserCache::UserPtr sender;    ///< user_ row of message.from; null when not stored
+};
+
+enum class RouteResult {
+    kHandled,
+    kNotCommand,
+    kUnknownCommand,
+    kBadArguments,    ///< Missing, malformed or extra arguments; the handler did not run
+};
+
+/// Dispatches "/command" messages to a fixed set of command types. A command has
+///
+///     static constexpr std::string_view kName = "/name";
+///     explicit Command(DiContainer& di);    // resolves its dependencies once
+///     void Handle(const CommandContext& context, Args... args);
+///
+/// The names form a perfect hash table at compile time, so a lookup is two hashes and
+/// one comparison however many commands there are. Args are parsed from the message
+/// by their types (see detail::ParseArg) without copying the text. With a UserCache the
+/// sender is looked up once the command is known, so handlers can authorize without
+/// a query.
+template <typename... Commands> class CommandRouter final {
+private:
+    static constexpr auto kIndex =
+        detail::MakeCommandIndex<Commands...>(std::index_sequence_for<Commands...>{});
+
+    std::tuple<Commands...> commands_;
+    std::string bot_username_;
+    std::shared_ptr<UserCache> users_;
+
+public:
+    explicit CommandRouter(DiContainer& di, std::string bot_username = {},
+                           std::shared_ptr<UserCache> users = nullptr)
+        : commands_(Commands(di)...), bot_username_(std::move(bot_username)),
+          users_(std::move(users)) {}
+
+    static constexpr bool Contains(std::string_view name) {
+        return kIndex.Contains(name);
+    }
+
+    RouteResult Route(const TgBot::Message& message) {
+        std::optional<CommandCall> call = ParseCommand(message.text, bot_username_);
+        if (!call) {
+            return RouteResult::kNotCommand;
+        }
+        const size_t* index = kIndex.Find(call->name);
+        if (index == nullptr) {
+            return RouteResult::kUnknownCommand;
+        }
+
+        UserCache::UserPtr sender;
+        if (users_ && message.from) {
+            sender = users_->FindByTgId(message.from->id);
+        }
+        ArgTokenizer tokens(call->args);
+        bool is_handled = Dispatch(*index, {message, call->name, std::move(sender)},
+                                   tokens, std::index_sequence_for<Commands...>{});
+        return is_handled ? RouteResult::kHandled : RouteResult::kBadArguments;
+    }
+
+private:
+    using Thunk = bool (CommandRouter::*)(const CommandContext&, ArgTokenizer&);
+
+    template <size_t... I>
+    bool Dispatch(size_t index, const CommandContext& context, ArgTokenizer& tokens,
+                  std::index_sequence<I...>) {
+        static constexpr std::array<Thunk, sizeof...(I)> kThunks = {
+            &CommandRouter::Invoke<I>...};
+        return (this->*kThunks[index])(context, tokens);
+    }
+
+    template <size_t I> bool Invoke(const CommandContext& context, ArgTokenizer& tokens) {
+        auto& command = std::get<I>(commands_);
+        using Command = std::remove_reference_t<decltype(command)>;
+        typename detail::HandlerArgs<decltype(&Command::Handle)>::Tuple args;
+
+        auto parse = [&tokens](auto&... values) {
+            return (detail::ParseArg(tokens, values) && ...);
+        };
+        if (!std::apply(parse, args) || !tokens.IsEmpty()) {
+            return false;
+        }
+        auto handle = [&](auto&... values) {
+            command.Handle(context, std::move(values)...);
+        };
+        std::apply(handle, args);
+        return true;
+    }
+};
+
+}    // namespace bot
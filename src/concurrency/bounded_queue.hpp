@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace bot {
+
+static constexpr size_t kCacheLineSize = 64;
+
+/// Bounded lock-free MPMC queue (D. Vyukov's sequence-numbered ring). The capacity is
+/// rounded up to a power of two and every cell is allocated up front.
+template <typename T> class BoundedQueue final {
+private:
+    struct alignas(kCacheLineSize) Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> buffer_;
+    size_t mask_;
+
+    alignas(kCacheLineSize) std::atomic<size_t> enqueue_pos_{0};
+    alignas(kCacheLineSize) std::atomic<size_t> dequeue_pos_{0};
+
+public:
+    explicit BoundedQueue(size_t capacity)
+        : buffer_(new Cell[std::bit_ceil(std::max<size_t>(capacity, 2))]),
+          mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1) {
+        for (size_t i = 0; i <= mask_; ++i) {
+            buffer_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    bool TryPush(T value) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &buffer_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence) -
+                        static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                                       std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T& value) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &buffer_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence) -
+                        static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                                       std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = std::move(cell->value);
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t Capacity() const { return mask_ + 1; }
+};
+
+}    // namespace bot
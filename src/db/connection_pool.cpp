@@ -0,0 +1,160 @@
+#include "connection_pool.hpp"
+#include "metrics/metrics.hpp"
+#include "tracing/tracer.hpp"
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <sqlite3.h>
+#include <string>
+#include <utility>
+
+namespace bot {
+
+namespace {
+
+void ApplyPragmas(SQLite::Database& db, const PoolConfig& config) {
+    db.exec("PRAGMA mmap_size = " + std::to_string(config.mmap_size) + ";");
+    db.exec("PRAGMA cache_size = " + std::to_string(config.cache_size) + ";");
+    db.exec("PRAGMA temp_store = MEMORY;");
+}
+
+constexpr size_t kMaxTracedSqlLength = 200;
+
+/// SQLite reports the wall time of every finished statement, so no call site has to
+/// be wrapped by hand
+int ProfileStatement(unsigned type, void* context, void* statement, void* elapsed_ns) {
+    if (type != SQLITE_TRACE_PROFILE) {
+        return 0;
+    }
+    auto elapsed = static_cast<uint64_t>(*static_cast<sqlite3_int64*>(elapsed_ns));
+    static_cast<Histogram*>(context)->Record(elapsed);
+
+    if (CurrentTraceContext().IsSampled()) {
+        const char* sql = sqlite3_sql(static_cast<sqlite3_stmt*>(statement));
+        RecordFinishedSpan("sqlite.statement", std::chrono::nanoseconds(elapsed),
+                           std::string(sql ? sql : "").substr(0, kMaxTracedSqlLength));
+    }
+    return 0;
+}
+
+std::unique_ptr<PooledConnection>
+OpenConnection(const PoolConfig& config, int flags,
+               const std::shared_ptr<IQueriesManager>& queries_manager) {
+    auto db =
+        std::make_shared<SQLite::Database>(config.path, flags, config.busy_timeout_ms);
+    ApplyPragmas(*db, config);
+
+    bool is_writer = (flags & SQLite::OPEN_READWRITE) != 0;
+    Histogram& statement_duration = Metrics().GetHistogram(
+        "sqlite_statement_duration_seconds", "SQLite statement execution time",
+        {{"connection", is_writer ? "writer" : "reader"}});
+    sqlite3_trace_v2(db->getHandle(), SQLITE_TRACE_PROFILE, ProfileStatement,
+                     &statement_duration);
+
+    return std::make_unique<PooledConnection>(
+        PooledConnection{db, std::make_shared<StatementCache>(db, queries_manager)});
+}
+
+}    // namespace
+
+PoolConfig MakePoolConfig(IEnvManager& env) {
+    PoolConfig config;
+    config.path = env.Get("DB_PATH");
+    config.readers = std::stoul(env.Get("DB_READERS"));
+    config.busy_timeout_ms = std::stoi(env.Get("DB_BUSY_TIMEOUT_MS"));
+    config.mmap_size = std::stoll(env.Get("DB_MMAP_SIZE"));
+    config.cache_size = std::stoll(env.Get("DB_CACHE_SIZE"));
+    return config;
+}
+
+ConnectionLease::~ConnectionLease() { Release(); }
+
+ConnectionLease::ConnectionLease(ConnectionLease&& other) noexcept
+    : pool_(std::exchange(other.pool_, nullptr)),
+      connection_(std::exchange(other.connection_, nullptr)),
+      is_writer_(other.is_writer_) {}
+
+ConnectionLease& ConnectionLease::operator=(ConnectionLease&& other) noexcept {
+    if (this != &other) {
+        Release();
+        pool_ = std::exchange(other.pool_, nullptr);
+        connection_ = std::exchange(other.connection_, nullptr);
+        is_writer_ = other.is_writer_;
+    }
+    return *this;
+}
+
+void ConnectionLease::Release() {
+    if (pool_) {
+        pool_->Return(connection_, is_writer_);
+        pool_ = nullptr;
+        connection_ = nullptr;
+    }
+}
+
+ConnectionPool::ConnectionPool(const PoolConfig& config,
+                               const std::shared_ptr<IQueriesManager>& queries_manager)
+    : config_(config) {
+    if (config_.path == ":memory:") {
+        config_.readers = 0;
+    }
+
+    writer_ = OpenConnection(config_, SQLite::OPEN_READWRITE, queries_manager);
+    std::string journal_mode =
+        writer_->db->execAndGet("PRAGMA journal_mode = WAL;").getString();
+    writer_->db->exec("PRAGMA synchronous = NORMAL;");
+
+    for (size_t i = 0; i < config_.readers; ++i) {
+        readers_.push_back(
+            OpenConnection(config_, SQLite::OPEN_READONLY, queries_manager));
+        readers_.back()->db->exec("PRAGMA query_only = ON;");
+        idle_readers_.push_back(readers_.back().get());
+    }
+
+    SPDLOG_DEBUG("Connection pool is ready. Readers = {}, journal mode = {}",
+                 config_.readers, journal_mode);
+}
+
+ConnectionLease ConnectionPool::AcquireWriter() {
+    Span span("db.acquire_writer");
+    writer_free_.acquire();
+    return ConnectionLease(this, writer_.get(), true);
+}
+
+ConnectionLease ConnectionPool::AcquireReader() {
+    if (readers_.empty()) {
+        return AcquireWriter();
+    }
+
+    Span span("db.acquire_reader");
+    std::unique_lock lock(readers_mutex_);
+    readers_cv_.wait(lock, [this] { return !idle_readers_.empty(); });
+
+    PooledConnection* connection = idle_readers_.back();
+    idle_readers_.pop_back();
+    return ConnectionLease(this, connection, false);
+}
+
+size_t ConnectionPool::IdleReaders() {
+    std::lock_guard lock(readers_mutex_);
+    return idle_readers_.size();
+}
+
+void ConnectionPool::Return(PooledConnection* connection, bool is_writer) {
+    if (is_writer) {
+        writer_free_.release();
+        return;
+    }
+
+    {
+        std::lock_guard lock(readers_mutex_);
+        idle_readers_.push_back(connection);
+    }
+    readers_cv_.notify_one();
+}
+
+}    // namespace bot
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "db/queries_manager.hpp"
+#include "db/statement_cache.hpp"
+#include "env/env_manager.hpp"
+#include <SQLiteCpp/Database.h>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <string>
+#include <vector>
+
+namespace bot {
+
+struct PoolConfig {
+    std::string path;
+    size_t readers = 4;
+    int busy_timeout_ms = 5000;
+    int64_t mmap_size = 256 * 1024 * 1024;
+    int64_t cache_size = -16384;    ///< Same units as PRAGMA cache_size: negative is KiB
+};
+
+PoolConfig MakePoolConfig(IEnvManager& env);
+
+struct PooledConnection {
+    std::shared_ptr<SQLite::Database> db;
+    std::shared_ptr<StatementCache> statements;
+};
+
+class ConnectionPool;
+
+/// Borrowed connection. Goes back to the pool when the lease is destroyed, which may
+/// happen on another thread than the one that acquired it.
+class ConnectionLease final {
+private:
+    ConnectionPool* pool_;
+    PooledConnection* connection_;
+    bool is_writer_;
+
+public:
+    ConnectionLease(ConnectionPool* pool, PooledConnection* connection, bool is_writer)
+        : pool_(pool), connection_(connection), is_writer_(is_writer) {}
+    ~ConnectionLease();
+
+    ConnectionLease(ConnectionLease&& other) noexcept;
+    ConnectionLease& operator=(ConnectionLease&& other) noexcept;
+    ConnectionLease(const ConnectionLease&) = delete;
+    ConnectionLease& operator=(const ConnectionLease&) = delete;
+
+    SQLite::Database& operator*() const { return *connection_->db; }
+    SQLite::Database* operator->() const { return connection_->db.get(); }
+
+    const std::shared_ptr<SQLite::Database>& Database() const { return connection_->db; }
+    const std::shared_ptr<StatementCache>& Statements() const {
+        return connection_->statements;
+    }
+
+    bool IsWriter() const { return is_writer_; }
+
+private:
+    void Release();
+};
+
+/// One writer and N read-only connections to the same database in WAL mode, so readers
+/// never wait for the writer. An in-memory database cannot be shared between
+/// connections, so for ":memory:" readers are served by the writer.
+class ConnectionPool final {
+private:
+    friend class ConnectionLease;
+
+    PoolConfig config_;
+
+    std::unique_ptr<PooledConnection> writer_;
+    /// Not a mutex: a moved lease may release the writer on another thread
+    std::binary_semaphore writer_free_{1};
+
+    std::vector<std::unique_ptr<PooledConnection>> readers_;
+    std::vector<PooledConnection*> idle_readers_;
+    std::mutex readers_mutex_;
+    std::condition_variable readers_cv_;
+
+public:
+    ConnectionPool(const PoolConfig& config,
+                   const std::shared_ptr<IQueriesManager>& queries_manager);
+
+    /// Blocks while another lease holds the writer
+    ConnectionLease AcquireWriter();
+
+    /// Blocks while every reader is borrowed
+    ConnectionLease AcquireReader();
+
+    size_t IdleReaders();
+
+private:
+    void Return(PooledConnection* connection, bool is_writer);
+};
+
+}    // namespace bot
@@ -0,0 +1,44 @@
+#include "embedded_queries_manager.hpp"
+#include "db/embedded_sql.hpp"
+#include "db/queries_manager.hpp"
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bot {
+
+EmbeddedQueriesManager::EmbeddedQueriesManager() {
+    std::vector<std::filesystem::path> paths;
+    for (const auto& script : EmbeddedScripts()) {
+        paths.emplace_back(script.path);
+    }
+    subdirs_ = BuildSubdirIndex(paths);
+}
+
+std::string EmbeddedQueriesManager::Get(const std::string& path) {
+    ScriptView script = GetView(path);
+    return std::string(script.Text());
+}
+
+ScriptView EmbeddedQueriesManager::GetView(std::string_view path) {
+    const std::string_view* script = FindEmbeddedScript(path);
+    if (!script) {
+        throw std::runtime_error("Sql script = " + std::string(path) + " not found");
+    }
+    return ScriptView(*script);
+}
+
+std::vector<std::filesystem::path>
+EmbeddedQueriesManager::ListSubdirFiles(const std::filesystem::path& subdir) {
+    auto it = subdirs_.find(NormalizeSubdir(subdir));
+    if (it == subdirs_.end()) {
+        return {};
+    }
+    return it->second;
+}
+
+bool HasEmbeddedScripts() { return !EmbeddedScripts().empty(); }
+
+}    // namespace bot
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "db/queries_manager.hpp"
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bot {
+
+/// Serves the scripts compiled into the binary, see cmake/EmbedSql.cmake. Startup
+/// does no directory I/O and lookups go through a compile-time perfect-hash table.
+class EmbeddedQueriesManager final : public IQueriesManager {
+private:
+    std::map<std::string, std::vector<std::filesystem::path>, std::less<>> subdirs_;
+
+public:
+    EmbeddedQueriesManager();
+
+    std::string Get(const std::string& path) override;
+
+    /// Embedded scripts live as long as the program, so the view owns nothing
+    ScriptView GetView(std::string_view path) override;
+
+    std::vector<std::filesystem::path>
+    ListSubdirFiles(const std::filesystem::path& subdir) override;
+};
+
+/// True when the build embedded sql/, so SQL_DIR is only an override
+bool HasEmbeddedScripts();
+
+}    // namespace bot
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <span>
+#include <string_view>
+
+namespace bot {
+
+struct EmbeddedScript {
+    std::string_view path;      ///< Relative to sql/, e.g. "dao/upsert_user.sql"
+    std::string_view script;    ///< NUL-terminated
+};
+
+/// Scripts compiled into the binary from sql/, sorted by path. Empty when the build
+/// was configured with BOT_EMBED_SQL=OFF. Defined in the generated embedded_sql.cpp.
+std::span<const EmbeddedScript> EmbeddedScripts();
+
+/// Compile-time perfect-hash lookup, nullptr for unknown paths
+const std::string_view* FindEmbeddedScript(std::string_view path);
+
+}    // namespace bot
@@ -1,5 +1,9 @@
 #include "migration_manager.hpp"
+#include "db/connection_pool.hpp"
+#include "db/online_migration_runner.hpp"
 #include "db/queries_manager.hpp"
+#include "metrics/metrics.hpp"
+#include "utils/xxhash.hpp"
 #include <SQLiteCpp/SQLiteCpp.h>
 #include <SQLiteCpp/Statement.h>
 #include <SQLiteCpp/Transaction.h>
@@ -11,86 +15,163 @@
 #include <spdlog/spdlog.h>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <vector>
 
 namespace bot {
 
+namespace {
+
+constexpr std::string_view kHashPrefix = "xxh64:";
+
+}    // namespace
+
 MigrationManager::MigrationManager(
     const std::shared_ptr<SQLite::Database>& db,
     const std::shared_ptr<IQueriesManager>& queries_manager, const Config config_)
-    : db_(db), queries_manager_(queries_manager), config_(config_) {}
+    : MigrationManager(db, queries_manager,
+                       std::make_shared<StatementCache>(db, queries_manager), config_) {}
+
+MigrationManager::MigrationManager(
+    const std::shared_ptr<SQLite::Database>& db,
+    const std::shared_ptr<IQueriesManager>& queries_manager,
+    const std::shared_ptr<StatementCache>& statements, const Config config_)
+    : db_(db), queries_manager_(queries_manager), statements_(statements),
+      config_(config_) {}
 
 void ApplyMigrations(DiContainer& ctx) {
-    MigrationManager(GET(ctx, SQLite::Database), GET(ctx, IQueriesManager), Config{})
+    ConnectionLease writer = GET(ctx, ConnectionPool)->AcquireWriter();
+    MigrationManager(writer.Database(), GET(ctx, IQueriesManager), writer.Statements(),
+                     Config{})
         .Run();
 }
 
+std::string FormatMigrationHash(std::string_view script) {
+    return std::format("{}{:016x}", kHashPrefix, XxHash64(script));
+}
+
 void MigrationManager::Run() {
     EnsureVersionTable();
     int32_t current_version = GetCurrentVersion();
+    AppliedMigrations applied = LoadAppliedMigrations();
 
     std::vector<std::filesystem::path> migrations =
         queries_manager_->ListSubdirFiles(config_.migrations_dir);
 
-    spdlog::debug("Database current version = {}. Migrations amount = {}",
-                  current_version, migrations.size());
-    std::hash<std::string> hash;
+    SPDLOG_DEBUG("Database current version = {}. Migrations amount = {}",
+                 current_version, migrations.size());
+
+    std::vector<HashUpdate> legacy_hashes;
+    std::vector<std::tuple<std::filesystem::path, std::string, std::string>> pending;
 
     for (const auto& path : migrations) {
+        if (IsOnlineMigration(path)) {
+            continue;
+        }
+
         std::string script = queries_manager_->Get(
             std::filesystem::path(config_.migrations_dir) / path.string());
 
         int32_t version = GetVersion(path);
-        size_t script_hash = hash(script);
-        std::string formated_hash = std::format("{:016x}", script_hash);
+        std::string formated_hash = FormatMigrationHash(script);
 
-        if (version <= current_version) {
-            ValidateOldMigration(path, version, formated_hash);
-        } else {
-            RunMigrationScript(script, path.string(), version, formated_hash);
+        if (version > current_version) {
+            pending.emplace_back(path, std::move(script), std::move(formated_hash));
+        } else if (ValidateOldMigration(applied, path, version, script, formated_hash)) {
+            legacy_hashes.push_back({version, path.string(), formated_hash});
         }
     }
 
-    spdlog::debug("All migrations applied successfully");
+    RewriteLegacyHashes(legacy_hashes);
+
+    for (const auto& [path, script, formated_hash] : pending) {
+        RunMigrationScript(script, path.string(), GetVersion(path), formated_hash);
+    }
+
+    SPDLOG_DEBUG("All migrations applied successfully");
 }
 
 void MigrationManager::RunMigrationScript(const std::string& script,
                                           const std::string& name, int32_t version,
                                           const std::string& formated_hash) {
 
-    spdlog::debug("Apply migration = {} (version = {}, hash = {})", name, version,
-                  formated_hash);
+    SPDLOG_DEBUG("Apply migration = {} (version = {}, hash = {})", name, version,
+                 formated_hash);
+    ScopedTimer timer(Metrics().GetHistogram("migration_duration_seconds",
+                                             "Time spent applying a migration",
+                                             {{"migration", name}}));
     SQLite::Transaction transaction(*db_);
 
-    SQLite::Statement insert(*db_, queries_manager_->Get(config_.insert_version_record));
+    auto insert = statements_->Acquire(config_.insert_version_record);
 
-    insert.bind(1, version);
-    insert.bind(2, name);
-    insert.bind(3, formated_hash);
+    insert->bind(1, version);
+    insert->bind(2, name);
+    insert->bind(3, formated_hash);
 
-    insert.exec();
+    insert->exec();
     db_->exec(script);
 
     transaction.commit();
 }
 
-void MigrationManager::ValidateOldMigration(const std::filesystem::path& path,
-                                            int32_t version,
-                                            const std::string& new_formated_hash) {
-    spdlog::debug("Check migration = {} (version = {}, hash = {})", path.string(),
-                  version, new_formated_hash);
+MigrationManager::AppliedMigrations MigrationManager::LoadAppliedMigrations() {
+    AppliedMigrations applied;
+    auto select = statements_->Acquire(config_.get_applied_migrations);
+    while (select->executeStep()) {
+        applied[select->getColumn(0).getInt()] = {select->getColumn(1).getString(),
+                                                  select->getColumn(2).getString()};
+    }
+    select->reset();
+    return applied;
+}
 
-    std::string script = queries_manager_->Get(config_.check_migration_hash);
+bool MigrationManager::ValidateOldMigration(const AppliedMigrations& applied,
+                                            const std::filesystem::path& path,
+                                            int32_t version, const std::string& script,
+                                            const std::string& new_formated_hash) {
+    SPDLOG_DEBUG("Check migration = {} (version = {}, hash = {})", path.string(),
+                 version, new_formated_hash);
 
-    SQLite::Statement check(*db_, script);
+    auto it = applied.find(version);
+    if (it == applied.end() || it->second.name != path.string()) {
+        throw std::invalid_argument("Migration was damaged!");
+    }
 
-    check.bind(1, version);
-    check.bind(2, path.string());
-    check.bind(3, new_formated_hash);
+    const std::string& stored_hash = it->second.hash;
+    if (stored_hash.starts_with(kHashPrefix)) {
+        if (stored_hash != new_formated_hash) {
+            throw std::invalid_argument("Migration was damaged!");
+        }
+        return false;
+    }
 
-    if (check.executeStep() && check.getColumn(0).getInt() == 0) {
+    // Rows written before the switch hold std::hash<std::string>, which is only
+    // comparable within the same standard library build
+    if (stored_hash != std::format("{:016x}", std::hash<std::string>{}(script))) {
         throw std::invalid_argument("Migration was damaged!");
     }
+    return true;
+}
+
+void MigrationManager::RewriteLegacyHashes(const std::vector<HashUpdate>& updates) {
+    if (updates.empty()) {
+        return;
+    }
+
+    spdlog::info("Rewrite {} legacy migration hashes", updates.size());
+    SQLite::Transaction transaction(*db_);
+
+    auto update = statements_->Acquire(config_.update_migration_hash);
+    for (const auto& [version, name, hash] : updates) {
+        update->bind(1, hash);
+        update->bind(2, version);
+        update->bind(3, name);
+        update->exec();
+        update->reset();
+    }
+
+    transaction.commit();
 }
 
 void MigrationManager::EnsureVersionTable() {
@@ -1,11 +1,15 @@
 #pragma once
 
 #include "db/queries_manager.hpp"
+#include "db/statement_cache.hpp"
 #include "di/di.hpp"
 #include <SQLiteCpp/Database.h>
 #include <SQLiteCpp/SQLiteCpp.h>
 #include <filesystem>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace bot {
@@ -16,28 +20,55 @@ struct Config {
     std::string create_version_table = internal_dir + "/create_version_table.sql";
     std::string get_current_version = internal_dir + "/get_current_version.sql";
     std::string insert_version_record = internal_dir + "/insert_version_record.sql";
-    std::string check_migration_hash = internal_dir + "/check_migration_hash.sql";
+    std::string get_applied_migrations = internal_dir + "/get_applied_migrations.sql";
+    std::string update_migration_hash = internal_dir + "/update_migration_hash.sql";
 };
 
+/// Persisted form of a migration hash, e.g. "xxh64:9a1e05f3c26d4b70"
+std::string FormatMigrationHash(std::string_view script);
+
 class MigrationManager final {
 private:
+    struct AppliedMigration {
+        std::string name;
+        std::string hash;
+    };
+
+    struct HashUpdate {
+        int32_t version;
+        std::string name;
+        std::string hash;
+    };
+
+    using AppliedMigrations = std::unordered_map<int32_t, AppliedMigration>;
+
     std::shared_ptr<SQLite::Database> db_;
     std::shared_ptr<IQueriesManager> queries_manager_;
+    std::shared_ptr<StatementCache> statements_;
     Config config_;
 
 public:
     MigrationManager(const std::shared_ptr<SQLite::Database>& db,
                      const std::shared_ptr<IQueriesManager>& queries_manager,
                      const Config config_);
+    MigrationManager(const std::shared_ptr<SQLite::Database>& db,
+                     const std::shared_ptr<IQueriesManager>& queries_manager,
+                     const std::shared_ptr<StatementCache>& statements,
+                     const Config config_);
     void Run();
 
 private:
     void EnsureVersionTable();
     int32_t GetCurrentVersion();
-    std::vector<std::filesystem::path> GetMissingMigrations(int32_t version);
+    AppliedMigrations LoadAppliedMigrations();
 
-    void ValidateOldMigration(const std::filesystem::path& path, int32_t version,
+    /// Returns true when the row still holds a legacy std::hash value that matches
+    /// the script and has to be rewritten in the stable format
+    bool ValidateOldMigration(const AppliedMigrations& applied,
+                              const std::filesystem::path& path, int32_t version,
+                              const std::string& script,
                               const std::string& new_formated_hash);
+    void RewriteLegacyHashes(const std::vector<HashUpdate>& updates);
 
     void RunMigrationScript(const std::string& script, const std::string& name,
                             int32_t version, const std::string& formated_hash);
@@ -0,0 +1,233 @@
+#include "online_migration_runner.hpp"
+#include "db/migration_manager.hpp"
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <SQLiteCpp/Transaction.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace bot {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Waiting longer than this for the writer means live writes are competing with us
+constexpr std::chrono::milliseconds kContendedLockWait{1};
+
+}    // namespace
+
+OnlineMigrationConfig MakeOnlineMigrationConfig(IEnvManager& env) {
+    OnlineMigrationConfig config;
+    config.chunk_size = std::stoul(env.Get("ONLINE_MIGRATION_CHUNK"));
+    config.pause =
+        std::chrono::milliseconds(std::stoll(env.Get("ONLINE_MIGRATION_PAUSE_MS")));
+    return config;
+}
+
+bool IsOnlineMigration(const std::filesystem::path& path) {
+    return path.string().ends_with(".online.sql");
+}
+
+OnlineMigrationRunner::OnlineMigrationRunner(
+    const std::shared_ptr<ConnectionPool>& pool,
+    const std::shared_ptr<IQueriesManager>& queries_manager,
+    const OnlineMigrationConfig& config, MigrationChunkHook on_chunk)
+    : pool_(pool),
+      queries_manager_(queries_manager),
+      config_(config),
+      on_chunk_(std::move(on_chunk)) {
+    stats_.chunk_size = config_.chunk_size;
+    stats_.pause = config_.pause;
+}
+
+OnlineMigrationRunner::~OnlineMigrationRunner() { Stop(); }
+
+void OnlineMigrationRunner::Start() {
+    worker_ = std::jthread([this](std::stop_token stop) { RunAll(stop); });
+}
+
+void OnlineMigrationRunner::Stop() {
+    if (worker_.joinable()) {
+        worker_.request_stop();
+        worker_.join();
+    }
+}
+
+void OnlineMigrationRunner::Wait() {
+    std::unique_lock lock(mutex_);
+    if (!worker_.joinable()) {
+        return;
+    }
+    cv_.wait(lock, [this] { return is_finished_; });
+}
+
+OnlineMigrationStats OnlineMigrationRunner::Stats() const {
+    std::lock_guard lock(mutex_);
+    return stats_;
+}
+
+void OnlineMigrationRunner::RunAll(std::stop_token stop) {
+    try {
+        {
+            ConnectionLease writer = pool_->AcquireWriter();
+            SQLite::Transaction transaction(*writer);
+            writer->exec(queries_manager_->Get(config_.create_progress_table));
+            transaction.commit();
+        }
+
+        auto migrations = queries_manager_->ListSubdirFiles(config_.migrations_dir);
+        for (const auto& path : migrations) {
+            if (stop.stop_requested()) {
+                break;
+            }
+            if (IsOnlineMigration(path)) {
+                RunMigration(path, stop);
+            }
+        }
+    } catch (std::exception& ex) {
+        spdlog::error("Online migrations stopped. Error = {}", ex.what());
+    }
+
+    std::lock_guard lock(mutex_);
+    is_finished_ = true;
+    cv_.notify_all();
+}
+
+void OnlineMigrationRunner::RunMigration(const std::filesystem::path& path,
+                                         std::stop_token stop) {
+    std::string name = path.string();
+    std::string script_path =
+        (std::filesystem::path(config_.migrations_dir) / path).string();
+    std::string hash = FormatMigrationHash(queries_manager_->Get(script_path));
+
+    int64_t last_key = 0;
+    if (!PrepareProgress(name, hash, last_key)) {
+        return;
+    }
+    spdlog::info("Run online migration = {} (hash = {})", name, hash);
+
+    size_t chunk_size;
+    std::chrono::milliseconds pause;
+    {
+        std::lock_guard lock(mutex_);
+        chunk_size = stats_.chunk_size;
+        pause = stats_.pause;
+    }
+
+    while (!stop.stop_requested()) {
+        Clock::time_point wait_start = Clock::now();
+        Clock::time_point chunk_start;
+        Clock::time_point chunk_end;
+        int64_t rows = 0;
+        int64_t max_key = last_key;
+
+        {
+            ConnectionLease writer = pool_->AcquireWriter();
+            chunk_start = Clock::now();
+
+            SQLite::Transaction transaction(*writer);
+            auto chunk = writer.Statements()->Acquire(script_path);
+            chunk->bind(":last_key", last_key);
+            chunk->bind(":chunk_size", static_cast<int64_t>(chunk_size));
+            while (chunk->executeStep()) {
+                ++rows;
+                max_key = std::max(max_key, chunk->getColumn(0).getInt64());
+            }
+            chunk->reset();
+
+            auto update = writer.Statements()->Acquire(config_.update_progress);
+            update->bind(1, name);
+            update->bind(2, max_key);
+            update->bind(3, rows);
+            update->bind(4, rows == 0 ? 1 : 0);
+            update->exec();
+            update->reset();
+
+            transaction.commit();
+            chunk_end = Clock::now();
+        }
+
+        {
+            std::lock_guard lock(mutex_);
+            ++stats_.chunks;
+            stats_.rows += rows;
+            if (rows == 0) {
+                ++stats_.migrations_done;
+            }
+        }
+
+        if (rows == 0) {
+            spdlog::info("Online migration = {} done", name);
+            return;
+        }
+        if (on_chunk_) {
+            on_chunk_(name);
+        }
+        last_key = max_key;
+
+        Throttle(chunk_start - wait_start, chunk_end - chunk_start, chunk_size, pause);
+
+        std::unique_lock lock(mutex_);
+        stats_.chunk_size = chunk_size;
+        stats_.pause = pause;
+        cv_.wait_for(lock, stop, pause, [] { return false; });
+    }
+}
+
+bool OnlineMigrationRunner::PrepareProgress(const std::string& name,
+                                            const std::string& hash, int64_t& last_key) {
+    ConnectionLease writer = pool_->AcquireWriter();
+
+    auto insert = writer.Statements()->Acquire(config_.insert_progress);
+    insert->bind(1, name);
+    insert->bind(2, hash);
+    insert->exec();
+    insert->reset();
+
+    auto select = writer.Statements()->Acquire(config_.get_progress);
+    select->bind(1, name);
+    select->executeStep();
+    std::string stored_hash = select->getColumn(0).getString();
+    last_key = select->getColumn(1).getInt64();
+    bool is_done = select->getColumn(2).getInt() != 0;
+    select->reset();
+
+    if (is_done) {
+        return false;
+    }
+    if (stored_hash != hash) {
+        spdlog::error("Online migration = {} was changed after it started, skip it",
+                      name);
+        std::lock_guard lock(mutex_);
+        ++stats_.migrations_skipped;
+        return false;
+    }
+    return true;
+}
+
+void OnlineMigrationRunner::Throttle(std::chrono::nanoseconds lock_wait,
+                                     std::chrono::nanoseconds chunk_time,
+                                     size_t& chunk_size,
+                                     std::chrono::milliseconds& pause) {
+    if (chunk_time > config_.target_chunk_time) {
+        chunk_size = std::max(config_.min_chunk_size, chunk_size / 2);
+    } else if (chunk_time < config_.target_chunk_time / 2) {
+        chunk_size = std::min(config_.max_chunk_size, chunk_size + chunk_size / 2 + 1);
+    }
+
+    if (lock_wait > kContendedLockWait) {
+        pause = std::min(config_.max_pause, pause * 2);
+    } else {
+        pause = std::max(config_.pause, pause / 2);
+    }
+}
+
+}    // namespace bot
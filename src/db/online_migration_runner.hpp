@@ -0,0 +1,109 @@
+#pragma once
+
+#include "db/connection_pool.hpp"
+#include "db/queries_manager.hpp"
+#include "env/env_manager.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace bot {
+
+struct OnlineMigrationConfig {
+    std::string migrations_dir = "migrations";
+    std::string create_progress_table = "internal/create_online_migration_table.sql";
+    std::string get_progress = "internal/get_online_migration.sql";
+    std::string insert_progress = "internal/insert_online_migration.sql";
+    std::string update_progress = "internal/update_online_migration.sql";
+
+    size_t chunk_size = 500;    ///< Starting chunk, adapted between min and max
+    size_t min_chunk_size = 50;
+    size_t max_chunk_size = 5000;
+    /// Chunks slower than this shrink, chunks under half of it grow
+    std::chrono::milliseconds target_chunk_time{20};
+    std::chrono::milliseconds pause{50};    ///< Minimal gap that live writes get
+    std::chrono::milliseconds max_pause{2000};
+};
+
+OnlineMigrationConfig MakeOnlineMigrationConfig(IEnvManager& env);
+
+/// Called with the migration name after each committed chunk that changed rows
+using MigrationChunkHook = std::function<void(const std::string&)>;
+
+struct OnlineMigrationStats {
+    uint64_t migrations_done = 0;
+    uint64_t migrations_skipped = 0;
+    uint64_t chunks = 0;
+    uint64_t rows = 0;
+    size_t chunk_size = 0;
+    std::chrono::milliseconds pause{0};
+};
+
+/// "NNN_name.online.sql" scripts in the migrations directory. They are skipped by
+/// MigrationManager and run by OnlineMigrationRunner after startup
+bool IsOnlineMigration(const std::filesystem::path& path);
+
+/// Runs online migrations in the background, one keyed chunk per short transaction.
+/// A script is a single statement that takes :last_key and :chunk_size, processes the
+/// next chunk of keys after :last_key and returns the processed keys, e.g.
+///
+///     UPDATE user_ SET role = 'user' WHERE id IN (SELECT id FROM user_
+///         WHERE id > :last_key ORDER BY id LIMIT :chunk_size) RETURNING id;
+///
+/// The largest returned key is stored in online_migrations_ in the same transaction,
+/// so a restart resumes where it stopped. An empty chunk finishes the migration.
+/// Chunk size follows the observed chunk time and the pause grows while acquiring the
+/// writer has to wait for live writes.
+class OnlineMigrationRunner final {
+private:
+    std::shared_ptr<ConnectionPool> pool_;
+    std::shared_ptr<IQueriesManager> queries_manager_;
+    OnlineMigrationConfig config_;
+    MigrationChunkHook on_chunk_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable_any cv_;
+    OnlineMigrationStats stats_;
+    bool is_finished_ = false;
+    std::jthread worker_;
+
+public:
+    OnlineMigrationRunner(const std::shared_ptr<ConnectionPool>& pool,
+                          const std::shared_ptr<IQueriesManager>& queries_manager,
+                          const OnlineMigrationConfig& config = {},
+                          MigrationChunkHook on_chunk = {});
+    ~OnlineMigrationRunner();
+
+    OnlineMigrationRunner(const OnlineMigrationRunner&) = delete;
+    OnlineMigrationRunner& operator=(const OnlineMigrationRunner&) = delete;
+
+    void Start();
+
+    /// Interrupts the current pause; the running chunk is committed first
+    void Stop();
+
+    /// Blocks until every online migration finished or the runner was stopped
+    void Wait();
+
+    OnlineMigrationStats Stats() const;
+
+private:
+    void RunAll(std::stop_token stop);
+    void RunMigration(const std::filesystem::path& path, std::stop_token stop);
+
+    /// Returns false when the migration is already done or has to be skipped
+    bool PrepareProgress(const std::string& name, const std::string& hash,
+                         int64_t& last_key);
+
+    void Throttle(std::chrono::nanoseconds lock_wait, std::chrono::nanoseconds chunk_time,
+                  size_t& chunk_size, std::chrono::milliseconds& pause);
+};
+
+}    // namespace bot
@@ -1,9 +1,17 @@
 #include "queries_manager.hpp"
 #include <algorithm>
+#include <cstddef>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <spdlog/spdlog.h>
+#include <sstream>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace bot {
@@ -26,48 +34,148 @@ bool IsSqlFile(const std::filesystem::directory_entry& entry) {
     return entry.is_regular_file() && entry.path().string().ends_with(".sql");
 }
 
-bool IsParent(const std::filesystem::path& parent, const std::filesystem::path& child) {
-    auto [p_it, c_it] =
-        std::mismatch(parent.begin(), parent.end(), child.begin(), child.end());
+}    // namespace
 
-    return p_it == parent.end() && c_it != child.end();
+std::string NormalizeSubdir(const std::filesystem::path& subdir) {
+    std::string key = subdir.lexically_normal().generic_string();
+    while (!key.empty() && key.back() == '/') {
+        key.pop_back();
+    }
+    return key == "." ? "" : key;
 }
 
-}    // namespace
+std::map<std::string, std::vector<std::filesystem::path>, std::less<>>
+BuildSubdirIndex(const std::vector<std::filesystem::path>& paths) {
+    std::map<std::string, std::vector<std::filesystem::path>, std::less<>> index;
+    for (const auto& path : paths) {
+        for (auto dir = path.parent_path();; dir = dir.parent_path()) {
+            index[NormalizeSubdir(dir)].push_back(path.lexically_relative(dir));
+            if (dir.empty()) {
+                break;
+            }
+        }
+    }
+    return index;
+}
+
+QueriesManager::QueriesManager(const std::filesystem::path& sql_dir)
+    : sql_dir_(sql_dir), current_(Load(nullptr)) {}
 
-QueriesManager::QueriesManager(const std::filesystem::path& sql_dir) {
-    for (const auto& it : std::filesystem::recursive_directory_iterator(sql_dir)) {
+std::unique_ptr<QueriesManager::Snapshot>
+QueriesManager::Load(const Snapshot* previous) const {
+    std::vector<std::pair<std::filesystem::path, std::string>> files;
+    size_t arena_size = 0;
+
+    for (const auto& it : std::filesystem::recursive_directory_iterator(sql_dir_)) {
         if (!IsSqlFile(it)) {
             continue;
         }
 
         std::filesystem::path full_path = it.path();
-        std::filesystem::path relative_path = full_path.lexically_relative(sql_dir);
+        std::filesystem::path relative_path = full_path.lexically_relative(sql_dir_);
 
-        storage_[relative_path.string()] = ReadFile(full_path);
-        spdlog::debug("Found sql script = {}", relative_path.string());
+        files.emplace_back(relative_path, ReadFile(full_path));
+        arena_size += files.back().second.size() + 1;
+        SPDLOG_DEBUG("Found sql script = {}", relative_path.string());
     }
+
+    std::sort(files.begin(), files.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+    auto snapshot = std::make_unique<Snapshot>();
+    snapshot->generation = previous ? previous->generation + 1 : 0;
+    snapshot->arena.reserve(arena_size);
+
+    std::vector<size_t> offsets;
+    for (const auto& [path, script] : files) {
+        offsets.push_back(snapshot->arena.size());
+        snapshot->arena.append(script);
+        snapshot->arena.push_back('\0');
+    }
+
+    std::vector<std::filesystem::path> paths;
+    for (size_t i = 0; i < files.size(); ++i) {
+        const auto& [path, script] = files[i];
+        std::string_view text =
+            std::string_view(snapshot->arena).substr(offsets[i], script.size());
+
+        uint64_t revision = snapshot->generation;
+        if (previous) {
+            auto old = previous->scripts.find(path.string());
+            if (old != previous->scripts.end() && old->second.text == text) {
+                revision = old->second.revision;
+            }
+        }
+
+        snapshot->scripts.emplace(path.string(), Script{text, revision});
+        paths.push_back(path);
+    }
+    snapshot->subdirs = BuildSubdirIndex(paths);
+    return snapshot;
 }
 
-std::string QueriesManager::Get(const std::string& path) {
-    auto it = storage_.find(path);
-    if (it == storage_.end()) {
-        throw std::runtime_error("Sql script = " + path + " not found");
+bool QueriesManager::Reload() {
+    std::lock_guard lock(reload_mutex_);
+    std::shared_ptr<const Snapshot> previous = current_.load();
+
+    std::unique_ptr<Snapshot> snapshot;
+    try {
+        snapshot = Load(previous.get());
+    } catch (std::exception& ex) {
+        spdlog::error("Failed to reload sql scripts from {}. Error = {}",
+                      sql_dir_.string(), ex.what());
+        return false;
     }
-    return it->second;
+
+    bool is_changed = snapshot->scripts.size() != previous->scripts.size() ||
+                      std::ranges::any_of(snapshot->scripts, [&](const auto& item) {
+                          return item.second.revision == snapshot->generation;
+                      });
+    if (!is_changed) {
+        return false;
+    }
+
+    spdlog::info("Reloaded sql scripts. Generation = {}", snapshot->generation);
+    current_.store(std::move(snapshot));
+    return true;
+}
+
+std::string QueriesManager::Get(const std::string& path) {
+    std::shared_ptr<const Snapshot> snapshot = current_.load();
+    return std::string(Find(*snapshot, path).text);
+}
+
+ScriptView QueriesManager::GetView(std::string_view path) {
+    std::shared_ptr<const Snapshot> snapshot = current_.load();
+    std::string_view text = Find(*snapshot, path).text;
+    return ScriptView(text, std::move(snapshot));
 }
 
 std::vector<std::filesystem::path>
 QueriesManager::ListSubdirFiles(const std::filesystem::path& subdir) {
-    std::vector<std::filesystem::path> res;
-    for (const auto& it : storage_) {
-        if (IsParent(subdir, it.first)) {
-            res.push_back(it.first.lexically_relative(subdir));
-        }
+    std::shared_ptr<const Snapshot> snapshot = current_.load();
+    auto it = snapshot->subdirs.find(NormalizeSubdir(subdir));
+    if (it == snapshot->subdirs.end()) {
+        return {};
     }
+    return it->second;
+}
+
+uint64_t QueriesManager::Generation() { return current_.load()->generation; }
 
-    std::sort(res.begin(), res.end());
-    return res;
+uint64_t QueriesManager::Revision(std::string_view path) {
+    std::shared_ptr<const Snapshot> snapshot = current_.load();
+    auto it = snapshot->scripts.find(path);
+    return it == snapshot->scripts.end() ? snapshot->generation : it->second.revision;
+}
+
+const QueriesManager::Script& QueriesManager::Find(const Snapshot& snapshot,
+                                                   std::string_view path) {
+    auto it = snapshot.scripts.find(path);
+    if (it == snapshot.scripts.end()) {
+        throw std::runtime_error("Sql script = " + std::string(path) + " not found");
+    }
+    return it->second;
 }
 
 }    // namespace bot
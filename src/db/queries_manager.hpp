@@ -1,33 +1,127 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace bot {
 
+/// Script text together with whatever keeps it alive, e.g. the snapshot it was read
+/// from. The text is NUL-terminated and valid while the view exists, however many
+/// reloads happen meanwhile. Text() is only callable on a named view, so a
+/// string_view cannot outlive the owner.
+class ScriptView final {
+private:
+    std::string_view text_;
+    std::shared_ptr<const void> owner_;
+
+public:
+    ScriptView() = default;
+    explicit ScriptView(std::string_view text,
+                        std::shared_ptr<const void> owner = nullptr)
+        : text_(text), owner_(std::move(owner)) {}
+
+    std::string_view Text() const& { return text_; }
+    std::string_view Text() const&& = delete;
+
+    friend bool operator==(const ScriptView& lhs, std::string_view rhs) {
+        return lhs.text_ == rhs;
+    }
+};
+
 class IQueriesManager {
 public:
     virtual std::string Get(const std::string& path) = 0;
 
+    /// Zero-copy lookup
+    virtual ScriptView GetView(std::string_view path) = 0;
+
     virtual std::vector<std::filesystem::path>
     ListSubdirFiles(const std::filesystem::path& subdir) = 0;
 
+    /// Bumped every time a reload changed any script. Static managers stay at 0.
+    virtual uint64_t Generation() { return 0; }
+
+    /// Generation in which the script at path last changed
+    virtual uint64_t Revision(std::string_view path) { return 0; }
+
     virtual ~IQueriesManager() = default;
 };
 
+/// "migrations/", "./migrations" and "migrations" all address the same index entry
+std::string NormalizeSubdir(const std::filesystem::path& subdir);
+
+/// Maps every directory of the given relative script paths, including the root "",
+/// to the scripts below it
+std::map<std::string, std::vector<std::filesystem::path>, std::less<>>
+BuildSubdirIndex(const std::vector<std::filesystem::path>& paths);
+
+struct TransparentStringHash {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view str) const {
+        return std::hash<std::string_view>{}(str);
+    }
+};
+
+/// Scripts read from a directory. Reload() rebuilds the table into a new immutable
+/// snapshot and publishes it with one atomic shared_ptr store. Every lookup holds a
+/// reference to the snapshot it read, and views keep theirs, so a replaced snapshot is
+/// freed once its last reader is done with it.
 class QueriesManager final : public IQueriesManager {
 private:
-    std::unordered_map<std::filesystem::path, std::string> storage_;
+    struct Script {
+        std::string_view text;
+        uint64_t revision;
+    };
+
+    struct Snapshot {
+        std::string arena;    ///< Every script back to back, each followed by '\0'
+        std::unordered_map<std::string, Script, TransparentStringHash, std::equal_to<>>
+            scripts;
+        std::map<std::string, std::vector<std::filesystem::path>, std::less<>> subdirs;
+        uint64_t generation = 0;
+    };
+
+    std::filesystem::path sql_dir_;
+    std::atomic<std::shared_ptr<const Snapshot>> current_;
+    std::mutex reload_mutex_;
 
 public:
     QueriesManager(const std::filesystem::path& sql_dir);
 
+    /// Views point into snapshots owned by this instance
+    QueriesManager(const QueriesManager&) = delete;
+    QueriesManager& operator=(const QueriesManager&) = delete;
+
     std::string Get(const std::string& path) override;
 
+    ScriptView GetView(std::string_view path) override;
+
     std::vector<std::filesystem::path>
     ListSubdirFiles(const std::filesystem::path& subdir) override;
+
+    uint64_t Generation() override;
+    uint64_t Revision(std::string_view path) override;
+
+    /// Re-reads the directory. Returns true when any script was added, changed or
+    /// removed. On failure the current snapshot stays published.
+    bool Reload();
+
+private:
+    std::unique_ptr<Snapshot> Load(const Snapshot* previous) const;
+    /// The script's entry in the current snapshot; throws when there is none
+    static const Script& Find(const Snapshot& snapshot, std::string_view path);
 };
 
 }    // namespace bot
@@ -0,0 +1,119 @@
+#include "sql_dir_watcher.hpp"
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <poll.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace bot {
+
+namespace {
+
+constexpr uint32_t kWatchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE |
+                                IN_DELETE | IN_DELETE_SELF;
+
+/// How often the loop wakes up to check for a stop request
+constexpr std::chrono::milliseconds kPollTimeout(100);
+
+}    // namespace
+
+SqlDirWatcher::SqlDirWatcher(const std::filesystem::path& dir,
+                             std::function<void()> on_change,
+                             std::chrono::milliseconds debounce, bool is_background)
+    : dir_(dir), on_change_(std::move(on_change)), debounce_(debounce) {
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ < 0) {
+        throw std::runtime_error("inotify_init1 failed: " +
+                                 std::string(std::strerror(errno)));
+    }
+    AddWatches();
+    spdlog::info("Watching sql scripts in {}", dir_.string());
+
+    if (is_background) {
+        worker_ = std::jthread([this](std::stop_token stop) { Loop(stop); });
+    }
+}
+
+SqlDirWatcher::~SqlDirWatcher() {
+    worker_.request_stop();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    close(inotify_fd_);
+}
+
+void SqlDirWatcher::AddWatches() {
+    auto add = [this](const std::filesystem::path& path) {
+        int wd = inotify_add_watch(inotify_fd_, path.c_str(), kWatchMask);
+        if (wd < 0) {
+            spdlog::warn("Failed to watch {}. Error = {}", path.string(),
+                         std::strerror(errno));
+            return;
+        }
+        watches_[wd] = path;
+    };
+
+    add(dir_);
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(dir_)) {
+        if (entry.is_directory()) {
+            add(entry.path());
+        }
+    }
+}
+
+void SqlDirWatcher::Loop(std::stop_token stop) {
+    while (!stop.stop_requested()) {
+        Poll(kPollTimeout);
+    }
+}
+
+bool SqlDirWatcher::Poll(std::chrono::milliseconds timeout) {
+    alignas(inotify_event) std::array<char, 16 * 1024> buffer;
+
+    pollfd fd{inotify_fd_, POLLIN, 0};
+    if (poll(&fd, 1, static_cast<int>(timeout.count())) > 0) {
+        bool is_tree_changed = false;
+        ssize_t length;
+        while ((length = read(inotify_fd_, buffer.data(), buffer.size())) > 0) {
+            for (ssize_t offset = 0; offset < length;) {
+                const auto* event =
+                    reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+                if (event->mask & IN_IGNORED) {
+                    watches_.erase(event->wd);
+                }
+                bool is_new_entry = event->mask & (IN_CREATE | IN_MOVED_TO);
+                if ((event->mask & IN_ISDIR) && is_new_entry) {
+                    is_tree_changed = true;
+                }
+                offset += sizeof(inotify_event) + event->len;
+            }
+        }
+        if (is_tree_changed) {
+            AddWatches();
+        }
+        is_dirty_ = true;
+        last_event_ = Clock::now();
+    }
+
+    if (!is_dirty_ || Clock::now() - last_event_ < debounce_) {
+        return false;
+    }
+    is_dirty_ = false;
+
+    try {
+        on_change_();
+    } catch (std::exception& ex) {
+        spdlog::error("Failed to apply sql changes. Error = {}", ex.what());
+    }
+    return true;
+}
+
+}    // namespace bot
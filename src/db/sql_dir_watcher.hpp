@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <stop_token>
+#include <thread>
+#include <unordered_map>
+
+namespace bot {
+
+/// Watches a directory tree with inotify and calls on_change from a background thread
+/// once events stop arriving for the debounce interval, so an editor saving several
+/// files triggers a single reload. New subdirectories are picked up automatically.
+class SqlDirWatcher final {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::filesystem::path dir_;
+    std::function<void()> on_change_;
+    std::chrono::milliseconds debounce_;
+
+    int inotify_fd_ = -1;
+    std::unordered_map<int, std::filesystem::path> watches_;
+    bool is_dirty_ = false;
+    Clock::time_point last_event_;
+    std::jthread worker_;
+
+public:
+    /// Without a background thread nothing happens until the owner calls Poll
+    SqlDirWatcher(const std::filesystem::path& dir, std::function<void()> on_change,
+                  std::chrono::milliseconds debounce = std::chrono::milliseconds(200),
+                  bool is_background = true);
+    ~SqlDirWatcher();
+
+    SqlDirWatcher(const SqlDirWatcher&) = delete;
+    SqlDirWatcher& operator=(const SqlDirWatcher&) = delete;
+
+    /// Waits up to timeout for events and calls on_change when the last one is older
+    /// than the debounce interval. Returns true when on_change was called. Only for
+    /// watchers without a background thread.
+    bool Poll(std::chrono::milliseconds timeout);
+
+private:
+    void AddWatches();
+    void Loop(std::stop_token stop);
+};
+
+}    // namespace bot
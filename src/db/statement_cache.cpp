@@ -0,0 +1,71 @@
+#include "statement_cache.hpp"
+#include <SQLiteCpp/Statement.h>
+#include <memory>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <string>
+
+namespace bot {
+
+StatementCache::StatementCache(const std::shared_ptr<SQLite::Database>& db,
+                               const std::shared_ptr<IQueriesManager>& queries_manager,
+                               size_t capacity)
+    : db_(db), queries_manager_(queries_manager), capacity_(capacity),
+      generation_(queries_manager->Generation()) {
+    if (capacity_ == 0) {
+        throw std::invalid_argument("Statement cache capacity must be positive");
+    }
+}
+
+std::shared_ptr<SQLite::Statement> StatementCache::Acquire(const std::string& path) {
+    if (queries_manager_->Generation() != generation_) {
+        DropChangedScripts();
+    }
+
+    auto it = index_.find(path);
+    if (it != index_.end()) {
+        ++hits_;
+        lru_.splice(lru_.begin(), lru_, it->second);
+
+        auto& statement = it->second->statement;
+        statement->reset();
+        statement->clearBindings();
+        return statement;
+    }
+
+    ++misses_;
+    uint64_t revision = queries_manager_->Revision(path);
+    auto statement =
+        std::make_shared<SQLite::Statement>(*db_, queries_manager_->Get(path));
+
+    lru_.push_front(Entry{path, statement, revision});
+    index_[path] = lru_.begin();
+
+    if (lru_.size() > capacity_) {
+        SPDLOG_TRACE("Evict prepared statement = {}", lru_.back().path);
+        index_.erase(lru_.back().path);
+        lru_.pop_back();
+    }
+
+    return statement;
+}
+
+void StatementCache::DropChangedScripts() {
+    generation_ = queries_manager_->Generation();
+    for (auto it = lru_.begin(); it != lru_.end();) {
+        if (queries_manager_->Revision(it->path) == it->revision) {
+            ++it;
+            continue;
+        }
+        SPDLOG_DEBUG("Drop prepared statement = {}, script changed", it->path);
+        index_.erase(it->path);
+        it = lru_.erase(it);
+    }
+}
+
+void StatementCache::Clear() {
+    index_.clear();
+    lru_.clear();
+}
+
+}    // namespace bot
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "db/queries_manager.hpp"
+#include <SQLiteCpp/Database.h>
+#include <SQLiteCpp/Statement.h>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace bot {
+
+static const size_t kDefaultStatementCacheCapacity = 64;
+
+/// Prepared statements of a single connection, keyed by the script path in
+/// IQueriesManager (e.g. "internal/get_applied_migrations.sql"). Not thread-safe: a cache
+/// belongs to its connection and is used by whoever holds that connection.
+class StatementCache final {
+private:
+    struct Entry {
+        std::string path;
+        std::shared_ptr<SQLite::Statement> statement;
+        uint64_t revision;
+    };
+
+    std::shared_ptr<SQLite::Database> db_;
+    std::shared_ptr<IQueriesManager> queries_manager_;
+    size_t capacity_;
+
+    std::list<Entry> lru_;    ///< Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+
+    uint64_t generation_;    ///< Script generation the entries were last checked at
+
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+
+public:
+    StatementCache(const std::shared_ptr<SQLite::Database>& db,
+                   const std::shared_ptr<IQueriesManager>& queries_manager,
+                   size_t capacity = kDefaultStatementCacheCapacity);
+
+    /// Returns a reset statement with cleared bindings. An evicted statement stays
+    /// valid for as long as the caller keeps the returned pointer. Statements whose
+    /// script changed in a reload are prepared again.
+    std::shared_ptr<SQLite::Statement> Acquire(const std::string& path);
+
+    void Clear();
+
+    size_t Size() const { return lru_.size(); }
+    uint64_t Hits() const { return hits_; }
+    uint64_t Misses() const { return misses_; }
+
+private:
+    void DropChangedScripts();
+};
+
+}    // namespace bot
@@ -0,0 +1,250 @@
+#include "user_cache.hpp"
+#include "metrics/metrics.hpp"
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace bot {
+
+namespace {
+
+struct UserCacheMetrics {
+    Counter& hits = Metrics().GetCounter("user_cache_lookups_total",
+                                         "User lookups by result", {{"result", "hit"}});
+    Counter& negative_hits = Metrics().GetCounter(
+        "user_cache_lookups_total", "User lookups by result", {{"result", "unknown"}});
+    Counter& misses = Metrics().GetCounter(
+        "user_cache_lookups_total", "User lookups by result", {{"result", "miss"}});
+};
+
+UserCacheMetrics& GetUserCacheMetrics() {
+    static UserCacheMetrics metrics;
+    return metrics;
+}
+
+CachedUser ReadUser(SQLite::Statement& select) {
+    CachedUser user;
+    user.id = select.getColumn(0).getInt64();
+    user.username = select.getColumn(1).getString();
+    user.role = select.getColumn(2).getString();
+    if (!select.getColumn(3).isNull()) {
+        user.tg_id = select.getColumn(3).getInt64();
+    }
+    return user;
+}
+
+}    // namespace
+
+UserCacheConfig MakeUserCacheConfig(IEnvManager& env) {
+    UserCacheConfig config;
+    config.max_users = std::stoul(env.Get("USER_CACHE_MAX"));
+    config.negative_ttl =
+        std::chrono::seconds(std::stol(env.Get("USER_CACHE_NEGATIVE_TTL_SEC")));
+    return config;
+}
+
+UserCache::UserCache(const std::shared_ptr<ConnectionPool>& pool,
+                     const UserCacheConfig& config)
+    : pool_(pool), config_(config) {}
+
+size_t UserCache::WarmUp() {
+    std::vector<UserPtr> users;
+    {
+        ConnectionLease reader = pool_->AcquireReader();
+        auto select = reader.Statements()->Acquire(config_.get_users);
+        select->bind(1, static_cast<int64_t>(config_.max_users));
+        while (select->executeStep()) {
+            users.push_back(std::make_shared<const CachedUser>(ReadUser(*select)));
+        }
+        select->reset();
+    }
+
+    std::unique_lock lock(mutex_);
+    for (auto& user : users) {
+        Store(std::move(user));
+    }
+    spdlog::info("Warmed up user cache with {} users", users.size());
+    return users.size();
+}
+
+UserCache::UserPtr UserCache::FindByTgId(int64_t tg_id) {
+    return Find(tg_id, by_tg_id_, unknown_tg_ids_, config_.get_by_tg_id);
+}
+
+UserCache::UserPtr UserCache::FindByUsername(std::string_view username) {
+    return Find(username, by_username_, unknown_usernames_, config_.get_by_username);
+}
+
+void UserCache::Invalidate(const UserRecord& record) {
+    std::unique_lock lock(mutex_);
+    ++generation_;
+    invalidations_.fetch_add(1, std::memory_order_relaxed);
+
+    if (auto it = by_username_.find(record.username); it != by_username_.end()) {
+        Erase(it->second);
+    }
+    unknown_usernames_.erase(record.username);
+    if (record.tg_id) {
+        if (auto it = by_tg_id_.find(*record.tg_id); it != by_tg_id_.end()) {
+            Erase(it->second);
+        }
+        unknown_tg_ids_.erase(*record.tg_id);
+    }
+}
+
+void UserCache::InvalidateAll() {
+    std::unique_lock lock(mutex_);
+    ++generation_;
+    invalidations_.fetch_add(1, std::memory_order_relaxed);
+    by_tg_id_.clear();
+    by_username_.clear();
+    entries_.clear();
+    hand_ = entries_.end();
+    unknown_tg_ids_.clear();
+    unknown_usernames_.clear();
+}
+
+UserCacheStats UserCache::Stats() const {
+    UserCacheStats stats;
+    {
+        std::shared_lock lock(mutex_);
+        stats.users = entries_.size();
+    }
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.negative_hits = negative_hits_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_relaxed);
+    stats.invalidations = invalidations_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+template <typename Key, typename Users, typename Unknown>
+UserCache::UserPtr UserCache::Find(const Key& key, Users& users, Unknown& unknown,
+                                   const std::string& sql) {
+    uint64_t generation = 0;
+    {
+        std::shared_lock lock(mutex_);
+        if (auto it = users.find(key); it != users.end()) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            GetUserCacheMetrics().hits.Add();
+            it->second->is_referenced.store(true, std::memory_order_relaxed);
+            return it->second->user;
+        }
+        auto unknown_it = unknown.find(key);
+        if (unknown_it != unknown.end() && unknown_it->second > Clock::now()) {
+            negative_hits_.fetch_add(1, std::memory_order_relaxed);
+            GetUserCacheMetrics().negative_hits.Add();
+            return nullptr;
+        }
+        generation = generation_;
+    }
+
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    GetUserCacheMetrics().misses.Add();
+    std::optional<CachedUser> loaded = Load(sql, [&key](SQLite::Statement& select) {
+        if constexpr (std::is_same_v<Key, std::string_view>) {
+            select.bind(1, std::string(key));
+        } else {
+            select.bind(1, key);
+        }
+    });
+    UserPtr user;
+    if (loaded) {
+        user = std::make_shared<const CachedUser>(std::move(*loaded));
+    }
+
+    std::unique_lock lock(mutex_);
+    // A write committed while loading may not be in the row that was read
+    if (generation != generation_) {
+        return user;
+    }
+    if (user) {
+        Store(user);
+    } else {
+        RememberUnknown(unknown, key);
+    }
+    return user;
+}
+
+std::optional<CachedUser>
+UserCache::Load(const std::string& sql,
+                const std::function<void(SQLite::Statement&)>& bind) {
+    ConnectionLease reader = pool_->AcquireReader();
+    auto select = reader.Statements()->Acquire(sql);
+    bind(*select);
+    std::optional<CachedUser> user;
+    if (select->executeStep()) {
+        user = ReadUser(*select);
+    }
+    select->reset();
+    return user;
+}
+
+void UserCache::Store(UserPtr user) {
+    if (auto it = by_username_.find(user->username); it != by_username_.end()) {
+        Erase(it->second);
+    }
+    if (user->tg_id) {
+        if (auto it = by_tg_id_.find(*user->tg_id); it != by_tg_id_.end()) {
+            Erase(it->second);
+        }
+    }
+    if (entries_.size() >= config_.max_users && !entries_.empty()) {
+        EvictOne();
+    }
+
+    unknown_usernames_.erase(user->username);
+    if (user->tg_id) {
+        unknown_tg_ids_.erase(*user->tg_id);
+    }
+    // Inserted behind the hand, so a new user gets a full turn before eviction
+    Slot slot = entries_.emplace(hand_, std::move(user));
+    if (slot->user->tg_id) {
+        by_tg_id_[*slot->user->tg_id] = slot;
+    }
+    by_username_[slot->user->username] = slot;
+}
+
+void UserCache::Erase(Slot slot) {
+    by_username_.erase(slot->user->username);
+    if (slot->user->tg_id) {
+        auto it = by_tg_id_.find(*slot->user->tg_id);
+        if (it != by_tg_id_.end() && it->second == slot) {
+            by_tg_id_.erase(it);
+        }
+    }
+    if (hand_ == slot) {
+        ++hand_;
+    }
+    entries_.erase(slot);
+}
+
+void UserCache::EvictOne() {
+    // Ends within two turns: the first one clears every flag it passes
+    while (true) {
+        if (hand_ == entries_.end()) {
+            hand_ = entries_.begin();
+        }
+        if (!hand_->is_referenced.exchange(false, std::memory_order_relaxed)) {
+            Erase(hand_);
+            return;
+        }
+        ++hand_;
+    }
+}
+
+template <typename Unknown, typename Key>
+void UserCache::RememberUnknown(Unknown& unknown, const Key& key) {
+    auto now = Clock::now();
+    if (unknown.size() >= config_.max_users) {
+        std::erase_if(unknown, [now](const auto& entry) { return entry.second <= now; });
+    }
+    if (unknown.size() >= config_.max_users) {
+        unknown.clear();
+    }
+    unknown.insert_or_assign(typename Unknown::key_type(key), now + config_.negative_ttl);
+}
+
+}    // namespace bot
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "db/connection_pool.hpp"
+#include "db/user_write_behind.hpp"
+#include "env/env_manager.hpp"
+#include <SQLiteCpp/Statement.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace bot {
+
+struct CachedUser {
+    int64_t id = 0;
+    std::string username;
+    std::string role;
+    std::optional<int64_t> tg_id;
+};
+
+struct UserCacheConfig {
+    size_t max_users = 100000;    ///< Also bounds each table of unknown keys
+    std::chrono::seconds negative_ttl{60};    ///< How long an unknown user stays unknown
+    std::string get_by_tg_id = "dao/get_user_by_tg_id.sql";
+    std::string get_by_username = "dao/get_user_by_username.sql";
+    std::string get_users = "dao/get_users.sql";
+};
+
+UserCacheConfig MakeUserCacheConfig(IEnvManager& env);
+
+struct UserCacheStats {
+    size_t users = 0;
+    uint64_t hits = 0;
+    uint64_t negative_hits = 0;    ///< Answered "unknown" without a query
+    uint64_t misses = 0;
+    uint64_t invalidations = 0;
+};
+
+/// Read-through cache of user_ rows by Telegram id and by username, so per-message
+/// authorization does not query SQLite. Hits take a shared lock only. Misses are
+/// loaded from a reader connection; users that do not exist are remembered for
+/// negative_ttl. Writers must call Invalidate after committing a change to user_
+/// (UserWriteBehind does it through its hook) and InvalidateAll after bulk changes
+/// such as online migrations. A load that overlaps an invalidation is not cached.
+/// Over max_users the least recently used user is evicted, approximated with the CLOCK
+/// algorithm: a hit only sets a flag, so it does not need the unique lock.
+class UserCache final {
+public:
+    using UserPtr = std::shared_ptr<const CachedUser>;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view key) const {
+            return std::hash<std::string_view>{}(key);
+        }
+    };
+
+    template <typename Value>
+    using StringMap = std::unordered_map<std::string, Value, StringHash, std::equal_to<>>;
+
+    struct Entry {
+        UserPtr user;
+        std::atomic<bool> is_referenced = false;    ///< Set by hits, cleared by the hand
+    };
+    using Slot = std::list<Entry>::iterator;
+
+    std::shared_ptr<ConnectionPool> pool_;
+    UserCacheConfig config_;
+
+    mutable std::shared_mutex mutex_;
+    std::list<Entry> entries_;    ///< Clock order
+    Slot hand_ = entries_.end();    ///< Next eviction candidate
+    std::unordered_map<int64_t, Slot> by_tg_id_;
+    StringMap<Slot> by_username_;
+    std::unordered_map<int64_t, Clock::time_point> unknown_tg_ids_;    ///< Until expiry
+    StringMap<Clock::time_point> unknown_usernames_;
+    uint64_t generation_ = 0;    ///< Bumped by every invalidation
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> negative_hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> invalidations_{0};
+
+public:
+    UserCache(const std::shared_ptr<ConnectionPool>& pool,
+              const UserCacheConfig& config = {});
+
+    /// Loads up to max_users of the newest users. Returns how many.
+    size_t WarmUp();
+
+    /// nullptr when there is no such user
+    UserPtr FindByTgId(int64_t tg_id);
+    UserPtr FindByUsername(std::string_view username);
+
+    /// Drops the user with the username or tg_id of the record
+    void Invalidate(const UserRecord& record);
+    void InvalidateAll();
+
+    UserCacheStats Stats() const;
+
+private:
+    template <typename Key, typename Users, typename Unknown>
+    UserPtr Find(const Key& key, Users& users, Unknown& unknown, const std::string& sql);
+
+    std::optional<CachedUser> Load(const std::string& sql,
+                                   const std::function<void(SQLite::Statement&)>& bind);
+
+    /// Expect the unique lock to be held
+    void Store(UserPtr user);
+    void Erase(Slot slot);
+    void EvictOne();
+    template <typename Unknown, typename Key>
+    void RememberUnknown(Unknown& unknown, const Key& key);
+};
+
+}    // namespace bot
@@ -0,0 +1,234 @@
+#include "user_write_behind.hpp"
+#include "metrics/metrics.hpp"
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <SQLiteCpp/Transaction.h>
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bot {
+
+namespace {
+
+struct WriteBehindMetrics {
+    Histogram& flush_duration = Metrics().GetHistogram(
+        "user_write_flush_duration_seconds", "User write-behind flush latency");
+    Histogram& batch_size = Metrics().GetHistogram(
+        "user_write_batch_size", "Rows per user write-behind flush", {}, 1);
+    Counter& failed_rows = Metrics().GetCounter(
+        "user_write_failed_rows_total", "User upserts that failed on their own");
+};
+
+WriteBehindMetrics& GetWriteBehindMetrics() {
+    static WriteBehindMetrics metrics;
+    return metrics;
+}
+
+template <typename T>
+void BindOptional(SQLite::Statement& statement, int index,
+                  const std::optional<T>& value) {
+    if (value) {
+        statement.bind(index, *value);
+    } else {
+        statement.bind(index);
+    }
+}
+
+}    // namespace
+
+WriteBehindConfig MakeWriteBehindConfig(IEnvManager& env) {
+    WriteBehindConfig config;
+    config.max_batch = std::stoul(env.Get("USER_WRITE_BATCH"));
+    config.flush_interval =
+        std::chrono::milliseconds(std::stoul(env.Get("USER_WRITE_FLUSH_MS")));
+    return config;
+}
+
+UserWriteBehind::UserWriteBehind(const std::shared_ptr<ConnectionPool>& pool,
+                                 const WriteBehindConfig& config,
+                                 UserWrittenHook on_written)
+    : pool_(pool), config_(config), on_written_(std::move(on_written)) {
+    if (config_.max_batch == 0) {
+        throw std::invalid_argument("Write-behind batch size must be positive");
+    }
+    flusher_ = std::thread(&UserWriteBehind::FlusherLoop, this);
+}
+
+UserWriteBehind::~UserWriteBehind() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    flusher_.join();
+    Flush();
+}
+
+std::future<void> UserWriteBehind::Upsert(UserRecord record) {
+    std::promise<void> promise;
+    std::future<void> future = promise.get_future();
+
+    bool is_full = false;
+    {
+        std::lock_guard lock(mutex_);
+        auto it = pending_index_.find(record.username);
+        if (it == pending_index_.end()) {
+            pending_index_.emplace(record.username, pending_.size());
+            pending_.push_back(PendingWrite{std::move(record), {}});
+            pending_.back().waiters.push_back(std::move(promise));
+        } else {
+            PendingWrite& write = pending_[it->second];
+            if (record.email) {
+                write.record.email = std::move(record.email);
+            }
+            if (record.role) {
+                write.record.role = std::move(record.role);
+            }
+            if (record.tg_id) {
+                write.record.tg_id = record.tg_id;
+            }
+            write.waiters.push_back(std::move(promise));
+            ++stats_.writes_coalesced;
+        }
+        is_full = pending_.size() >= config_.max_batch;
+    }
+
+    if (is_full) {
+        cv_.notify_one();
+    }
+    return future;
+}
+
+void UserWriteBehind::Flush() {
+    std::lock_guard flush_lock(flush_mutex_);
+    std::vector<PendingWrite> batch = TakePending();
+    if (!batch.empty()) {
+        Write(batch);
+    }
+}
+
+WriteBehindStats UserWriteBehind::Stats() {
+    std::lock_guard lock(mutex_);
+    return stats_;
+}
+
+void UserWriteBehind::FlusherLoop() {
+    std::unique_lock lock(mutex_);
+    while (!stopping_) {
+        cv_.wait_for(lock, config_.flush_interval, [this] {
+            return stopping_ || pending_.size() >= config_.max_batch;
+        });
+        if (pending_.empty()) {
+            continue;
+        }
+
+        lock.unlock();
+        Flush();
+        lock.lock();
+    }
+}
+
+std::vector<UserWriteBehind::PendingWrite> UserWriteBehind::TakePending() {
+    std::lock_guard lock(mutex_);
+    pending_index_.clear();
+    return std::exchange(pending_, {});
+}
+
+void UserWriteBehind::Write(std::vector<PendingWrite>& batch) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::exception_ptr> errors(batch.size());
+    bool is_failed = false;
+    uint64_t failed_rows = 0;
+
+    try {
+        Commit(batch);
+    } catch (const std::exception& ex) {
+        spdlog::error("Failed to flush {} user writes = {}", batch.size(), ex.what());
+        is_failed = true;
+        if (batch.size() == 1) {
+            errors.front() = std::current_exception();
+            failed_rows = 1;
+        }
+    }
+
+    // One bad row must not fail the writes that were merely batched with it
+    if (is_failed && batch.size() > 1) {
+        for (size_t i = 0; i < batch.size(); ++i) {
+            try {
+                Commit(std::span(batch).subspan(i, 1));
+            } catch (const std::exception& ex) {
+                spdlog::error("Failed to write user = {}: {}", batch[i].record.username,
+                              ex.what());
+                errors[i] = std::current_exception();
+                ++failed_rows;
+            }
+        }
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+    WriteBehindMetrics& metrics = GetWriteBehindMetrics();
+    metrics.flush_duration.Record(elapsed);
+    metrics.batch_size.Record(batch.size());
+    metrics.failed_rows.Add(failed_rows);
+    {
+        std::lock_guard lock(mutex_);
+        ++stats_.flushes;
+        stats_.last_batch_size = batch.size();
+        stats_.max_batch_size = std::max(stats_.max_batch_size, batch.size());
+        stats_.flush_latency_total += elapsed;
+        stats_.flush_latency_max = std::max(stats_.flush_latency_max, elapsed);
+        if (is_failed) {
+            ++stats_.failed_flushes;
+        }
+        stats_.failed_rows += failed_rows;
+        stats_.rows_written += batch.size() - failed_rows;
+    }
+
+    // Before the waiters wake up, so they do not read what the hook replaces
+    if (on_written_) {
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (!errors[i]) {
+                on_written_(batch[i].record);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        for (auto& waiter : batch[i].waiters) {
+            if (errors[i]) {
+                waiter.set_exception(errors[i]);
+            } else {
+                waiter.set_value();
+            }
+        }
+    }
+}
+
+void UserWriteBehind::Commit(std::span<const PendingWrite> writes) {
+    ConnectionLease writer = pool_->AcquireWriter();
+    SQLite::Transaction transaction(*writer);
+    auto upsert = writer.Statements()->Acquire(config_.upsert_user);
+
+    for (const auto& write : writes) {
+        upsert->reset();
+        upsert->bind(1, write.record.username);
+        BindOptional(*upsert, 2, write.record.email);
+        BindOptional(*upsert, 3, write.record.role);
+        BindOptional(*upsert, 4, write.record.tg_id);
+        upsert->exec();
+    }
+
+    transaction.commit();
+}
+
+}    // namespace bot
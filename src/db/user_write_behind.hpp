@@ -0,0 +1,103 @@
+#pragma once
+
+#include "db/connection_pool.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace bot {
+
+/// A user_ upsert. Unset fields keep the stored value (or the column default).
+struct UserRecord {
+    std::string username;
+    std::optional<std::string> email;
+    std::optional<std::string> role;
+    std::optional<int64_t> tg_id;    ///< Telegram chat of the user, used by broadcasts
+};
+
+struct WriteBehindConfig {
+    size_t max_batch = 256;
+    std::chrono::milliseconds flush_interval{50};
+    std::string upsert_user = "dao/upsert_user.sql";
+};
+
+WriteBehindConfig MakeWriteBehindConfig(IEnvManager& env);
+
+/// Called for every record of a committed batch, e.g. to invalidate cached users
+using UserWrittenHook = std::function<void(const UserRecord&)>;
+
+struct WriteBehindStats {
+    uint64_t flushes = 0;
+    uint64_t failed_flushes = 0;    ///< Batches whose transaction was rolled back
+    uint64_t failed_rows = 0;    ///< Rows that failed on their own as well
+    uint64_t rows_written = 0;
+    uint64_t writes_coalesced = 0;
+    size_t last_batch_size = 0;
+    size_t max_batch_size = 0;
+    std::chrono::nanoseconds flush_latency_total{0};
+    std::chrono::nanoseconds flush_latency_max{0};
+};
+
+/// Collects user_ upserts from many threads and writes them in one transaction once
+/// max_batch rows are pending or flush_interval has passed. Repeated writes to the
+/// same username are merged into one row before the flush. When the transaction fails
+/// the rows are retried one by one, so only the futures of the failing rows get the
+/// error.
+class UserWriteBehind final {
+private:
+    struct PendingWrite {
+        UserRecord record;
+        std::vector<std::promise<void>> waiters;
+    };
+
+    std::shared_ptr<ConnectionPool> pool_;
+    WriteBehindConfig config_;
+    UserWrittenHook on_written_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<PendingWrite> pending_;
+    std::unordered_map<std::string, size_t> pending_index_;    ///< username -> pending_
+    WriteBehindStats stats_;
+    bool stopping_ = false;
+
+    std::mutex flush_mutex_;    ///< Keeps batches committed in the order they were taken
+    std::thread flusher_;
+
+public:
+    UserWriteBehind(const std::shared_ptr<ConnectionPool>& pool,
+                    const WriteBehindConfig& config = {},
+                    UserWrittenHook on_written = {});
+    ~UserWriteBehind();
+
+    UserWriteBehind(const UserWriteBehind&) = delete;
+    UserWriteBehind& operator=(const UserWriteBehind&) = delete;
+
+    /// The future is ready once the write is committed
+    std::future<void> Upsert(UserRecord record);
+
+    /// Writes everything pending on the calling thread
+    void Flush();
+
+    WriteBehindStats Stats();
+
+private:
+    void FlusherLoop();
+    std::vector<PendingWrite> TakePending();
+    void Write(std::vector<PendingWrite>& batch);
+    /// Upserts the rows in one transaction; throws when any of them fails
+    void Commit(std::span<const PendingWrite> writes);
+};
+
+}    // namespace bot
@@ -1,10 +1,15 @@
 #pragma once
 
 #include "env/env_manager.hpp"    // NOLINT:
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <spdlog/spdlog.h>
+#include <stdexcept>
 #include <string>
 
 namespace bot {
@@ -21,13 +26,44 @@ namespace bot {
     di.Register<interface>(                  \
         [&](DiContainer& di) { return std::make_shared<type>(__VA_ARGS__); })
 
+constexpr size_t kMaxTypeSlots = 128;
+
+namespace detail {
+
+inline std::atomic<size_t> next_type_slot{0};
+
+}    // namespace detail
+
+/// Dense per-process index of T, assigned on first use
+template <typename T> size_t TypeSlot() {
+    static const size_t slot = detail::next_type_slot.fetch_add(1);
+    return slot;
+}
+
+/// Services registered by type live in fixed slots indexed by TypeSlot<T>(). A resolved
+/// instance is published once and read without locks; construction runs under a
+/// per-slot once_flag, so concurrent first calls build exactly one instance.
 class DiContainer {
 private:
+    using Factory = std::function<std::shared_ptr<void>(DiContainer&)>;
+
+    struct Slot {
+        Factory factory;
+        std::once_flag once;
+        std::shared_ptr<void> instance;
+        std::atomic<bool> is_ready = false;
+    };
+
+    std::unique_ptr<std::array<Slot, kMaxTypeSlots>> slots_ =
+        std::make_unique<std::array<Slot, kMaxTypeSlots>>();
+
+    std::mutex named_mutex_;
     std::map<std::string, std::shared_ptr<void>> instances_;
-    std::map<std::string, std::function<std::shared_ptr<void>(DiContainer&)>> factories_;
+    std::map<std::string, Factory> factories_;
 
 public:
     template <typename T> std::shared_ptr<T> Get(const std::string& name) {
+        std::unique_lock lock(named_mutex_);
         if (instances_.find(name) != instances_.end()) {
 
             return std::static_pointer_cast<T>(instances_.at(name));
@@ -37,43 +73,72 @@ public:
             throw std::runtime_error("Factory method for (" + name + ") does not exists");
         }
 
-        std::shared_ptr<void> instance = factories_[name](*this);
-
-        instances_[name] = instance;
+        Factory factory = factories_[name];
+        lock.unlock();
+        std::shared_ptr<void> instance = factory(*this);
+        lock.lock();
 
-        return std::static_pointer_cast<T>(instance);
+        auto [it, is_inserted] = instances_.try_emplace(name, instance);
+        return std::static_pointer_cast<T>(it->second);
     }
 
     template <typename T> std::shared_ptr<T> Get() {
-        std::string name = typeid(T).name();
-        return Get<T>(name);
+        Slot& slot = GetSlot<T>();
+        if (!slot.is_ready.load(std::memory_order_acquire)) {
+            Resolve<T>(slot);
+        }
+        return std::static_pointer_cast<T>(slot.instance);
     }
 
-    template <typename T>
-    void Register(const std::string& name,
-                  std::function<std::shared_ptr<void>(DiContainer&)> factory_method) {
-
+    template <typename T> void Register(const std::string& name, Factory factory_method) {
+        std::lock_guard lock(named_mutex_);
         if (factories_.find(name) != factories_.end()) {
             throw std::runtime_error("Type with name (" + name + ") already exists");
         }
         factories_[name] = factory_method;
     }
 
-    template <typename T>
-    void Register(std::function<std::shared_ptr<void>(DiContainer&)> factory_method) {
-        std::string name = typeid(T).name();
-        Register<T>(name, factory_method);
+    /// Registration is expected to finish before services are resolved concurrently
+    template <typename T> void Register(Factory factory_method) {
+        Slot& slot = GetSlot<T>();
+        if (slot.factory) {
+            throw std::runtime_error("Type with name (" + std::string(typeid(T).name()) +
+                                     ") already exists");
+        }
+        slot.factory = std::move(factory_method);
+    }
+
+private:
+    template <typename T> Slot& GetSlot() {
+        size_t index = TypeSlot<T>();
+        if (index >= kMaxTypeSlots) {
+            throw std::runtime_error("Too many registered types, raise kMaxTypeSlots");
+        }
+        return (*slots_)[index];
+    }
+
+    template <typename T> void Resolve(Slot& slot) {
+        if (!slot.factory) {
+            throw std::runtime_error("Factory method for (" +
+                                     std::string(typeid(T).name()) + ") does not exists");
+        }
+        std::call_once(slot.once, [&] {
+            slot.instance = slot.factory(*this);
+            slot.is_ready.store(true, std::memory_order_release);
+        });
     }
 };
 
+/// Service resolved once and kept by hot code, so per-update access is a plain
+/// pointer dereference
 template <typename T> struct Scoped {
 
     explicit Scoped(const std::shared_ptr<T>& ptr) : ptr(ptr) {}
 
     std::shared_ptr<T> ptr;
 
-    T* operator->() { return ptr.get(); }
-    T& operator*() { return *ptr.get(); }
+    T* operator->() const { return ptr.get(); }
+    T& operator*() const { return *ptr.get(); }
 };
 
 template <typename T> Scoped<T> Scope(DiContainer& c, std::string name) {
@@ -12,10 +12,51 @@ struct Env {
 };
 
 Env tokens[] = {
+    {"BOOTSTRAP_REPORT_PATH", true, ""},
     {"BOT_TOKEN", false},
+    {"BOT_USERNAME", true, ""},    ///< When set, "/cmd@other_bot" is ignored
+    {"BROADCAST_PAGE_SIZE", true, "500"},
     {"DB_PATH", true, "/app/data/data.db"},
+    {"DB_READERS", true, "4"},
+    {"DB_BUSY_TIMEOUT_MS", true, "5000"},
+    {"DB_MMAP_SIZE", true, "268435456"},
+    {"DB_CACHE_SIZE", true, "-16384"},
     {"GOOGLE_SHEETS_API_KEY", false},
-    {"SQL_DIR", true, "sql"},
+    {"GOOGLE_SHEETS_BASE_URL", true, "https://sheets.googleapis.com"},
+    {"GOOGLE_SHEETS_CONCURRENCY", true, "4"},
+    {"LOG_ASYNC", true, "1"},
+    {"LOG_LEVEL", true, "trace"},    ///< Levels below BOT_LOG_LEVEL are compiled out
+    {"LOG_QUEUE_CAPACITY", true, "8192"},
+    {"METRICS_ADDRESS", true, "127.0.0.1"},
+    {"METRICS_PORT", true, "9464"},    ///< 0 disables the metrics endpoint
+    {"ONLINE_MIGRATION_CHUNK", true, "500"},
+    {"ONLINE_MIGRATION_PAUSE_MS", true, "50"},
+    {"SEND_CHAT_PER_SEC", true, "1"},
+    {"SEND_CONCURRENCY", true, "4"},
+    {"SEND_GLOBAL_PER_SEC", true, "25"},    ///< Telegram allows about 30
+    {"SEND_GROUP_PER_MIN", true, "20"},
+    {"SESSION_MAX", true, "100000"},
+    {"SESSION_SNAPSHOT_MS", true, "5000"},
+    {"SESSION_TTL_SEC", true, "3600"},    ///< Counted from the last state change
+    {"SHEETS_CACHE_TTL_SEC", true, "300"},
+    {"SHEETS_CACHE_STALE_SEC", true, "3600"},
+    {"SQL_DIR", true, ""},    ///< Empty means embedded scripts, or ./sql without them
+    {"SQL_HOT_RELOAD", true, "1"},    ///< Only applies to scripts read from SQL_DIR
+    {"TRACE_SAMPLE_RATE", true, "0.01"},    ///< Share of updates traced, 0 disables
+    {"TRACE_BUFFER_SPANS", true, "4096"},
+    {"UPDATE_MODE", true, "polling"},    ///< polling or webhook
+    {"UPDATE_WORKERS", true, "0"},
+    {"UPDATE_QUEUE_CAPACITY", true, "1024"},
+    {"USER_CACHE_MAX", true, "100000"},
+    {"USER_CACHE_NEGATIVE_TTL_SEC", true, "60"},
+    {"USER_WRITE_BATCH", true, "256"},
+    {"USER_WRITE_FLUSH_MS", true, "50"},
+    {"WEBHOOK_ADDRESS", true, "0.0.0.0"},
+    {"WEBHOOK_PATH", true, "/telegram/webhook"},
+    {"WEBHOOK_PORT", true, "8443"},
+    {"WEBHOOK_SECRET", true, ""},    ///< Required in webhook mode
+    {"WEBHOOK_THREADS", true, "0"},
+    {"WEBHOOK_URL", true, ""},    ///< Registered with setWebhook when set
 };
 
 }    // namespace bot
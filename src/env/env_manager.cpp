@@ -30,7 +30,7 @@ std::string EnvManager::Get(const std::string& key) {
     if (!storage_.contains(key)) {
         throw std::runtime_error("Unknown env = " + key);
     }
-    return storage_[key];
+    return storage_.at(key);
 }
 
 }    // namespace bot
@@ -0,0 +1,112 @@
+#include "async_sink.hpp"
+#include "metrics/metrics.hpp"
+#include <atomic>
+#include <exception>
+#include <format>
+#include <memory>
+#include <spdlog/common.h>
+#include <spdlog/details/log_msg.h>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace bot {
+
+namespace {
+
+Counter& DroppedMessages() {
+    static Counter& counter = Metrics().GetCounter(
+        "log_messages_dropped_total", "Log records dropped because the ring was full");
+    return counter;
+}
+
+}    // namespace
+
+AsyncSink::AsyncSink(spdlog::sink_ptr sink, size_t capacity)
+    : sink_(std::move(sink)), queue_(capacity) {
+    writer_ = std::thread(&AsyncSink::WriterLoop, this);
+}
+
+AsyncSink::~AsyncSink() {
+    is_stopping_.store(true);
+    is_writer_awake_.store(true);
+    is_writer_awake_.notify_one();
+    writer_.join();
+    sink_->flush();
+}
+
+void AsyncSink::log(const spdlog::details::log_msg& msg) {
+    if (!queue_.TryPush(spdlog::details::log_msg_buffer(msg))) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        DroppedMessages().Add();
+        return;
+    }
+    pushed_.fetch_add(1, std::memory_order_relaxed);
+
+    // Pairs with the fence in WriterLoop: either the writer sees the record on its
+    // final check, or this thread sees that the writer went to sleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!is_writer_awake_.load(std::memory_order_relaxed) &&
+        !is_writer_awake_.exchange(true)) {
+        is_writer_awake_.notify_one();
+    }
+}
+
+void AsyncSink::flush() {
+    uint64_t target = pushed_.load();
+    while (written_.load() < target) {
+        std::this_thread::yield();
+    }
+    sink_->flush();
+}
+
+void AsyncSink::set_pattern(const std::string& pattern) { sink_->set_pattern(pattern); }
+
+void AsyncSink::set_formatter(std::unique_ptr<spdlog::formatter> sink_formatter) {
+    sink_->set_formatter(std::move(sink_formatter));
+}
+
+uint64_t AsyncSink::Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+void AsyncSink::WriterLoop() {
+    spdlog::details::log_msg_buffer record;
+    while (true) {
+        if (queue_.TryPop(record)) {
+            try {
+                sink_->log(record);
+            } catch (const std::exception&) {
+                // Nowhere to report a failing sink; the record is lost
+            }
+            written_.fetch_add(1);
+            continue;
+        }
+
+        ReportDropped();
+        if (is_stopping_.load()) {
+            return;
+        }
+
+        // Sleep only after re-checking for records pushed while the flag was set; a
+        // stale count just costs one more spin of the loop
+        is_writer_awake_.store(false);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (is_stopping_.load() || pushed_.load() != written_.load()) {
+            is_writer_awake_.store(true);
+            continue;
+        }
+        is_writer_awake_.wait(false);
+    }
+}
+
+void AsyncSink::ReportDropped() {
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped == reported_dropped_) {
+        return;
+    }
+    std::string text = std::format("Dropped {} log messages, the queue is full",
+                                   dropped - reported_dropped_);
+    reported_dropped_ = dropped;
+    sink_->log(spdlog::details::log_msg("", spdlog::level::warn, text));
+}
+
+}    // namespace bot
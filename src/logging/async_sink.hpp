@@ -0,0 +1,55 @@
+#pragma once
+
+#include "concurrency/bounded_queue.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <spdlog/details/log_msg_buffer.h>
+#include <spdlog/sinks/sink.h>
+#include <string>
+#include <thread>
+
+namespace bot {
+
+/// Hands records to a background thread through a preallocated lock-free ring, so the
+/// logging thread only copies the message and never waits on the console. When the
+/// ring is full the record is dropped and counted instead of blocking the caller.
+/// Pattern formatting and writing happen on the writer thread, inside sink.
+class AsyncSink final : public spdlog::sinks::sink {
+private:
+    spdlog::sink_ptr sink_;
+    BoundedQueue<spdlog::details::log_msg_buffer> queue_;
+
+    std::atomic<bool> is_writer_awake_{true};
+    std::atomic<bool> is_stopping_{false};
+    std::atomic<uint64_t> pushed_{0};
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> dropped_{0};
+    uint64_t reported_dropped_ = 0;    ///< Writer thread only
+
+    std::thread writer_;
+
+public:
+    AsyncSink(spdlog::sink_ptr sink, size_t capacity);
+    ~AsyncSink() override;
+
+    AsyncSink(const AsyncSink&) = delete;
+    AsyncSink& operator=(const AsyncSink&) = delete;
+
+    void log(const spdlog::details::log_msg& msg) override;
+
+    /// Waits until every record accepted so far is written, then flushes the sink
+    void flush() override;
+
+    void set_pattern(const std::string& pattern) override;
+    void set_formatter(std::unique_ptr<spdlog::formatter> sink_formatter) override;
+
+    uint64_t Dropped() const;
+
+private:
+    void WriterLoop();
+    void ReportDropped();
+};
+
+}    // namespace bot
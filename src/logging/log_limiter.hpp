@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <spdlog/spdlog.h>
+
+namespace bot {
+
+/// True when the level survives the compile-time cutoff (SPDLOG_ACTIVE_LEVEL)
+constexpr bool IsLogLevelActive(spdlog::level::level_enum level) {
+    return static_cast<int>(level) >= SPDLOG_ACTIVE_LEVEL;
+}
+
+/// Lets through `per_second` calls on average with bursts of up to `burst`. It is a
+/// GCRA over one atomic timestamp, so concurrent callers never lock.
+class LogRateLimiter final {
+private:
+    int64_t interval_ns_;
+    int64_t burst_ns_;
+    std::atomic<int64_t> next_ns_{0};    ///< Theoretical arrival time of the next call
+    std::atomic<uint64_t> suppressed_{0};
+
+public:
+    explicit LogRateLimiter(double per_second, size_t burst = 1)
+        : interval_ns_(static_cast<int64_t>(1e9 / std::max(per_second, 1e-9))),
+          burst_ns_(interval_ns_ *
+                    static_cast<int64_t>(std::max<size_t>(burst, 1) - 1)) {}
+
+    bool Allow() {
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now().time_since_epoch())
+                          .count();
+        int64_t next = next_ns_.load(std::memory_order_relaxed);
+        while (true) {
+            if (now < next - burst_ns_) {
+                suppressed_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            if (next_ns_.compare_exchange_weak(next, std::max(next, now) + interval_ns_,
+                                               std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+
+    /// Calls rejected since the previous TakeSuppressed
+    uint64_t TakeSuppressed() {
+        return suppressed_.exchange(0, std::memory_order_relaxed);
+    }
+};
+
+/// Lets through the first of every `every` calls
+class LogSampler final {
+private:
+    uint64_t every_;
+    std::atomic<uint64_t> calls_{0};
+
+public:
+    explicit LogSampler(uint64_t every) : every_(std::max<uint64_t>(every, 1)) {}
+
+    bool Allow() { return calls_.fetch_add(1, std::memory_order_relaxed) % every_ == 0; }
+};
+
+}    // namespace bot
+
+/// Logs at most `per_second` messages per second from this call site and reports how
+/// many were skipped with the next message that gets through
+#define LOG_RATE_LIMITED(level, per_second, ...)                                      \
+    do {                                                                              \
+        if constexpr (::bot::IsLogLevelActive(level)) {                               \
+            static ::bot::LogRateLimiter bot_log_limiter(per_second);                 \
+            if (spdlog::should_log(level) && bot_log_limiter.Allow()) {               \
+                spdlog::log(level, __VA_ARGS__);                                      \
+                if (uint64_t bot_skipped = bot_log_limiter.TakeSuppressed()) {        \
+                    spdlog::log(level, "{} similar messages were suppressed",         \
+                                bot_skipped);                                         \
+                }                                                                     \
+            }                                                                         \
+        }                                                                             \
+    } while (false)
+
+/// Logs the first of every `every` messages from this call site
+#define LOG_EVERY_N(level, every, ...)                                                \
+    do {                                                                              \
+        if constexpr (::bot::IsLogLevelActive(level)) {                               \
+            static ::bot::LogSampler bot_log_sampler(every);                          \
+            if (spdlog::should_log(level) && bot_log_sampler.Allow()) {               \
+                spdlog::log(level, __VA_ARGS__);                                      \
+            }                                                                         \
+        }                                                                             \
+    } while (false)
@@ -0,0 +1,42 @@
+#include "logger.hpp"
+#include "logging/async_sink.hpp"
+#include <memory>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <string>
+
+namespace bot {
+
+LogConfig MakeLogConfig(IEnvManager& env) {
+    LogConfig config;
+    std::string level = env.Get("LOG_LEVEL");
+    config.level = spdlog::level::from_str(level);
+    if (config.level == spdlog::level::off && level != "off") {
+        throw std::invalid_argument("Unknown log level (" + level + ")");
+    }
+    config.is_async = env.Get("LOG_ASYNC") == "1";
+    config.queue_capacity = std::stoul(env.Get("LOG_QUEUE_CAPACITY"));
+    return config;
+}
+
+void SetupLogger(const LogConfig& config) {
+    auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+
+    console_sink->set_pattern("[%H:%M:%S] [%^%L%$]   %v");
+    console_sink->set_color_mode(spdlog::color_mode::always);
+
+    spdlog::sink_ptr sink = console_sink;
+    if (config.is_async) {
+        sink = std::make_shared<AsyncSink>(console_sink, config.queue_capacity);
+    }
+
+    auto logger = std::make_shared<spdlog::logger>("default_logger", sink);
+    logger->set_level(config.level);
+    // Errors usually precede a crash or an exit, so they must reach the console
+    logger->flush_on(spdlog::level::err);
+
+    spdlog::set_default_logger(logger);
+}
+
+}    // namespace bot
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "env/env_manager.hpp"
+#include <cstddef>
+#include <spdlog/common.h>
+
+namespace bot {
+
+struct LogConfig {
+    spdlog::level::level_enum level = spdlog::level::trace;
+    bool is_async = true;
+    size_t queue_capacity = 8192;    ///< Records buffered by the async writer
+};
+
+LogConfig MakeLogConfig(IEnvManager& env);
+
+/// Installs the colored console logger as the default one. In async mode records go
+/// through an AsyncSink, so callers never block on stdout.
+void SetupLogger(const LogConfig& config);
+
+}    // namespace bot
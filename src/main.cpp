@@ -2,9 +2,13 @@
 
 int main() {
     try {
-        bot::Bootstraper().Bootstrap();
+        bot::Bootstraper bootstraper;
+        bootstraper.Bootstrap();
+        bootstraper.Run();
     } catch (std::exception& ex) {
         spdlog::error("Failed to run init script = {}", ex.what());
     }
+    // Drains the async log writer before exit
+    spdlog::shutdown();
     return 0;
 }
@@ -0,0 +1,184 @@
+#include "metrics.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace bot {
+
+namespace {
+
+std::string EscapeLabelValue(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped.push_back('\\');
+            escaped.push_back(c);
+        } else if (c == '\n') {
+            escaped.append("\\n");
+        } else {
+            escaped.push_back(c);
+        }
+    }
+    return escaped;
+}
+
+std::string RenderLabels(const MetricLabels& labels) {
+    std::string rendered;
+    for (const auto& [key, value] : labels) {
+        rendered += std::format("{}{}=\"{}\"", rendered.empty() ? "" : ",", key,
+                                EscapeLabelValue(value));
+    }
+    return rendered;
+}
+
+/// Joins the series labels with an extra one, e.g. quantile="0.99"
+std::string WithLabel(const std::string& labels, const std::string& extra) {
+    if (labels.empty() && extra.empty()) {
+        return "";
+    }
+    if (labels.empty() || extra.empty()) {
+        return "{" + labels + extra + "}";
+    }
+    return "{" + labels + "," + extra + "}";
+}
+
+template <typename T, typename Map>
+T& GetOrCreate(Map& families, const std::string& name, const std::string& help,
+               const MetricLabels& labels, double scale) {
+    auto& family = families[name];
+    if (family.help.empty()) {
+        family.help = help;
+        family.scale = scale;
+    }
+    auto& series = family.series[RenderLabels(labels)];
+    if (!series) {
+        series = std::make_unique<T>();
+    }
+    return *series;
+}
+
+void RenderHeader(std::string& out, const std::string& name, const std::string& help,
+                  const char* type) {
+    out += std::format("# HELP {} {}\n# TYPE {} {}\n", name, help, name, type);
+}
+
+}    // namespace
+
+size_t MetricShardIndex() {
+    static std::atomic<size_t> next_index{0};
+    thread_local const size_t index = next_index.fetch_add(1, std::memory_order_relaxed) %
+                                      kMetricShards;
+    return index;
+}
+
+uint64_t Counter::Value() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+Histogram::Snapshot Histogram::Collect() const {
+    Snapshot snapshot;
+    for (size_t i = 0; i < kHistogramShards; ++i) {
+        const Shard& shard = shards_[i];
+        for (size_t bucket = 0; bucket < kBuckets; ++bucket) {
+            snapshot.buckets[bucket] +=
+                shard.buckets[bucket].load(std::memory_order_relaxed);
+        }
+        snapshot.count += shard.count.load(std::memory_order_relaxed);
+        snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+uint64_t Histogram::Snapshot::Quantile(double q) const {
+    uint64_t total = 0;
+    for (uint64_t bucket_count : buckets) {
+        total += bucket_count;
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    auto rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < kBuckets; ++bucket) {
+        seen += buckets[bucket];
+        if (seen >= rank) {
+            uint64_t lower = BucketLowerBound(bucket);
+            uint64_t upper = bucket + 1 < kBuckets ? BucketLowerBound(bucket + 1) : lower;
+            return lower + (upper - lower) / 2;
+        }
+    }
+    return BucketLowerBound(kBuckets - 1);
+}
+
+Counter& MetricsRegistry::GetCounter(const std::string& name, const std::string& help,
+                                     const MetricLabels& labels) {
+    std::lock_guard lock(mutex_);
+    return GetOrCreate<Counter>(counters_, name, help, labels, 1);
+}
+
+Gauge& MetricsRegistry::GetGauge(const std::string& name, const std::string& help,
+                                 const MetricLabels& labels) {
+    std::lock_guard lock(mutex_);
+    return GetOrCreate<Gauge>(gauges_, name, help, labels, 1);
+}
+
+Histogram& MetricsRegistry::GetHistogram(const std::string& name, const std::string& help,
+                                         const MetricLabels& labels, double scale) {
+    std::lock_guard lock(mutex_);
+    return GetOrCreate<Histogram>(histograms_, name, help, labels, scale);
+}
+
+std::string MetricsRegistry::Render() const {
+    std::lock_guard lock(mutex_);
+    std::string out;
+
+    for (const auto& [name, family] : counters_) {
+        RenderHeader(out, name, family.help, "counter");
+        for (const auto& [labels, counter] : family.series) {
+            out +=
+                std::format("{}{} {}\n", name, WithLabel(labels, ""), counter->Value());
+        }
+    }
+
+    for (const auto& [name, family] : gauges_) {
+        RenderHeader(out, name, family.help, "gauge");
+        for (const auto& [labels, gauge] : family.series) {
+            out += std::format("{}{} {}\n", name, WithLabel(labels, ""), gauge->Value());
+        }
+    }
+
+    for (const auto& [name, family] : histograms_) {
+        RenderHeader(out, name, family.help, "summary");
+        for (const auto& [labels, histogram] : family.series) {
+            Histogram::Snapshot snapshot = histogram->Collect();
+            for (double q : {0.5, 0.9, 0.99, 0.999}) {
+                double value = static_cast<double>(snapshot.Quantile(q)) * family.scale;
+                out += std::format("{}{} {}\n", name,
+                                   WithLabel(labels, std::format("quantile=\"{}\"", q)),
+                                   value);
+            }
+            out += std::format("{}_sum{} {}\n", name, WithLabel(labels, ""),
+                               static_cast<double>(snapshot.sum) * family.scale);
+            out += std::format("{}_count{} {}\n", name, WithLabel(labels, ""),
+                               snapshot.count);
+        }
+    }
+    return out;
+}
+
+MetricsRegistry& Metrics() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+}    // namespace bot
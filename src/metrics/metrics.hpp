@@ -0,0 +1,165 @@
+#pragma once
+
+#include "concurrency/bounded_queue.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bot {
+
+constexpr size_t kMetricShards = 16;
+constexpr size_t kHistogramShards = 8;
+
+/// Stable per-thread index, so threads mostly touch their own cache lines
+size_t MetricShardIndex();
+
+/// Monotonic counter. Add is one relaxed fetch_add on the calling thread's shard.
+class Counter final {
+private:
+    struct alignas(kCacheLineSize) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+
+    std::array<Shard, kMetricShards> shards_;
+
+public:
+    void Add(uint64_t delta = 1) {
+        shards_[MetricShardIndex()].value.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    uint64_t Value() const;
+};
+
+class Gauge final {
+private:
+    std::atomic<int64_t> value_{0};
+
+public:
+    void Set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+    void Add(int64_t delta) { value_.fetch_add(delta, std::memory_order_relaxed); }
+    int64_t Value() const { return value_.load(std::memory_order_relaxed); }
+};
+
+/// Log-linear histogram in the spirit of HdrHistogram: every power of two is split
+/// into 8 linear sub-buckets, so a quantile is off by at most 12.5%. Values are
+/// integers (nanoseconds, bytes); larger than kMaxValue ones land in the last bucket.
+class Histogram final {
+public:
+    static constexpr size_t kSubBucketBits = 3;
+    static constexpr size_t kSubBuckets = 1 << kSubBucketBits;
+    static constexpr size_t kMaxBits = 44;
+    static constexpr uint64_t kMaxValue = (uint64_t{1} << kMaxBits) - 1;
+    static constexpr size_t kBuckets = (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+    struct Snapshot {
+        std::array<uint64_t, kBuckets> buckets{};
+        uint64_t count = 0;
+        uint64_t sum = 0;
+
+        /// Midpoint of the bucket holding the q-th value, 0 when empty
+        uint64_t Quantile(double q) const;
+    };
+
+private:
+    struct alignas(kCacheLineSize) Shard {
+        std::array<std::atomic<uint64_t>, kBuckets> buckets{};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+    };
+
+    std::unique_ptr<Shard[]> shards_ = std::make_unique<Shard[]>(kHistogramShards);
+
+public:
+    void Record(uint64_t value) {
+        Shard& shard = shards_[MetricShardIndex() % kHistogramShards];
+        shard.buckets[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        shard.count.fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    void Record(std::chrono::nanoseconds duration) {
+        Record(static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0)));
+    }
+
+    Snapshot Collect() const;
+
+    static constexpr size_t BucketOf(uint64_t value) {
+        if (value < kSubBuckets) {
+            return value;
+        }
+        value = std::min(value, kMaxValue);
+        size_t exponent = std::bit_width(value) - 1;
+        size_t sub_bucket = (value >> (exponent - kSubBucketBits)) & (kSubBuckets - 1);
+        return (exponent - kSubBucketBits + 1) * kSubBuckets + sub_bucket;
+    }
+
+    static constexpr uint64_t BucketLowerBound(size_t bucket) {
+        if (bucket < kSubBuckets) {
+            return bucket;
+        }
+        size_t exponent = bucket / kSubBuckets + kSubBucketBits - 1;
+        uint64_t sub_bucket = bucket % kSubBuckets;
+        return (kSubBuckets + sub_bucket) << (exponent - kSubBucketBits);
+    }
+};
+
+/// Records the lifetime of the scope into a histogram
+class ScopedTimer final {
+private:
+    Histogram& histogram_;
+    std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+
+public:
+    explicit ScopedTimer(Histogram& histogram) : histogram_(histogram) {}
+    ~ScopedTimer() { histogram_.Record(std::chrono::steady_clock::now() - start_); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+/// Owns every metric. Lookups lock and are meant for setup: hot code resolves a
+/// metric once and keeps the reference, which stays valid for the registry lifetime.
+class MetricsRegistry final {
+private:
+    template <typename T> struct Family {
+        std::string help;
+        double scale = 1;    ///< Multiplier applied on export, e.g. 1e-9 for ns -> s
+        /// Rendered labels -> metric
+        std::map<std::string, std::unique_ptr<T>> series;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family<Counter>> counters_;
+    std::map<std::string, Family<Gauge>> gauges_;
+    std::map<std::string, Family<Histogram>> histograms_;
+
+public:
+    Counter& GetCounter(const std::string& name, const std::string& help,
+                        const MetricLabels& labels = {});
+    Gauge& GetGauge(const std::string& name, const std::string& help,
+                    const MetricLabels& labels = {});
+    /// Histograms of durations should record nanoseconds and pass scale = 1e-9
+    Histogram& GetHistogram(const std::string& name, const std::string& help,
+                            const MetricLabels& labels = {}, double scale = 1e-9);
+
+    /// Prometheus text exposition format 0.0.4. Histograms are exported as summaries
+    /// with 0.5, 0.9, 0.99 and 0.999 quantiles.
+    std::string Render() const;
+};
+
+/// Process-wide registry used by the instrumented components
+MetricsRegistry& Metrics();
+
+}    // namespace bot
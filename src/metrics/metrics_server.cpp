@@ -0,0 +1,174 @@
+#include "metrics_server.hpp"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <format>
+#include <functional>
+#include <mutex>
+#include <netinet/in.h>
+#include <poll.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+
+namespace bot {
+
+namespace {
+
+/// How often the loop wakes up to check for a stop request
+constexpr int kPollTimeoutMs = 100;
+constexpr int kReadTimeoutMs = 1000;
+constexpr size_t kMaxRequestSize = 8 * 1024;
+
+std::string ErrnoMessage(const std::string& what) {
+    return what + " failed: " + std::strerror(errno);
+}
+
+std::string MakeResponse(std::string_view status, std::string_view content_type,
+                         std::string_view body) {
+    return std::format("HTTP/1.0 {}\r\nContent-Type: {}\r\nContent-Length: {}\r\n"
+                       "Connection: close\r\n\r\n{}",
+                       status, content_type, body.size(), body);
+}
+
+/// Reads until the end of the request headers; the request body is never needed
+std::string ReadRequestHead(int fd) {
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos &&
+           request.size() < kMaxRequestSize) {
+        pollfd poll_fd{fd, POLLIN, 0};
+        if (poll(&poll_fd, 1, kReadTimeoutMs) <= 0) {
+            break;
+        }
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+        request.append(buffer, static_cast<size_t>(length));
+    }
+    return request;
+}
+
+void WriteAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t written = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (written <= 0) {
+            return;
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+}
+
+}    // namespace
+
+MetricsServer::MetricsServer(const MetricsRegistry& registry, const std::string& address,
+                             uint16_t port)
+    : registry_(registry) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+        throw std::invalid_argument("Invalid metrics address (" + address + ")");
+    }
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error(ErrnoMessage("socket"));
+    }
+    int reuse = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(listen_fd_, SOMAXCONN) < 0) {
+        std::string message =
+            ErrnoMessage("bind " + address + ":" + std::to_string(port));
+        close(listen_fd_);
+        throw std::runtime_error(message);
+    }
+
+    socklen_t length = sizeof(addr);
+    getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &length);
+    port_ = ntohs(addr.sin_port);
+    spdlog::info("Serving metrics on http://{}:{}/metrics", address, port_);
+
+    worker_ = std::jthread([this](std::stop_token stop) { Loop(stop); });
+}
+
+MetricsServer::~MetricsServer() {
+    worker_.request_stop();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    close(listen_fd_);
+}
+
+uint16_t MetricsServer::Port() const { return port_; }
+
+void MetricsServer::Loop(std::stop_token stop) {
+    while (!stop.stop_requested()) {
+        pollfd fd{listen_fd_, POLLIN, 0};
+        if (poll(&fd, 1, kPollTimeoutMs) <= 0) {
+            continue;
+        }
+        int client_fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client_fd < 0) {
+            continue;
+        }
+        Serve(client_fd);
+        close(client_fd);
+    }
+}
+
+void MetricsServer::AddRoute(const std::string& path, const std::string& content_type,
+                             std::function<std::string()> handler) {
+    std::lock_guard lock(routes_mutex_);
+    routes_[path] = Route{content_type, std::move(handler)};
+}
+
+void MetricsServer::Serve(int client_fd) {
+    std::string request = ReadRequestHead(client_fd);
+    std::string_view request_line =
+        std::string_view(request).substr(0, request.find("\r\n"));
+
+    if (!request_line.starts_with("GET ")) {
+        WriteAll(client_fd, MakeResponse("405 Method Not Allowed", "text/plain",
+                                         "Only GET is supported\n"));
+        return;
+    }
+    request_line.remove_prefix(4);
+    std::string_view path = request_line.substr(0, request_line.find(' '));
+
+    if (path == "/metrics") {
+        WriteAll(client_fd, MakeResponse("200 OK", "text/plain; version=0.0.4",
+                                         registry_.Render()));
+        return;
+    }
+
+    Route route;
+    {
+        std::lock_guard lock(routes_mutex_);
+        auto it = routes_.find(path);
+        if (it != routes_.end()) {
+            route = it->second;
+        }
+    }
+    if (!route.handler) {
+        WriteAll(client_fd, MakeResponse("404 Not Found", "text/plain", "Not found\n"));
+        return;
+    }
+
+    try {
+        WriteAll(client_fd, MakeResponse("200 OK", route.content_type, route.handler()));
+    } catch (const std::exception& ex) {
+        WriteAll(client_fd, MakeResponse("500 Internal Server Error", "text/plain",
+                                         std::string(ex.what()) + "\n"));
+    }
+}
+
+}    // namespace bot
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "metrics/metrics.hpp"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+namespace bot {
+
+/// Minimal HTTP/1.0 endpoint serving GET /metrics for a local Prometheus scraper,
+/// plus debug routes added with AddRoute. Requests are handled one at a time on a
+/// background thread; it is meant to be bound to loopback, not exposed.
+class MetricsServer final {
+private:
+    struct Route {
+        std::string content_type;
+        std::function<std::string()> handler;
+    };
+
+    const MetricsRegistry& registry_;
+    std::mutex routes_mutex_;
+    std::map<std::string, Route, std::less<>> routes_;
+    int listen_fd_ = -1;
+    uint16_t port_ = 0;
+    std::jthread worker_;
+
+public:
+    /// Port 0 picks a free port, see Port()
+    MetricsServer(const MetricsRegistry& registry, const std::string& address,
+                  uint16_t port);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    uint16_t Port() const;
+
+    /// Serves the handler's output on GET path
+    void AddRoute(const std::string& path, const std::string& content_type,
+                  std::function<std::string()> handler);
+
+private:
+    void Loop(std::stop_token stop);
+    void Serve(int client_fd);
+};
+
+}    // namespace bot
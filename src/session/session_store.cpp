@@ -0,0 +1,274 @@
+#include "session_store.hpp"
+#include "metrics/metrics.hpp"
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <SQLiteCpp/Transaction.h>
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <spdlog/spdlog.h>
+#include <utility>
+#include <vector>
+
+namespace bot {
+
+namespace {
+
+struct SessionMetrics {
+    Counter& evictions = Metrics().GetCounter(
+        "session_evictions_total", "Sessions dropped because the store was full");
+    Counter& rows_written = Metrics().GetCounter("session_snapshot_rows_total",
+                                                 "Session rows written by snapshots");
+    Histogram& snapshot_duration = Metrics().GetHistogram(
+        "session_snapshot_duration_seconds", "Time to write one session snapshot");
+};
+
+SessionMetrics& GetSessionMetrics() {
+    static SessionMetrics metrics;
+    return metrics;
+}
+
+int64_t ToMillis(std::chrono::system_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch())
+        .count();
+}
+
+}    // namespace
+
+SessionStoreConfig MakeSessionStoreConfig(IEnvManager& env) {
+    SessionStoreConfig config;
+    config.max_sessions = std::stoul(env.Get("SESSION_MAX"));
+    config.ttl = std::chrono::seconds(std::stol(env.Get("SESSION_TTL_SEC")));
+    config.snapshot_interval =
+        std::chrono::milliseconds(std::stol(env.Get("SESSION_SNAPSHOT_MS")));
+    return config;
+}
+
+SessionStore::SessionStore(const std::shared_ptr<ConnectionPool>& pool,
+                           const SessionStoreConfig& config)
+    : pool_(pool),
+      config_(config),
+      shard_capacity_(std::max<size_t>(1, config.max_sessions / kSessionShards)) {}
+
+SessionStore::~SessionStore() { Stop(); }
+
+size_t SessionStore::Restore() {
+    auto now = Clock::now();
+    size_t restored = 0;
+
+    ConnectionLease reader = pool_->AcquireReader();
+    auto select = reader.Statements()->Acquire(config_.get_sessions);
+    select->bind(1, ToMillis(now));
+    while (select->executeStep()) {
+        Entry entry{select->getColumn(0).getInt64(),
+                    {select->getColumn(1).getString(), select->getColumn(2).getString()},
+                    Clock::time_point(
+                        std::chrono::milliseconds(select->getColumn(3).getInt64()))};
+        Shard& shard = ShardOf(entry.chat_id);
+        std::lock_guard lock(shard.mutex);
+        Insert(shard, std::move(entry), now);
+        ++restored;
+    }
+    select->reset();
+
+    spdlog::info("Restored {} sessions", restored);
+    return restored;
+}
+
+void SessionStore::Start() {
+    worker_ = std::jthread([this](std::stop_token stop) { SnapshotLoop(stop); });
+}
+
+void SessionStore::Stop() {
+    if (!worker_.joinable()) {
+        return;
+    }
+    worker_.request_stop();
+    worker_.join();
+    try {
+        Snapshot();
+    } catch (const std::exception& ex) {
+        spdlog::error("Failed to write the last session snapshot = {}", ex.what());
+    }
+}
+
+std::optional<ConversationState> SessionStore::Get(int64_t chat_id) {
+    Shard& shard = ShardOf(chat_id);
+    std::lock_guard lock(shard.mutex);
+
+    auto it = shard.index.find(chat_id);
+    if (it == shard.index.end()) {
+        ++shard.misses;
+        return std::nullopt;
+    }
+    if (it->second->expires_at <= Clock::now()) {
+        // The row left on disk is removed by the next snapshot
+        shard.entries.erase(it->second);
+        shard.index.erase(it);
+        ++shard.misses;
+        return std::nullopt;
+    }
+    ++shard.hits;
+    return it->second->state;
+}
+
+void SessionStore::Set(int64_t chat_id, ConversationState state) {
+    auto now = Clock::now();
+    Shard& shard = ShardOf(chat_id);
+    std::lock_guard lock(shard.mutex);
+
+    shard.dirty.insert(chat_id);
+    auto it = shard.index.find(chat_id);
+    if (it == shard.index.end()) {
+        Insert(shard, {chat_id, std::move(state), now + config_.ttl}, now);
+        return;
+    }
+    it->second->state = std::move(state);
+    it->second->expires_at = now + config_.ttl;
+    shard.entries.splice(shard.entries.end(), shard.entries, it->second);
+}
+
+void SessionStore::Erase(int64_t chat_id) {
+    Shard& shard = ShardOf(chat_id);
+    std::lock_guard lock(shard.mutex);
+
+    auto it = shard.index.find(chat_id);
+    if (it == shard.index.end()) {
+        return;
+    }
+    shard.entries.erase(it->second);
+    shard.index.erase(it);
+    shard.dirty.insert(chat_id);
+}
+
+size_t SessionStore::Snapshot() {
+    struct Row {
+        int64_t chat_id;
+        std::optional<Entry> entry;    ///< Empty when the session was removed
+    };
+
+    std::lock_guard snapshot_lock(snapshot_mutex_);
+    ScopedTimer timer(GetSessionMetrics().snapshot_duration);
+    auto now = Clock::now();
+
+    // Only the changed chats are copied, each shard is locked for the copy alone
+    std::vector<Row> rows;
+    for (size_t i = 0; i < kSessionShards; ++i) {
+        Shard& shard = shards_[i];
+        std::lock_guard lock(shard.mutex);
+        RemoveExpired(shard, now);
+        for (int64_t chat_id : shard.dirty) {
+            auto it = shard.index.find(chat_id);
+            rows.push_back({chat_id, it == shard.index.end()
+                                         ? std::nullopt
+                                         : std::optional<Entry>(*it->second)});
+        }
+        shard.dirty.clear();
+    }
+
+    try {
+        ConnectionLease writer = pool_->AcquireWriter();
+        SQLite::Transaction transaction(*writer);
+        auto upsert = writer.Statements()->Acquire(config_.upsert_session);
+        auto remove = writer.Statements()->Acquire(config_.delete_session);
+        for (const auto& row : rows) {
+            if (row.entry) {
+                upsert->reset();
+                upsert->bind(1, row.chat_id);
+                upsert->bind(2, row.entry->state.state);
+                upsert->bind(3, row.entry->state.data);
+                upsert->bind(4, ToMillis(row.entry->expires_at));
+                upsert->exec();
+            } else {
+                remove->reset();
+                remove->bind(1, row.chat_id);
+                remove->exec();
+            }
+        }
+        upsert->reset();
+        remove->reset();
+
+        auto remove_expired = writer.Statements()->Acquire(config_.delete_expired);
+        remove_expired->bind(1, ToMillis(now));
+        remove_expired->exec();
+        remove_expired->reset();
+        transaction.commit();
+    } catch (...) {
+        // The chats are written by the next snapshot instead
+        for (const auto& row : rows) {
+            Shard& shard = ShardOf(row.chat_id);
+            std::lock_guard lock(shard.mutex);
+            shard.dirty.insert(row.chat_id);
+        }
+        throw;
+    }
+
+    GetSessionMetrics().rows_written.Add(rows.size());
+    std::lock_guard lock(stats_mutex_);
+    ++snapshots_;
+    rows_written_ += rows.size();
+    return rows.size();
+}
+
+SessionStats SessionStore::Stats() {
+    SessionStats stats;
+    for (size_t i = 0; i < kSessionShards; ++i) {
+        Shard& shard = shards_[i];
+        std::lock_guard lock(shard.mutex);
+        stats.sessions += shard.index.size();
+        stats.hits += shard.hits;
+        stats.misses += shard.misses;
+        stats.evictions += shard.evictions;
+    }
+    std::lock_guard lock(stats_mutex_);
+    stats.snapshots = snapshots_;
+    stats.rows_written = rows_written_;
+    return stats;
+}
+
+SessionStore::Shard& SessionStore::ShardOf(int64_t chat_id) {
+    return shards_[static_cast<uint64_t>(chat_id) % kSessionShards];
+}
+
+void SessionStore::Insert(Shard& shard, Entry entry, Clock::time_point now) {
+    RemoveExpired(shard, now);
+    if (shard.index.size() >= shard_capacity_) {
+        int64_t evicted = shard.entries.front().chat_id;
+        shard.index.erase(evicted);
+        shard.entries.pop_front();
+        shard.dirty.insert(evicted);
+        ++shard.evictions;
+        GetSessionMetrics().evictions.Add();
+    }
+
+    int64_t chat_id = entry.chat_id;
+    shard.entries.push_back(std::move(entry));
+    shard.index[chat_id] = std::prev(shard.entries.end());
+}
+
+void SessionStore::RemoveExpired(Shard& shard, Clock::time_point now) {
+    // Every entry lives for the same ttl, so the list is ordered by expiry
+    while (!shard.entries.empty() && shard.entries.front().expires_at <= now) {
+        shard.index.erase(shard.entries.front().chat_id);
+        shard.entries.pop_front();
+    }
+}
+
+void SessionStore::SnapshotLoop(std::stop_token stop) {
+    while (!stop.stop_requested()) {
+        {
+            std::unique_lock lock(worker_mutex_);
+            worker_cv_.wait_for(lock, stop, config_.snapshot_interval,
+                                [] { return false; });
+        }
+        if (stop.stop_requested()) {
+            return;
+        }
+        try {
+            Snapshot();
+        } catch (const std::exception& ex) {
+            spdlog::error("Session snapshot failed = {}", ex.what());
+        }
+    }
+}
+
+}    // namespace bot
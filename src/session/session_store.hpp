@@ -0,0 +1,127 @@
+#pragma once
+
+#include "concurrency/bounded_queue.hpp"
+#include "db/connection_pool.hpp"
+#include "env/env_manager.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace bot {
+
+constexpr size_t kSessionShards = 16;
+
+/// Step of a multi-step command and what the user entered so far
+struct ConversationState {
+    std::string state;    ///< E.g. "await_email"
+    std::string data;     ///< Free-form, usually JSON
+};
+
+struct SessionStoreConfig {
+    size_t max_sessions = 100000;    ///< The oldest sessions are evicted beyond it
+    std::chrono::seconds ttl{3600};    ///< Counted from the last Set
+    std::chrono::milliseconds snapshot_interval{5000};
+    std::string get_sessions = "dao/get_sessions.sql";
+    std::string upsert_session = "dao/upsert_session.sql";
+    std::string delete_session = "dao/delete_session.sql";
+    std::string delete_expired = "dao/delete_expired_sessions.sql";
+};
+
+SessionStoreConfig MakeSessionStoreConfig(IEnvManager& env);
+
+struct SessionStats {
+    size_t sessions = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;    ///< Dropped for max_sessions, not for the TTL
+    uint64_t snapshots = 0;
+    uint64_t rows_written = 0;
+};
+
+/// Per-chat conversation state kept in memory. Chats are spread over kSessionShards
+/// shards, each a hash map under its own mutex, so Get and Set take one uncontended
+/// lock and never touch the disk. Sessions expire ttl after their last Set and each
+/// shard holds at most max_sessions / kSessionShards of them. Changed and removed
+/// chats are written to session_ by a background snapshot every snapshot_interval,
+/// and Restore loads the unexpired ones back on startup.
+class SessionStore final {
+private:
+    using Clock = std::chrono::system_clock;
+
+    struct Entry {
+        int64_t chat_id;
+        ConversationState state;
+        Clock::time_point expires_at;
+    };
+
+    struct alignas(kCacheLineSize) Shard {
+        std::mutex mutex;
+        std::list<Entry> entries;    ///< By expires_at, the oldest first
+        std::unordered_map<int64_t, std::list<Entry>::iterator> index;
+        std::unordered_set<int64_t> dirty;    ///< Changed since the last snapshot
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    std::shared_ptr<ConnectionPool> pool_;
+    SessionStoreConfig config_;
+    size_t shard_capacity_;
+    std::unique_ptr<Shard[]> shards_ = std::make_unique<Shard[]>(kSessionShards);
+
+    std::mutex snapshot_mutex_;    ///< Keeps snapshots from interleaving
+    std::mutex stats_mutex_;
+    uint64_t snapshots_ = 0;
+    uint64_t rows_written_ = 0;
+
+    std::mutex worker_mutex_;
+    std::condition_variable_any worker_cv_;
+    std::jthread worker_;
+
+public:
+    SessionStore(const std::shared_ptr<ConnectionPool>& pool,
+                 const SessionStoreConfig& config = {});
+    ~SessionStore();
+
+    SessionStore(const SessionStore&) = delete;
+    SessionStore& operator=(const SessionStore&) = delete;
+
+    /// Loads the sessions of the last snapshot that have not expired. Returns how many.
+    size_t Restore();
+
+    /// Starts periodic snapshots
+    void Start();
+
+    /// Stops the snapshots and writes the last changes
+    void Stop();
+
+    std::optional<ConversationState> Get(int64_t chat_id);
+    void Set(int64_t chat_id, ConversationState state);
+    void Erase(int64_t chat_id);
+
+    /// Writes the chats changed since the previous snapshot. Returns the rows written.
+    size_t Snapshot();
+
+    SessionStats Stats();
+
+private:
+    Shard& ShardOf(int64_t chat_id);
+
+    /// Expects the shard to be locked
+    void Insert(Shard& shard, Entry entry, Clock::time_point now);
+    void RemoveExpired(Shard& shard, Clock::time_point now);
+
+    void SnapshotLoop(std::stop_token stop);
+};
+
+}    // namespace bot
@@ -0,0 +1,419 @@
+#include "send_scheduler.hpp"
+#include "logging/log_limiter.hpp"
+#include "metrics/metrics.hpp"
+#include <algorithm>
+#include <charconv>
+#include <exception>
+#include <format>
+#include <iterator>
+#include <optional>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <string_view>
+#include <tgbot/Api.h>
+#include <tgbot/TgException.h>
+
+namespace bot {
+
+namespace {
+
+/// Used when a 429 does not say how long to wait
+constexpr std::chrono::seconds kDefaultRetryAfter{1};
+
+struct SendMetrics {
+    Histogram& duration = Metrics().GetHistogram(
+        "tg_send_duration_seconds", "Time spent in Bot API send and edit requests");
+    Counter& sent = Metrics().GetCounter("tg_messages_sent_total",
+                                         "Messages accepted by the Bot API");
+    Counter& failed =
+        Metrics().GetCounter("tg_send_failures_total", "Messages the Bot API rejected");
+    Counter& retried = Metrics().GetCounter("tg_send_retry_after_total",
+                                            "Requests answered with 429 retry_after");
+    Counter& coalesced = Metrics().GetCounter("tg_send_edits_coalesced_total",
+                                              "Edits merged into an already queued edit");
+    Gauge& pending =
+        Metrics().GetGauge("tg_send_queue_depth", "Messages queued or being sent");
+};
+
+SendMetrics& GetSendMetrics() {
+    static SendMetrics metrics;
+    return metrics;
+}
+
+bool IsEdit(const OutgoingMessage& message) { return message.message_id != 0; }
+
+template <typename Queues> bool AllEmpty(const Queues& queues) {
+    return std::ranges::all_of(queues, [](const auto& queue) { return queue.empty(); });
+}
+
+}    // namespace
+
+std::optional<std::chrono::seconds> ParseRetryAfter(std::string_view description) {
+    constexpr std::string_view kMarker = "retry after ";
+    size_t position = description.find(kMarker);
+    if (position == std::string_view::npos) {
+        return std::nullopt;
+    }
+    std::string_view digits = description.substr(position + kMarker.size());
+    int64_t seconds = 0;
+    auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(),
+                                        seconds);
+    if (error != std::errc() || seconds < 0) {
+        return std::nullopt;
+    }
+    return std::chrono::seconds(seconds);
+}
+
+TgApiSendTransport::TgApiSendTransport(const std::shared_ptr<TgBot::Bot>& bot)
+    : bot_(bot) {}
+
+int32_t TgApiSendTransport::Send(const OutgoingMessage& message) {
+    const TgBot::Api& api = bot_->getApi();
+    try {
+        if (!IsEdit(message)) {
+            return api
+                .sendMessage(message.chat_id, message.text, nullptr, nullptr, nullptr,
+                             message.parse_mode)
+                ->messageId;
+        }
+        api.editMessageText(message.text, message.chat_id, message.message_id, "",
+                            message.parse_mode);
+        return message.message_id;
+    } catch (const TgBot::TgException& ex) {
+        using ErrorCode = TgBot::TgException::ErrorCode;
+        if (ex.errorCode == ErrorCode::TooManyRequests) {
+            auto retry_after = ParseRetryAfter(ex.what()).value_or(kDefaultRetryAfter);
+            throw RetryAfterError(retry_after);
+        }
+        // A coalesced edit may carry the text the message already has
+        if (IsEdit(message) && ex.errorCode == ErrorCode::BadRequest &&
+            std::string_view(ex.what()).find("message is not modified") !=
+                std::string_view::npos) {
+            return message.message_id;
+        }
+        throw;
+    }
+}
+
+TokenBucket::TokenBucket(double per_second, size_t burst) {
+    if (per_second <= 0) {
+        throw std::invalid_argument("Token bucket rate must be positive");
+    }
+    interval_ = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1 / per_second));
+    tolerance_ = interval_ * static_cast<int64_t>(std::max<size_t>(burst, 1) - 1);
+}
+
+bool TokenBucket::TryTake(Clock::time_point now) {
+    if (now < ReadyAt()) {
+        return false;
+    }
+    next_ = std::max(next_, now) + interval_;
+    return true;
+}
+
+void TokenBucket::Block(Clock::time_point until) {
+    next_ = std::max(next_, until + tolerance_);
+}
+
+SendSchedulerConfig MakeSendSchedulerConfig(IEnvManager& env) {
+    SendSchedulerConfig config;
+    config.global_per_second = std::stod(env.Get("SEND_GLOBAL_PER_SEC"));
+    config.chat_per_second = std::stod(env.Get("SEND_CHAT_PER_SEC"));
+    config.group_per_minute = std::stod(env.Get("SEND_GROUP_PER_MIN"));
+    config.senders = std::stoul(env.Get("SEND_CONCURRENCY"));
+    return config;
+}
+
+SendScheduler::SendScheduler(const std::shared_ptr<ISendTransport>& transport,
+                             const SendSchedulerConfig& config)
+    : transport_(transport), config_(config), global_(config.global_per_second) {
+    if (config_.senders == 0) {
+        throw std::invalid_argument("Send concurrency must be positive");
+    }
+    if (config_.chat_per_second <= 0 || config_.group_per_minute <= 0) {
+        throw std::invalid_argument("Per-chat send rates must be positive");
+    }
+}
+
+SendScheduler::~SendScheduler() { Stop(); }
+
+void SendScheduler::Start() {
+    std::lock_guard lock(mutex_);
+    if (!senders_.empty()) {
+        return;
+    }
+
+    spdlog::info("Start send scheduler. Global = {}/s, chat = {}/s, group = {}/min",
+                 config_.global_per_second, config_.chat_per_second,
+                 config_.group_per_minute);
+    stopping_ = false;
+    for (size_t i = 0; i < config_.senders; ++i) {
+        senders_.emplace_back(&SendScheduler::SenderLoop, this);
+    }
+}
+
+void SendScheduler::Stop() {
+    std::vector<std::thread> senders;
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+        senders = std::move(senders_);
+        senders_.clear();
+    }
+    cv_.notify_all();
+    for (auto& sender : senders) {
+        sender.join();
+    }
+
+    // Messages put back by a 429 while stopping are failed here as well
+    std::lock_guard lock(mutex_);
+    auto error = std::make_exception_ptr(SendCancelledError());
+    for (auto& [chat_id, chat] : chats_) {
+        for (auto& queue : chat.queues) {
+            for (auto& pending : queue) {
+                Complete(*pending, 0, error);
+            }
+            queue.clear();
+        }
+    }
+    chats_.clear();
+    for (auto& ready : ready_) {
+        ready.clear();
+    }
+    idle_.clear();
+    edits_.clear();
+    flushed_cv_.notify_all();
+}
+
+std::future<int32_t> SendScheduler::Enqueue(OutgoingMessage message,
+                                            SendPriority priority) {
+    std::promise<int32_t> promise;
+    std::future<int32_t> future = promise.get_future();
+
+    std::lock_guard lock(mutex_);
+    if (stopping_ && senders_.empty()) {
+        promise.set_exception(std::make_exception_ptr(SendCancelledError()));
+        return future;
+    }
+
+    EditKey key{message.chat_id, message.message_id};
+    if (IsEdit(message)) {
+        if (auto it = edits_.find(key); it != edits_.end()) {
+            // The queued edit keeps its place and now carries the newest text
+            it->second->message = std::move(message);
+            it->second->waiters.push_back(std::move(promise));
+            ++stats_.coalesced;
+            GetSendMetrics().coalesced.Add();
+            return future;
+        }
+    }
+
+    auto pending = std::make_shared<PendingSend>();
+    pending->message = std::move(message);
+    pending->priority = priority;
+    pending->trace = CurrentTraceContext();
+    pending->waiters.push_back(std::move(promise));
+    if (IsEdit(pending->message)) {
+        edits_[key] = pending;
+    }
+
+    auto index = static_cast<size_t>(priority);
+    ChatState& chat = GetChat(key.first);
+    if (chat.queues[index].empty()) {
+        ready_[index].push_back(key.first);
+    }
+    chat.queues[index].push_back(std::move(pending));
+
+    ++stats_.pending;
+    GetSendMetrics().pending.Add(1);
+    cv_.notify_one();
+    return future;
+}
+
+void SendScheduler::Flush() {
+    std::unique_lock lock(mutex_);
+    flushed_cv_.wait(lock, [this] { return stats_.pending == 0; });
+}
+
+SendSchedulerStats SendScheduler::Stats() {
+    std::lock_guard lock(mutex_);
+    return stats_;
+}
+
+void SendScheduler::SenderLoop() {
+    std::unique_lock lock(mutex_);
+    while (!stopping_) {
+        Clock::time_point now = Clock::now();
+        SweepIdle(now);
+
+        Clock::time_point wake_at = Clock::time_point::max();
+        PendingPtr pending = TakeNext(now, wake_at);
+        if (!pending) {
+            if (wake_at == Clock::time_point::max()) {
+                cv_.wait(lock);
+            } else {
+                cv_.wait_until(lock, wake_at);
+            }
+            continue;
+        }
+        lock.unlock();
+
+        int32_t message_id = 0;
+        std::exception_ptr error;
+        std::optional<std::chrono::milliseconds> retry_after;
+        {
+            ScopedTraceContext trace_scope(pending->trace);
+            Span span("tg.send");
+            if (span.IsRecording()) {
+                span.SetDetail(std::format("chat={}", pending->message.chat_id));
+            }
+            ScopedTimer timer(GetSendMetrics().duration);
+            try {
+                message_id = transport_->Send(pending->message);
+            } catch (const RetryAfterError& ex) {
+                retry_after = ex.retry_after;
+            } catch (const std::exception& ex) {
+                LOG_RATE_LIMITED(spdlog::level::err, 1,
+                                 "Failed to send message to chat = {}: {}",
+                                 pending->message.chat_id, ex.what());
+                error = std::current_exception();
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+
+        lock.lock();
+        int64_t chat_id = pending->message.chat_id;
+        chats_.at(chat_id).is_sending = false;
+        if (retry_after) {
+            LOG_RATE_LIMITED(spdlog::level::warn, 1,
+                             "Bot API asked to retry after {} ms, chat = {}",
+                             retry_after->count(), chat_id);
+            ++stats_.retried;
+            GetSendMetrics().retried.Add();
+            global_.Block(Clock::now() + *retry_after);
+            PushFront(std::move(pending));
+        } else {
+            Complete(*pending, message_id, error);
+        }
+
+        if (AllEmpty(chats_.at(chat_id).queues)) {
+            idle_.push_back(chat_id);
+        }
+        cv_.notify_all();
+    }
+}
+
+SendScheduler::PendingPtr SendScheduler::TakeNext(Clock::time_point now,
+                                                  Clock::time_point& wake_at) {
+    if (global_.ReadyAt() > now) {
+        wake_at = global_.ReadyAt();
+        return nullptr;
+    }
+
+    for (size_t index = 0; index < kSendPriorities; ++index) {
+        std::deque<int64_t>& ready = ready_[index];
+        for (auto it = ready.begin(); it != ready.end(); ++it) {
+            ChatState& chat = chats_.at(*it);
+            if (chat.is_sending) {
+                continue;
+            }
+            if (!chat.bucket.TryTake(now)) {
+                wake_at = std::min(wake_at, chat.bucket.ReadyAt());
+                continue;
+            }
+            global_.TryTake(now);
+
+            int64_t chat_id = *it;
+            PendingPtr pending = std::move(chat.queues[index].front());
+            chat.queues[index].pop_front();
+            ready.erase(it);
+            if (!chat.queues[index].empty()) {
+                ready.push_back(chat_id);
+            }
+            if (IsEdit(pending->message)) {
+                edits_.erase({chat_id, pending->message.message_id});
+            }
+            chat.is_sending = true;
+            return pending;
+        }
+    }
+    return nullptr;
+}
+
+void SendScheduler::PushFront(PendingPtr pending) {
+    int64_t chat_id = pending->message.chat_id;
+    if (IsEdit(pending->message)) {
+        EditKey key{chat_id, pending->message.message_id};
+        if (auto it = edits_.find(key); it != edits_.end()) {
+            // A newer edit of the message was queued meanwhile and supersedes this one
+            auto& waiters = it->second->waiters;
+            std::ranges::move(pending->waiters, std::back_inserter(waiters));
+            --stats_.pending;
+            GetSendMetrics().pending.Add(-1);
+            return;
+        }
+        edits_[key] = pending;
+    }
+
+    auto index = static_cast<size_t>(pending->priority);
+    std::deque<PendingPtr>& queue = chats_.at(chat_id).queues[index];
+    if (queue.empty()) {
+        ready_[index].push_front(chat_id);
+    }
+    queue.push_front(std::move(pending));
+}
+
+void SendScheduler::Complete(PendingSend& pending, int32_t message_id,
+                             std::exception_ptr error) {
+    for (auto& waiter : pending.waiters) {
+        if (error) {
+            waiter.set_exception(error);
+        } else {
+            waiter.set_value(message_id);
+        }
+    }
+    pending.waiters.clear();
+
+    if (error) {
+        ++stats_.failed;
+        GetSendMetrics().failed.Add();
+    } else {
+        ++stats_.sent;
+        GetSendMetrics().sent.Add();
+    }
+    --stats_.pending;
+    GetSendMetrics().pending.Add(-1);
+    if (stats_.pending == 0) {
+        flushed_cv_.notify_all();
+    }
+}
+
+void SendScheduler::SweepIdle(Clock::time_point now) {
+    while (!idle_.empty()) {
+        auto it = chats_.find(idle_.front());
+        if (it != chats_.end()) {
+            const ChatState& chat = it->second;
+            bool is_idle = !chat.is_sending && AllEmpty(chat.queues);
+            if (is_idle && chat.bucket.ReadyAt() > now) {
+                break;
+            }
+            if (is_idle) {
+                chats_.erase(it);
+            }
+        }
+        idle_.pop_front();
+    }
+}
+
+SendScheduler::ChatState& SendScheduler::GetChat(int64_t chat_id) {
+    if (auto it = chats_.find(chat_id); it != chats_.end()) {
+        return it->second;
+    }
+    double per_second =
+        chat_id < 0 ? config_.group_per_minute / 60 : config_.chat_per_second;
+    return chats_.emplace(chat_id, ChatState{{}, TokenBucket(per_second)}).first->second;
+}
+
+}    // namespace bot
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "env/env_manager.hpp"
+#include "tracing/tracer.hpp"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tgbot/Bot.h>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace bot {
+
+/// Interactive replies always leave before bulk notifications
+enum class SendPriority : size_t { kInteractive = 0, kBulk = 1 };
+
+constexpr size_t kSendPriorities = 2;
+
+struct OutgoingMessage {
+    int64_t chat_id = 0;
+    std::string text;
+    int32_t message_id = 0;    ///< Non-zero edits this message instead of sending
+    std::string parse_mode;
+};
+
+/// Telegram refused the request with 429 and asked to wait
+class RetryAfterError : public std::runtime_error {
+public:
+    explicit RetryAfterError(std::chrono::milliseconds retry_after)
+        : std::runtime_error("Too Many Requests"), retry_after(retry_after) {}
+
+    std::chrono::milliseconds retry_after;
+};
+
+/// The scheduler stopped before the message was sent
+class SendCancelledError : public std::runtime_error {
+public:
+    SendCancelledError() : std::runtime_error("Send scheduler is stopped") {}
+};
+
+/// The "retry after N" part of a Bot API 429 description
+std::optional<std::chrono::seconds> ParseRetryAfter(std::string_view description);
+
+class ISendTransport {
+public:
+    /// Returns the id of the sent or edited message. Throws RetryAfterError on 429.
+    virtual int32_t Send(const OutgoingMessage& message) = 0;
+    virtual ~ISendTransport() = default;
+};
+
+class TgApiSendTransport final : public ISendTransport {
+private:
+    std::shared_ptr<TgBot::Bot> bot_;
+
+public:
+    explicit TgApiSendTransport(const std::shared_ptr<TgBot::Bot>& bot);
+
+    int32_t Send(const OutgoingMessage& message) override;
+};
+
+/// GCRA token bucket: `per_second` tokens on average, up to `burst` at once
+class TokenBucket final {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    Clock::duration interval_;
+    Clock::duration tolerance_;
+    Clock::time_point next_{};    ///< Theoretical arrival time of the next token
+
+public:
+    explicit TokenBucket(double per_second, size_t burst = 1);
+
+    /// Earliest time TryTake succeeds
+    Clock::time_point ReadyAt() const { return next_ - tolerance_; }
+
+    bool TryTake(Clock::time_point now);
+
+    /// No tokens are handed out before `until`
+    void Block(Clock::time_point until);
+};
+
+struct SendSchedulerConfig {
+    double global_per_second = 25;    ///< Telegram allows about 30
+    double chat_per_second = 1;
+    double group_per_minute = 20;    ///< Chats with a negative id
+    size_t senders = 4;    ///< Concurrent Bot API requests
+};
+
+SendSchedulerConfig MakeSendSchedulerConfig(IEnvManager& env);
+
+struct SendSchedulerStats {
+    size_t pending = 0;
+    uint64_t sent = 0;
+    uint64_t failed = 0;
+    uint64_t retried = 0;    ///< Requests answered with retry_after
+    uint64_t coalesced = 0;    ///< Edits merged into an already queued edit
+};
+
+/// Sends messages through an ISendTransport without exceeding the global and per-chat
+/// Bot API limits. Messages of one chat leave in order within a priority and one at a
+/// time; a queued edit of the same message is replaced instead of sent twice. A 429
+/// pauses every sender for retry_after and puts the message back in front.
+class SendScheduler final {
+private:
+    using Clock = TokenBucket::Clock;
+    using EditKey = std::pair<int64_t, int32_t>;
+
+    struct PendingSend {
+        OutgoingMessage message;
+        SendPriority priority;
+        TraceContext trace;    ///< Context of the enqueuing thread
+        std::vector<std::promise<int32_t>> waiters;
+    };
+
+    using PendingPtr = std::shared_ptr<PendingSend>;
+
+    struct ChatState {
+        std::array<std::deque<PendingPtr>, kSendPriorities> queues;
+        TokenBucket bucket;
+        bool is_sending = false;
+    };
+
+    std::shared_ptr<ISendTransport> transport_;
+    SendSchedulerConfig config_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable flushed_cv_;
+    std::unordered_map<int64_t, ChatState> chats_;
+    /// Chats with queued messages of the priority, served round robin
+    std::array<std::deque<int64_t>, kSendPriorities> ready_;
+    /// Chats left without messages, dropped once their bucket is full again
+    std::deque<int64_t> idle_;
+    std::map<EditKey, PendingPtr> edits_;
+    TokenBucket global_;    ///< Also blocked for retry_after
+    SendSchedulerStats stats_;
+    bool stopping_ = false;
+
+    std::vector<std::thread> senders_;
+
+public:
+    SendScheduler(const std::shared_ptr<ISendTransport>& transport,
+                  const SendSchedulerConfig& config = {});
+    ~SendScheduler();
+
+    SendScheduler(const SendScheduler&) = delete;
+    SendScheduler& operator=(const SendScheduler&) = delete;
+
+    void Start();
+
+    /// Fails messages that are still queued and joins the senders
+    void Stop();
+
+    /// The future holds the message id once Telegram accepted the message
+    std::future<int32_t> Enqueue(OutgoingMessage message,
+                                 SendPriority priority = SendPriority::kInteractive);
+
+    /// Blocks until every queued message is sent or failed
+    void Flush();
+
+    SendSchedulerStats Stats();
+
+private:
+    void SenderLoop();
+    PendingPtr TakeNext(Clock::time_point now, Clock::time_point& wake_at);
+    void PushFront(PendingPtr pending);
+    void Complete(PendingSend& pending, int32_t message_id, std::exception_ptr error);
+    void SweepIdle(Clock::time_point now);
+    ChatState& GetChat(int64_t chat_id);
+};
+
+}    // namespace bot
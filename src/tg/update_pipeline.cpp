@@ -0,0 +1,287 @@
+#include "update_pipeline.hpp"
+#include "logging/log_limiter.hpp"
+#include "metrics/metrics.hpp"
+#include "tracing/tracer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <format>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace bot {
+
+namespace {
+
+template <typename T> void UpdateMax(std::atomic<T>& target, T value) {
+    T current = target.load(std::memory_order_relaxed);
+    while (current < value &&
+           !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+struct PipelineMetrics {
+    Histogram& handle_duration = Metrics().GetHistogram(
+        "tg_update_handle_duration_seconds", "Time spent in the update handler");
+    Counter& processed =
+        Metrics().GetCounter("tg_updates_total", "Telegram updates handled");
+    Counter& failed =
+        Metrics().GetCounter("tg_update_failures_total", "Updates whose handler threw");
+    Gauge& queue_depth = Metrics().GetGauge("tg_update_queue_depth",
+                                            "Updates accepted but not handled yet");
+};
+
+PipelineMetrics& GetPipelineMetrics() {
+    static PipelineMetrics metrics;
+    return metrics;
+}
+
+}    // namespace
+
+int64_t GetChatId(const TgBot::Update::Ptr& update) {
+    if (update->message && update->message->chat) {
+        return update->message->chat->id;
+    }
+    if (update->editedMessage && update->editedMessage->chat) {
+        return update->editedMessage->chat->id;
+    }
+    if (const auto& query = update->callbackQuery) {
+        if (query->message && query->message->chat) {
+            return query->message->chat->id;
+        }
+        if (query->from) {
+            return query->from->id;
+        }
+    }
+    return 0;
+}
+
+UpdatePipeline::UpdatePipeline(const std::shared_ptr<IUpdateSource>& source,
+                               UpdateHandler handler, const PipelineConfig& config)
+    : source_(source), handler_(std::move(handler)), capacity_(config.queue_capacity),
+      workers_count_(config.workers), ready_(config.queue_capacity) {
+    if (capacity_ == 0) {
+        throw std::invalid_argument("Update queue capacity must be positive");
+    }
+    if (workers_count_ == 0) {
+        workers_count_ = std::max(1U, std::thread::hardware_concurrency());
+    }
+}
+
+UpdatePipeline::~UpdatePipeline() { Stop(); }
+
+void UpdatePipeline::Start() {
+    if (!workers_.empty()) {
+        return;
+    }
+
+    spdlog::info("Start update pipeline. Workers = {}, queue capacity = {}",
+                 workers_count_, capacity_);
+    stopping_ = false;
+    pending_.fetch_and(~kClosed);
+    for (size_t i = 0; i < workers_count_; ++i) {
+        workers_.emplace_back(&UpdatePipeline::WorkerLoop, this);
+    }
+}
+
+void UpdatePipeline::Run() {
+    Start();
+    polling_ = true;
+
+    while (polling_) {
+        std::vector<TgBot::Update::Ptr> updates;
+        try {
+            updates = source_->Poll();
+        } catch (std::exception& ex) {
+            spdlog::error("Failed to poll updates = {}", ex.what());
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            continue;
+        }
+
+        for (auto& update : updates) {
+            if (!Submit(std::move(update))) {
+                break;
+            }
+        }
+    }
+}
+
+void UpdatePipeline::Stop() {
+    polling_ = false;
+    if (workers_.empty()) {
+        return;
+    }
+
+    // Wakes the producers waiting for a slot; their CAS fails on the changed word
+    pending_.fetch_or(kClosed);
+    pending_.notify_all();
+    WaitIdle();
+
+    stopping_ = true;
+    ready_signal_.release(static_cast<std::ptrdiff_t>(workers_.size()));
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+bool UpdatePipeline::Submit(TgBot::Update::Ptr update) {
+    if (!AcquireSlot()) {
+        return false;
+    }
+    ++submitted_;
+
+    int64_t chat_id = GetChatId(update);
+    MailboxShard& shard = ShardOf(chat_id);
+    bool is_idle_chat = false;
+    {
+        std::lock_guard lock(shard.mutex);
+        auto [it, inserted] = shard.mailboxes.try_emplace(chat_id);
+        it->second.push_back(std::move(update));
+        is_idle_chat = inserted;
+    }
+
+    if (is_idle_chat) {
+        Schedule(chat_id);
+    }
+    return true;
+}
+
+void UpdatePipeline::WaitIdle() {
+    size_t current = pending_.load();
+    while ((current & ~kClosed) != 0) {
+        pending_.wait(current);
+        current = pending_.load();
+    }
+}
+
+PipelineStats UpdatePipeline::Stats() const {
+    PipelineStats stats;
+    stats.queue_depth = pending_.load(std::memory_order_relaxed) & ~kClosed;
+    stats.max_queue_depth = max_pending_.load(std::memory_order_relaxed);
+    stats.submitted = submitted_.load(std::memory_order_relaxed);
+    stats.processed = processed_.load(std::memory_order_relaxed);
+    stats.failed = failed_.load(std::memory_order_relaxed);
+    stats.backpressure_waits = backpressure_waits_.load(std::memory_order_relaxed);
+    stats.handler_latency_total =
+        std::chrono::nanoseconds(latency_total_ns_.load(std::memory_order_relaxed));
+    stats.handler_latency_max =
+        std::chrono::nanoseconds(latency_max_ns_.load(std::memory_order_relaxed));
+    return stats;
+}
+
+void UpdatePipeline::WorkerLoop() {
+    while (true) {
+        ready_signal_.acquire();
+        if (stopping_) {
+            return;
+        }
+
+        int64_t chat_id = 0;
+        while (!ready_.TryPop(chat_id)) {
+            std::this_thread::yield();
+        }
+
+        MailboxShard& shard = ShardOf(chat_id);
+        TgBot::Update::Ptr update;
+        {
+            std::lock_guard lock(shard.mutex);
+            auto& mailbox = shard.mailboxes.at(chat_id);
+            update = std::move(mailbox.front());
+            mailbox.pop_front();
+        }
+
+        Handle(update);
+        ReleaseSlot();
+
+        bool has_more = false;
+        {
+            std::lock_guard lock(shard.mutex);
+            auto it = shard.mailboxes.find(chat_id);
+            has_more = !it->second.empty();
+            if (!has_more) {
+                shard.mailboxes.erase(it);
+            }
+        }
+
+        if (has_more) {
+            Schedule(chat_id);
+        }
+    }
+}
+
+void UpdatePipeline::Schedule(int64_t chat_id) {
+    // Every scheduled chat holds at least one slot, so the ring never overflows
+    while (!ready_.TryPush(chat_id)) {
+        std::this_thread::yield();
+    }
+    ready_signal_.release();
+}
+
+UpdatePipeline::MailboxShard& UpdatePipeline::ShardOf(int64_t chat_id) {
+    return mailbox_shards_[static_cast<uint64_t>(chat_id) % kMailboxShards];
+}
+
+void UpdatePipeline::Handle(const TgBot::Update::Ptr& update) {
+    PipelineMetrics& metrics = GetPipelineMetrics();
+    Span span = Span::Root("tg.update");
+    if (span.IsRecording()) {
+        span.SetDetail(std::format("update_id = {}, chat_id = {}", update->updateId,
+                                   GetChatId(update)));
+    }
+    auto start = std::chrono::steady_clock::now();
+    try {
+        handler_(update);
+    } catch (std::exception& ex) {
+        ++failed_;
+        metrics.failed.Add();
+        LOG_RATE_LIMITED(spdlog::level::err, 10,
+                         "Failed to handle update = {}. Error = {}", update->updateId,
+                         ex.what());
+    }
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+
+    ++processed_;
+    metrics.processed.Add();
+    metrics.handle_duration.Record(static_cast<uint64_t>(elapsed));
+    latency_total_ns_.fetch_add(elapsed, std::memory_order_relaxed);
+    UpdateMax(latency_max_ns_, elapsed);
+}
+
+bool UpdatePipeline::AcquireSlot() {
+    size_t current = pending_.load();
+    bool is_waiting = false;
+    while (true) {
+        if (current & kClosed) {
+            return false;
+        }
+        if (current >= capacity_) {
+            if (!std::exchange(is_waiting, true)) {
+                ++backpressure_waits_;
+            }
+            pending_.wait(current);
+            current = pending_.load();
+            continue;
+        }
+        if (pending_.compare_exchange_weak(current, current + 1)) {
+            UpdateMax(max_pending_, current + 1);
+            GetPipelineMetrics().queue_depth.Add(1);
+            return true;
+        }
+    }
+}
+
+void UpdatePipeline::ReleaseSlot() {
+    pending_.fetch_sub(1);
+    // Producers waiting for a slot and WaitIdle; cheap while nobody waits
+    pending_.notify_all();
+    GetPipelineMetrics().queue_depth.Add(-1);
+}
+
+}    // namespace bot
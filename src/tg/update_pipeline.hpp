@@ -0,0 +1,115 @@
+#pragma once
+
+#include "concurrency/bounded_queue.hpp"
+#include "tg/update_source.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <tgbot/types/Update.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace bot {
+
+using UpdateHandler = std::function<void(const TgBot::Update::Ptr&)>;
+
+struct PipelineConfig {
+    size_t workers = 0;    ///< 0 means one worker per hardware thread
+    size_t queue_capacity = 1024;
+};
+
+struct PipelineStats {
+    size_t queue_depth = 0;
+    size_t max_queue_depth = 0;
+    uint64_t submitted = 0;
+    uint64_t processed = 0;
+    uint64_t failed = 0;
+    uint64_t backpressure_waits = 0;
+    std::chrono::nanoseconds handler_latency_total{0};
+    std::chrono::nanoseconds handler_latency_max{0};
+};
+
+/// Reads updates from an IUpdateSource and runs the handler on a worker pool. Updates
+/// of one chat are handled strictly in order and never concurrently; different chats
+/// run in parallel, so a slow handler only holds back its own chat.
+class UpdatePipeline final {
+private:
+    static constexpr size_t kMailboxShards = 16;
+    /// Set in pending_ while Submit is refused: before Start and from Stop on
+    static constexpr size_t kClosed = size_t{1} << (sizeof(size_t) * 8 - 1);
+
+    std::shared_ptr<IUpdateSource> source_;
+    UpdateHandler handler_;
+    size_t capacity_;
+    size_t workers_count_;
+
+    /// A chat has a mailbox while it is queued in ready_ or held by a worker. Chats are
+    /// spread over shards, so producers and workers of different chats rarely meet on a
+    /// lock.
+    struct alignas(kCacheLineSize) MailboxShard {
+        std::mutex mutex;
+        std::unordered_map<int64_t, std::deque<TgBot::Update::Ptr>> mailboxes;
+    };
+
+    std::array<MailboxShard, kMailboxShards> mailbox_shards_;
+    BoundedQueue<int64_t> ready_;
+    std::counting_semaphore<> ready_signal_{0};
+
+    std::vector<std::thread> workers_;
+    std::atomic<bool> polling_{false};
+    std::atomic<bool> stopping_{false};
+
+    /// Updates accepted and not handled yet, plus kClosed. Slots are taken by CAS on
+    /// this one word, so Stop closing it and a producer taking a slot cannot interleave.
+    std::atomic<size_t> pending_{kClosed};
+    std::atomic<size_t> max_pending_{0};
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> processed_{0};
+    std::atomic<uint64_t> failed_{0};
+    std::atomic<uint64_t> backpressure_waits_{0};
+    std::atomic<int64_t> latency_total_ns_{0};
+    std::atomic<int64_t> latency_max_ns_{0};
+
+public:
+    UpdatePipeline(const std::shared_ptr<IUpdateSource>& source, UpdateHandler handler,
+                   const PipelineConfig& config = {});
+    ~UpdatePipeline();
+
+    UpdatePipeline(const UpdatePipeline&) = delete;
+    UpdatePipeline& operator=(const UpdatePipeline&) = delete;
+
+    void Start();
+
+    /// Polls the source on the calling thread until Stop()
+    void Run();
+
+    /// Stops polling, lets the workers drain accepted updates and joins them
+    void Stop();
+
+    /// Blocks while the pipeline is full. Returns false unless the pipeline is started.
+    bool Submit(TgBot::Update::Ptr update);
+
+    void WaitIdle();
+
+    PipelineStats Stats() const;
+
+private:
+    void WorkerLoop();
+    void Schedule(int64_t chat_id);
+    MailboxShard& ShardOf(int64_t chat_id);
+    void Handle(const TgBot::Update::Ptr& update);
+    bool AcquireSlot();
+    void ReleaseSlot();
+};
+
+int64_t GetChatId(const TgBot::Update::Ptr& update);
+
+}    // namespace bot
@@ -0,0 +1,23 @@
+#include "update_source.hpp"
+#include <algorithm>
+#include <memory>
+#include <tgbot/Api.h>
+#include <vector>
+
+namespace bot {
+
+LongPollUpdateSource::LongPollUpdateSource(const std::shared_ptr<TgBot::Bot>& bot,
+                                           int32_t limit, int32_t timeout)
+    : bot_(bot), limit_(limit), timeout_(timeout) {}
+
+std::vector<TgBot::Update::Ptr> LongPollUpdateSource::Poll() {
+    std::vector<TgBot::Update::Ptr> updates =
+        bot_->getApi().getUpdates(offset_, limit_, timeout_);
+
+    for (const auto& update : updates) {
+        offset_ = std::max(offset_, update->updateId + 1);
+    }
+    return updates;
+}
+
+}    // namespace bot
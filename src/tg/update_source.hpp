@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <tgbot/Bot.h>
+#include <tgbot/types/Update.h>
+#include <vector>
+
+namespace bot {
+
+static const int32_t kDefaultPollLimit = 100;
+static const int32_t kDefaultPollTimeout = 25;
+
+class IUpdateSource {
+public:
+    /// Blocks until a batch of updates is available or the source times out
+    virtual std::vector<TgBot::Update::Ptr> Poll() = 0;
+    virtual ~IUpdateSource() = default;
+};
+
+class LongPollUpdateSource final : public IUpdateSource {
+private:
+    std::shared_ptr<TgBot::Bot> bot_;
+    int32_t limit_;
+    int32_t timeout_;
+    int32_t offset_ = 0;
+
+public:
+    LongPollUpdateSource(const std::shared_ptr<TgBot::Bot>& bot,
+                         int32_t limit = kDefaultPollLimit,
+                         int32_t timeout = kDefaultPollTimeout);
+
+    std::vector<TgBot::Update::Ptr> Poll() override;
+};
+
+}    // namespace bot
@@ -0,0 +1,264 @@
+#include "webhook_server.hpp"
+#include "logging/log_limiter.hpp"
+#include "metrics/metrics.hpp"
+#include <algorithm>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/ip/address.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <exception>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace bot {
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = asio::ip::tcp;
+
+namespace {
+
+constexpr const char* kSecretHeader = "X-Telegram-Bot-Api-Secret-Token";
+
+struct WebhookMetrics {
+    Counter& accepted =
+        Metrics().GetCounter("tg_webhook_updates_total", "Updates received by webhook");
+    Counter& unauthorized = Metrics().GetCounter(
+        "tg_webhook_rejected_total", "Webhook requests answered with an error",
+        {{"reason", "secret"}});
+    Counter& bad_request = Metrics().GetCounter(
+        "tg_webhook_rejected_total", "Webhook requests answered with an error",
+        {{"reason", "bad_request"}});
+    Counter& overloaded = Metrics().GetCounter(
+        "tg_webhook_rejected_total", "Webhook requests answered with an error",
+        {{"reason", "overloaded"}});
+};
+
+WebhookMetrics& GetWebhookMetrics() {
+    static WebhookMetrics metrics;
+    return metrics;
+}
+
+/// Takes the same time for every mismatch position, so the secret cannot be guessed
+/// byte by byte from response times
+bool IsSameSecret(std::string_view lhs, std::string_view rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    unsigned char difference = 0;
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        difference |= static_cast<unsigned char>(lhs[i] ^ rhs[i]);
+    }
+    return difference == 0;
+}
+
+}    // namespace
+
+/// One keep-alive connection. Handlers of a session run on its strand, so the
+/// session itself needs no locking.
+class WebhookServer::Session : public std::enable_shared_from_this<Session> {
+private:
+    WebhookServer& server_;
+    beast::tcp_stream stream_;
+    beast::flat_buffer buffer_;
+    std::optional<http::request_parser<http::string_body>> parser_;
+    http::response<http::empty_body> response_;
+
+public:
+    Session(WebhookServer& server, tcp::socket socket)
+        : server_(server), stream_(std::move(socket)) {}
+
+    void Run() {
+        asio::dispatch(stream_.get_executor(),
+                       beast::bind_front_handler(&Session::Read, shared_from_this()));
+    }
+
+private:
+    void Read() {
+        parser_.emplace();
+        parser_->body_limit(server_.config_.max_body_size);
+        stream_.expires_after(server_.config_.read_timeout);
+        http::async_read(stream_, buffer_, *parser_,
+                         beast::bind_front_handler(&Session::OnRead, shared_from_this()));
+    }
+
+    void OnRead(beast::error_code error, size_t) {
+        if (error == http::error::end_of_stream) {
+            Close();
+            return;
+        }
+        if (error == http::error::body_limit) {
+            Respond(http::status::payload_too_large, false);
+            return;
+        }
+        if (error) {
+            return;
+        }
+
+        const auto& request = parser_->get();
+        Respond(server_.Handle(request), request.keep_alive());
+    }
+
+    void Respond(http::status status, bool keep_alive) {
+        response_ = {};
+        response_.version(11);
+        response_.result(status);
+        response_.keep_alive(keep_alive);
+        response_.prepare_payload();
+        http::async_write(
+            stream_, response_,
+            beast::bind_front_handler(&Session::OnWrite, shared_from_this()));
+    }
+
+    void OnWrite(beast::error_code error, size_t) {
+        if (error) {
+            return;
+        }
+        if (!response_.keep_alive()) {
+            Close();
+            return;
+        }
+        Read();
+    }
+
+    void Close() {
+        beast::error_code ignored;
+        stream_.socket().shutdown(tcp::socket::shutdown_send, ignored);
+    }
+};
+
+WebhookConfig MakeWebhookConfig(IEnvManager& env) {
+    WebhookConfig config;
+    config.address = env.Get("WEBHOOK_ADDRESS");
+    config.port = static_cast<uint16_t>(std::stoul(env.Get("WEBHOOK_PORT")));
+    config.path = env.Get("WEBHOOK_PATH");
+    config.secret_token = env.Get("WEBHOOK_SECRET");
+    config.threads = std::stoul(env.Get("WEBHOOK_THREADS"));
+    return config;
+}
+
+WebhookServer::WebhookServer(const WebhookConfig& config, UpdateSink sink)
+    : config_(config), sink_(std::move(sink)), acceptor_(io_context_) {
+    if (config_.secret_token.empty()) {
+        throw std::invalid_argument("Webhook secret token must be set");
+    }
+    if (config_.threads == 0) {
+        config_.threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+}
+
+WebhookServer::~WebhookServer() { Stop(); }
+
+void WebhookServer::Start() {
+    if (!threads_.empty()) {
+        return;
+    }
+
+    tcp::endpoint endpoint(asio::ip::make_address(config_.address), config_.port);
+    acceptor_.open(endpoint.protocol());
+    acceptor_.set_option(asio::socket_base::reuse_address(true));
+    acceptor_.bind(endpoint);
+    acceptor_.listen(asio::socket_base::max_listen_connections);
+    Accept();
+
+    spdlog::info("Start webhook server on {}:{}{}. Threads = {}", config_.address, Port(),
+                 config_.path, config_.threads);
+    is_stopped_ = false;
+    for (size_t i = 0; i < config_.threads; ++i) {
+        threads_.emplace_back([this] { io_context_.run(); });
+    }
+}
+
+void WebhookServer::Stop() {
+    if (threads_.empty()) {
+        return;
+    }
+
+    // Pending handlers, and the sessions they own, are destroyed with io_context_
+    io_context_.stop();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+    beast::error_code ignored;
+    acceptor_.close(ignored);
+
+    is_stopped_ = true;
+    is_stopped_.notify_all();
+}
+
+void WebhookServer::Wait() { is_stopped_.wait(false); }
+
+uint16_t WebhookServer::Port() const { return acceptor_.local_endpoint().port(); }
+
+WebhookStats WebhookServer::Stats() const {
+    return {accepted_.load(std::memory_order_relaxed),
+            unauthorized_.load(std::memory_order_relaxed),
+            bad_requests_.load(std::memory_order_relaxed),
+            overloaded_.load(std::memory_order_relaxed)};
+}
+
+void WebhookServer::Accept() {
+    auto on_accept = [this](beast::error_code error, tcp::socket socket) {
+        if (error == asio::error::operation_aborted) {
+            return;
+        }
+        if (error) {
+            LOG_RATE_LIMITED(spdlog::level::err, 1, "Webhook accept failed = {}",
+                             error.message());
+        } else {
+            std::make_shared<Session>(*this, std::move(socket))->Run();
+        }
+        Accept();
+    };
+    acceptor_.async_accept(asio::make_strand(io_context_), std::move(on_accept));
+}
+
+http::status WebhookServer::Handle(const http::request<http::string_body>& request) {
+    if (request.target() != config_.path) {
+        return http::status::not_found;
+    }
+    if (request.method() != http::verb::post) {
+        return http::status::method_not_allowed;
+    }
+
+    auto secret = request.find(kSecretHeader);
+    if (secret == request.end() ||
+        !IsSameSecret({secret->value().data(), secret->value().size()},
+                      config_.secret_token)) {
+        unauthorized_.fetch_add(1, std::memory_order_relaxed);
+        GetWebhookMetrics().unauthorized.Add();
+        LOG_RATE_LIMITED(spdlog::level::warn, 1, "Webhook request with a wrong secret");
+        return http::status::unauthorized;
+    }
+
+    // The body is parsed where Beast received it and the update is moved to the sink
+    TgBot::Update::Ptr update;
+    try {
+        update = parser_.parseJsonAndGetUpdate(nlohmann::json::parse(request.body()));
+    } catch (const std::exception& ex) {
+        bad_requests_.fetch_add(1, std::memory_order_relaxed);
+        GetWebhookMetrics().bad_request.Add();
+        LOG_RATE_LIMITED(spdlog::level::warn, 1, "Malformed webhook update = {}",
+                         ex.what());
+        return http::status::bad_request;
+    }
+
+    if (!sink_(std::move(update))) {
+        overloaded_.fetch_add(1, std::memory_order_relaxed);
+        GetWebhookMetrics().overloaded.Add();
+        return http::status::service_unavailable;
+    }
+    accepted_.fetch_add(1, std::memory_order_relaxed);
+    GetWebhookMetrics().accepted.Add();
+    return http::status::ok;
+}
+
+}    // namespace bot
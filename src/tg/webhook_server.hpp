@@ -0,0 +1,98 @@
+#pragma once
+
+#include "env/env_manager.hpp"
+#include <atomic>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/status.hpp>
+#include <boost/beast/http/string_body.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <tgbot/TgTypeParser.h>
+#include <tgbot/types/Update.h>
+#include <thread>
+#include <vector>
+
+namespace bot {
+
+/// Takes ownership of a parsed update. Returns false when the update was not accepted.
+using UpdateSink = std::function<bool(TgBot::Update::Ptr)>;
+
+struct WebhookConfig {
+    std::string address = "0.0.0.0";
+    uint16_t port = 8443;    ///< 0 picks a free port, see WebhookServer::Port()
+    std::string path = "/telegram/webhook";
+    std::string secret_token;    ///< Expected X-Telegram-Bot-Api-Secret-Token
+    size_t threads = 0;    ///< 0 means one per hardware thread
+    size_t max_body_size = 1024 * 1024;
+    std::chrono::seconds read_timeout{30};
+};
+
+WebhookConfig MakeWebhookConfig(IEnvManager& env);
+
+struct WebhookStats {
+    uint64_t accepted = 0;
+    uint64_t unauthorized = 0;
+    uint64_t bad_requests = 0;
+    uint64_t overloaded = 0;    ///< The sink refused the update
+};
+
+/// HTTP/1.1 server for Telegram webhook POSTs on Boost.Beast. Connections are served
+/// asynchronously by a pool of threads running one io_context; each connection is
+/// bound to a strand. The body is parsed in the receive buffer and the update goes
+/// straight to the sink. Try it with
+///
+///     curl -H 'X-Telegram-Bot-Api-Secret-Token: <secret>' \
+///          -d '{"update_id": 1}' http://127.0.0.1:8443/telegram/webhook
+class WebhookServer final {
+private:
+    class Session;
+
+    WebhookConfig config_;
+    UpdateSink sink_;
+    TgBot::TgTypeParser parser_;
+
+    std::atomic<uint64_t> accepted_{0};
+    std::atomic<uint64_t> unauthorized_{0};
+    std::atomic<uint64_t> bad_requests_{0};
+    std::atomic<uint64_t> overloaded_{0};
+    std::atomic<bool> is_stopped_{false};
+
+    boost::asio::io_context io_context_;
+    boost::asio::ip::tcp::acceptor acceptor_;
+    std::vector<std::thread> threads_;
+
+public:
+    /// Throws std::invalid_argument without a secret token
+    WebhookServer(const WebhookConfig& config, UpdateSink sink);
+    ~WebhookServer();
+
+    WebhookServer(const WebhookServer&) = delete;
+    WebhookServer& operator=(const WebhookServer&) = delete;
+
+    /// Binds the port and starts the threads
+    void Start();
+
+    /// Closes the listener and open connections and joins the threads
+    void Stop();
+
+    /// Blocks until Stop()
+    void Wait();
+
+    uint16_t Port() const;
+
+    WebhookStats Stats() const;
+
+private:
+    void Accept();
+
+    /// Validates and parses one request and hands the update to the sink
+    boost::beast::http::status
+    Handle(const boost::beast::http::request<boost::beast::http::string_body>& request);
+};
+
+}    // namespace bot
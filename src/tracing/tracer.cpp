@@ -0,0 +1,305 @@
+#include "tracer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace bot {
+
+namespace {
+
+std::atomic<uint64_t> next_tracer_id{1};
+std::atomic<uint32_t> next_thread_id{1};
+std::atomic<uint64_t> next_span_sequence{1};
+
+thread_local TraceContext current_context;
+
+uint64_t SampleThreshold(double rate) {
+    if (!(rate > 0)) {
+        return 0;
+    }
+    if (rate >= 1) {
+        return UINT64_MAX;
+    }
+    return static_cast<uint64_t>(std::ldexp(rate, 64));
+}
+
+/// splitmix64 over a per-thread state; ids only need to be unique, not secret
+uint64_t NextRandom() {
+    thread_local uint64_t state =
+        std::random_device{}() ^ std::hash<std::thread::id>{}(std::this_thread::get_id());
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+uint64_t NextId() {
+    uint64_t id = NextRandom();
+    return id == 0 ? 1 : id;
+}
+
+uint32_t ThreadId() {
+    thread_local const uint32_t id = next_thread_id.fetch_add(1);
+    return id;
+}
+
+int64_t UnixNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+std::string Hex(uint64_t id) { return std::format("{:016x}", id); }
+
+}    // namespace
+
+TracerConfig MakeTracerConfig(IEnvManager& env) {
+    TracerConfig config;
+    config.sample_rate = std::stod(env.Get("TRACE_SAMPLE_RATE"));
+    config.buffer_spans = std::stoul(env.Get("TRACE_BUFFER_SPANS"));
+    return config;
+}
+
+Tracer::Tracer(const TracerConfig& config)
+    : sample_threshold_(SampleThreshold(config.sample_rate)),
+      buffer_spans_(std::max<size_t>(config.buffer_spans, 1)),
+      id_(next_tracer_id.fetch_add(1)),
+      pool_(std::make_shared<BufferPool>()) {}
+
+void Tracer::Configure(const TracerConfig& config) {
+    sample_threshold_.store(SampleThreshold(config.sample_rate));
+    buffer_spans_.store(std::max<size_t>(config.buffer_spans, 1));
+}
+
+bool Tracer::ShouldSample() const {
+    uint64_t threshold = sample_threshold_.load(std::memory_order_relaxed);
+    return threshold == UINT64_MAX || (threshold != 0 && NextRandom() < threshold);
+}
+
+void Tracer::Record(SpanRecord span) {
+    ThreadBuffer& buffer = LocalBuffer();
+    std::lock_guard lock(buffer.mutex);
+    span.thread_id = buffer.thread_id;
+    if (buffer.spans.size() < buffer.capacity) {
+        buffer.spans.push_back(std::move(span));
+    } else {
+        buffer.spans[buffer.next % buffer.capacity] = std::move(span);
+    }
+    ++buffer.next;
+}
+
+std::vector<SpanRecord> Tracer::Collect() {
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard lock(pool_->mutex);
+        buffers = pool_->buffers;
+    }
+
+    std::vector<SpanRecord> spans;
+    for (const auto& buffer : buffers) {
+        std::lock_guard lock(buffer->mutex);
+        spans.insert(spans.end(), buffer->spans.begin(), buffer->spans.end());
+    }
+    std::ranges::sort(spans, {}, &SpanRecord::sequence);
+    return spans;
+}
+
+std::string Tracer::ExportChromeJson() {
+    nlohmann::json events = nlohmann::json::array();
+    for (const auto& span : Collect()) {
+        nlohmann::json args = {{"trace_id", Hex(span.trace_id)},
+                               {"span_id", Hex(span.span_id)},
+                               {"parent_id", Hex(span.parent_id)}};
+        if (!span.detail.empty()) {
+            args["detail"] = span.detail;
+        }
+        events.push_back({{"name", span.name},
+                          {"cat", "bot"},
+                          {"ph", "X"},
+                          {"ts", static_cast<double>(span.start_ns) / 1000},
+                          {"dur", static_cast<double>(span.duration_ns) / 1000},
+                          {"pid", 1},
+                          {"tid", span.thread_id},
+                          {"args", std::move(args)}});
+    }
+    return nlohmann::json{{"traceEvents", std::move(events)}, {"displayTimeUnit", "ms"}}
+        .dump();
+}
+
+std::string Tracer::ExportOtlpJson() {
+    nlohmann::json spans = nlohmann::json::array();
+    for (const auto& span : Collect()) {
+        nlohmann::json attributes = {
+            {{"key", "thread.id"},
+             {"value", {{"intValue", std::to_string(span.thread_id)}}}}};
+        if (!span.detail.empty()) {
+            attributes.push_back(
+                {{"key", "detail"}, {"value", {{"stringValue", span.detail}}}});
+        }
+        nlohmann::json otlp_span = {
+            {"traceId", Hex(0) + Hex(span.trace_id)},
+            {"spanId", Hex(span.span_id)},
+            {"name", span.name},
+            {"kind", 1},
+            {"startTimeUnixNano", std::to_string(span.start_ns)},
+            {"endTimeUnixNano", std::to_string(span.start_ns + span.duration_ns)},
+            {"attributes", std::move(attributes)}};
+        if (span.parent_id != 0) {
+            otlp_span["parentSpanId"] = Hex(span.parent_id);
+        }
+        spans.push_back(std::move(otlp_span));
+    }
+
+    nlohmann::json resource = {
+        {"attributes",
+         {{{"key", "service.name"}, {"value", {{"stringValue", "bot"}}}}}}};
+    nlohmann::json scope_spans = {
+        {{"scope", {{"name", "bot"}}}, {"spans", std::move(spans)}}};
+    return nlohmann::json{
+        {"resourceSpans", {{{"resource", std::move(resource)},
+                            {"scopeSpans", std::move(scope_spans)}}}}}
+        .dump();
+}
+
+Tracer::ThreadBuffer& Tracer::LocalBuffer() {
+    /// Hands the ring back to its tracer when the thread exits or moves to another
+    /// tracer; the tracer keeps it, so its spans stay exportable
+    struct Owner {
+        uint64_t tracer_id = 0;
+        ThreadBuffer* buffer = nullptr;
+        std::weak_ptr<BufferPool> pool;
+
+        ~Owner() { Release(); }
+
+        void Release() {
+            if (auto locked = pool.lock(); locked && buffer != nullptr) {
+                std::lock_guard lock(locked->mutex);
+                locked->free.push_back(buffer);
+            }
+            tracer_id = 0;
+            buffer = nullptr;
+            pool.reset();
+        }
+    };
+    thread_local Owner owner;
+    if (owner.tracer_id == id_) {
+        return *owner.buffer;
+    }
+    owner.Release();
+
+    ThreadBuffer* buffer = nullptr;
+    {
+        std::lock_guard lock(pool_->mutex);
+        if (!pool_->free.empty()) {
+            buffer = pool_->free.back();
+            pool_->free.pop_back();
+        }
+    }
+    if (buffer == nullptr) {
+        auto created = std::make_shared<ThreadBuffer>();
+        created->capacity = buffer_spans_.load();
+        created->spans.reserve(created->capacity);
+        buffer = created.get();
+        std::lock_guard lock(pool_->mutex);
+        pool_->buffers.push_back(std::move(created));
+    }
+    {
+        std::lock_guard lock(buffer->mutex);
+        buffer->thread_id = ThreadId();
+    }
+    owner.tracer_id = id_;
+    owner.buffer = buffer;
+    owner.pool = pool_;
+    return *buffer;
+}
+
+Tracer& Tracing() {
+    static Tracer tracer;
+    return tracer;
+}
+
+TraceContext CurrentTraceContext() { return current_context; }
+
+ScopedTraceContext::ScopedTraceContext(const TraceContext& context)
+    : previous_(std::exchange(current_context, context)) {}
+
+ScopedTraceContext::~ScopedTraceContext() { current_context = previous_; }
+
+Span::Span(const char* name, Tracer& tracer) : Span(name, tracer, false) {}
+
+Span::Span(const char* name, Tracer& tracer, bool is_root) : previous_(current_context) {
+    if (is_root) {
+        // A root always detaches from the thread's previous trace, sampled or not
+        is_restoring_ = true;
+        current_context = {};
+        if (!tracer.ShouldSample()) {
+            return;
+        }
+        record_.trace_id = NextId();
+    } else {
+        if (!previous_.IsSampled()) {
+            return;
+        }
+        record_.trace_id = previous_.trace_id;
+        record_.parent_id = previous_.span_id;
+    }
+
+    tracer_ = &tracer;
+    is_restoring_ = true;
+    record_.span_id = NextId();
+    record_.name = name;
+    record_.start_ns = UnixNanos();
+    record_.sequence = next_span_sequence.fetch_add(1, std::memory_order_relaxed);
+    current_context = {record_.trace_id, record_.span_id};
+    start_ = std::chrono::steady_clock::now();
+}
+
+Span::~Span() {
+    if (tracer_) {
+        record_.duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::steady_clock::now() - start_)
+                                  .count();
+        tracer_->Record(std::move(record_));
+    }
+    if (is_restoring_) {
+        current_context = previous_;
+    }
+}
+
+Span Span::Root(const char* name, Tracer& tracer) { return Span(name, tracer, true); }
+
+void Span::SetDetail(std::string detail) {
+    if (tracer_) {
+        record_.detail = std::move(detail);
+    }
+}
+
+void RecordFinishedSpan(const char* name, std::chrono::nanoseconds duration,
+                        std::string detail, Tracer& tracer) {
+    if (!current_context.IsSampled()) {
+        return;
+    }
+    SpanRecord record;
+    record.trace_id = current_context.trace_id;
+    record.span_id = NextId();
+    record.parent_id = current_context.span_id;
+    record.name = name;
+    record.detail = std::move(detail);
+    record.duration_ns = duration.count();
+    record.start_ns = UnixNanos() - record.duration_ns;
+    record.sequence = next_span_sequence.fetch_add(1, std::memory_order_relaxed);
+    tracer.Record(std::move(record));
+}
+
+}    // namespace bot
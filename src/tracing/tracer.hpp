@@ -0,0 +1,151 @@
+#pragma once
+
+#include "env/env_manager.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace bot {
+
+/// Identifies the span new child spans attach to. A thread carries one context at a
+/// time; an update is handled on one worker thread, so everything it calls (SQLite,
+/// Sheets requests) lands in its trace without passing the context around.
+struct TraceContext {
+    uint64_t trace_id = 0;
+    uint64_t span_id = 0;
+
+    bool IsSampled() const { return trace_id != 0; }
+};
+
+struct SpanRecord {
+    uint64_t trace_id = 0;
+    uint64_t span_id = 0;
+    uint64_t parent_id = 0;
+    const char* name = "";    ///< Static string, spans never own their name
+    std::string detail;
+    int64_t start_ns = 0;    ///< Unix time
+    int64_t duration_ns = 0;
+    uint64_t sequence = 0;    ///< Start order across threads, unlike start_ns never ties
+    uint32_t thread_id = 0;
+};
+
+struct TracerConfig {
+    double sample_rate = 0.01;    ///< Share of root spans recorded, 0 disables tracing
+    size_t buffer_spans = 4096;    ///< Ring size per thread, oldest spans are overwritten
+};
+
+TracerConfig MakeTracerConfig(IEnvManager& env);
+
+/// Collects finished spans into per-thread rings. Recording locks only the calling
+/// thread's ring, which the exporter touches on demand, so threads never contend.
+/// A thread returns its ring when it exits and the next new thread continues it, so
+/// short-lived threads keep spans exportable without growing memory: there are at
+/// most as many rings as threads that recorded at the same time.
+class Tracer final {
+private:
+    struct ThreadBuffer {
+        std::mutex mutex;
+        std::vector<SpanRecord> spans;
+        size_t capacity = 0;
+        size_t next = 0;    ///< Total spans recorded, the ring slot is next % capacity
+        uint32_t thread_id = 0;
+    };
+
+    /// Shared with the threads' buffer owners, which may outlive the tracer
+    struct BufferPool {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        std::vector<ThreadBuffer*> free;    ///< Rings of exited threads
+    };
+
+    std::atomic<uint64_t> sample_threshold_;    ///< Random ids below it are sampled
+    std::atomic<size_t> buffer_spans_;
+    uint64_t id_;    ///< Distinguishes tracers in thread-local buffer caches
+    std::shared_ptr<BufferPool> pool_;
+
+public:
+    explicit Tracer(const TracerConfig& config = {});
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    /// Applies to traces started afterwards; ring size only to threads not seen yet
+    void Configure(const TracerConfig& config);
+
+    /// Rolls the sampling dice for a new trace
+    bool ShouldSample() const;
+
+    void Record(SpanRecord span);
+
+    /// Spans of all threads in start order
+    std::vector<SpanRecord> Collect();
+
+    /// Trace Event Format, loadable by chrome://tracing and ui.perfetto.dev
+    std::string ExportChromeJson();
+
+    /// OTLP/JSON ExportTraceServiceRequest, as written by the OpenTelemetry file exporter
+    std::string ExportOtlpJson();
+
+private:
+    ThreadBuffer& LocalBuffer();
+};
+
+/// Process-wide tracer used by the instrumented components
+Tracer& Tracing();
+
+TraceContext CurrentTraceContext();
+
+/// Installs a context on the current thread for the lifetime of the scope. Used to
+/// carry a trace into helper threads.
+class ScopedTraceContext final {
+private:
+    TraceContext previous_;
+
+public:
+    explicit ScopedTraceContext(const TraceContext& context);
+    ~ScopedTraceContext();
+
+    ScopedTraceContext(const ScopedTraceContext&) = delete;
+    ScopedTraceContext& operator=(const ScopedTraceContext&) = delete;
+};
+
+/// Times a scope as a child of the current context. Outside a sampled trace it costs
+/// one thread-local read.
+class Span final {
+private:
+    Tracer* tracer_ = nullptr;    ///< Null when the span is not recorded
+    SpanRecord record_;
+    TraceContext previous_;
+    bool is_restoring_ = false;
+    std::chrono::steady_clock::time_point start_;
+
+public:
+    explicit Span(const char* name, Tracer& tracer = Tracing());
+    ~Span();
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    /// Starts a new trace, subject to sampling, e.g. one per Telegram update
+    static Span Root(const char* name, Tracer& tracer = Tracing());
+
+    bool IsRecording() const { return tracer_ != nullptr; }
+
+    /// Free-form annotation shown with the span, e.g. the SQL text
+    void SetDetail(std::string detail);
+
+private:
+    Span(const char* name, Tracer& tracer, bool is_root);
+};
+
+/// Records an already finished operation as a child of the current context, for
+/// callbacks that only learn about the work once it is done
+void RecordFinishedSpan(const char* name, std::chrono::nanoseconds duration,
+                        std::string detail = {}, Tracer& tracer = Tracing());
+
+}    // namespace bot
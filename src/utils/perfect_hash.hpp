@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace bot {
+
+/// FNV-1a over the key, started from a seed-dependent basis and finished with the
+/// splitmix64 avalanche so that low bits are usable for modulo
+constexpr uint64_t PerfectHash(std::string_view key, uint64_t seed) {
+    uint64_t hash = 14695981039346656037ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+    for (char c : key) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 30;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94D049BB133111EBULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+/// Read-only string map built by hash-and-displace, normally at compile time. Keys
+/// are first split into N buckets; every bucket gets its own seed that places its
+/// keys into free slots, so a lookup is two hashes and one key comparison.
+template <typename Value, size_t N> class PerfectHashMap final {
+public:
+    using Entry = std::pair<std::string_view, Value>;
+
+private:
+    static constexpr size_t kBuckets = N == 0 ? 1 : N;
+    static constexpr size_t kSlots = N == 0 ? 1 : 2 * N;
+    static constexpr uint64_t kMaxSeed = 1 << 20;
+
+    std::array<uint64_t, kBuckets> seeds_{};
+    std::array<Entry, kSlots> slots_{};
+    std::array<bool, kSlots> is_used_{};
+
+public:
+    constexpr explicit PerfectHashMap(const std::array<Entry, N>& entries) {
+        for (size_t i = 0; i < N; ++i) {
+            for (size_t j = i + 1; j < N; ++j) {
+                if (entries[i].first == entries[j].first) {
+                    throw std::logic_error("PerfectHashMap: duplicate key");
+                }
+            }
+        }
+
+        std::array<size_t, kBuckets> bucket_sizes{};
+        for (const auto& entry : entries) {
+            ++bucket_sizes[BucketOf(entry.first)];
+        }
+
+        // Largest buckets are placed first while most slots are still free
+        std::array<size_t, kBuckets> order{};
+        for (size_t i = 0; i < kBuckets; ++i) {
+            order[i] = i;
+        }
+        for (size_t i = 0; i < kBuckets; ++i) {
+            for (size_t j = i + 1; j < kBuckets; ++j) {
+                if (bucket_sizes[order[j]] > bucket_sizes[order[i]]) {
+                    std::swap(order[i], order[j]);
+                }
+            }
+        }
+
+        for (size_t bucket : order) {
+            if (bucket_sizes[bucket] != 0) {
+                PlaceBucket(entries, bucket);
+            }
+        }
+    }
+
+    constexpr const Value* Find(std::string_view key) const {
+        if constexpr (N == 0) {
+            return nullptr;
+        }
+        size_t slot = PerfectHash(key, seeds_[BucketOf(key)]) % kSlots;
+        if (!is_used_[slot] || slots_[slot].first != key) {
+            return nullptr;
+        }
+        return &slots_[slot].second;
+    }
+
+    constexpr bool Contains(std::string_view key) const { return Find(key) != nullptr; }
+
+    static constexpr size_t Size() { return N; }
+
+private:
+    static constexpr size_t BucketOf(std::string_view key) {
+        return PerfectHash(key, 0) % kBuckets;
+    }
+
+    constexpr void PlaceBucket(const std::array<Entry, N>& entries, size_t bucket) {
+        for (uint64_t seed = 1; seed < kMaxSeed; ++seed) {
+            std::array<size_t, N> taken{};
+            size_t taken_count = 0;
+            bool is_placed = true;
+
+            for (const auto& entry : entries) {
+                if (BucketOf(entry.first) != bucket) {
+                    continue;
+                }
+                size_t slot = PerfectHash(entry.first, seed) % kSlots;
+                bool is_collision = is_used_[slot];
+                for (size_t i = 0; i < taken_count && !is_collision; ++i) {
+                    is_collision = taken[i] == slot;
+                }
+                if (is_collision) {
+                    is_placed = false;
+                    break;
+                }
+                taken[taken_count++] = slot;
+            }
+
+            if (!is_placed) {
+                continue;
+            }
+
+            seeds_[bucket] = seed;
+            size_t next = 0;
+            for (const auto& entry : entries) {
+                if (BucketOf(entry.first) == bucket) {
+                    slots_[taken[next]] = entry;
+                    is_used_[taken[next]] = true;
+                    ++next;
+                }
+            }
+            return;
+        }
+        throw std::logic_error("PerfectHashMap: no seed found");
+    }
+};
+
+}    // namespace bot
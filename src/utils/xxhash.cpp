@@ -0,0 +1,92 @@
+#include "xxhash.hpp"
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace bot {
+
+namespace {
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+template <typename T> T ReadLittleEndian(const char* ptr) {
+    T value;
+    std::memcpy(&value, ptr, sizeof(T));
+    if constexpr (std::endian::native == std::endian::big) {
+        value = std::byteswap(value);
+    }
+    return value;
+}
+
+uint64_t Round(uint64_t acc, uint64_t input) {
+    acc += input * kPrime2;
+    acc = std::rotl(acc, 31);
+    return acc * kPrime1;
+}
+
+uint64_t MergeRound(uint64_t acc, uint64_t value) {
+    acc ^= Round(0, value);
+    return acc * kPrime1 + kPrime4;
+}
+
+}    // namespace
+
+uint64_t XxHash64(std::string_view data, uint64_t seed) {
+    const char* ptr = data.data();
+    const char* end = ptr + data.size();
+    uint64_t hash;
+
+    if (data.size() >= 32) {
+        uint64_t v1 = seed + kPrime1 + kPrime2;
+        uint64_t v2 = seed + kPrime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - kPrime1;
+
+        for (; end - ptr >= 32; ptr += 32) {
+            v1 = Round(v1, ReadLittleEndian<uint64_t>(ptr));
+            v2 = Round(v2, ReadLittleEndian<uint64_t>(ptr + 8));
+            v3 = Round(v3, ReadLittleEndian<uint64_t>(ptr + 16));
+            v4 = Round(v4, ReadLittleEndian<uint64_t>(ptr + 24));
+        }
+
+        hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) +
+               std::rotl(v4, 18);
+        hash = MergeRound(hash, v1);
+        hash = MergeRound(hash, v2);
+        hash = MergeRound(hash, v3);
+        hash = MergeRound(hash, v4);
+    } else {
+        hash = seed + kPrime5;
+    }
+
+    hash += data.size();
+
+    for (; end - ptr >= 8; ptr += 8) {
+        hash ^= Round(0, ReadLittleEndian<uint64_t>(ptr));
+        hash = std::rotl(hash, 27) * kPrime1 + kPrime4;
+    }
+    if (end - ptr >= 4) {
+        hash ^= static_cast<uint64_t>(ReadLittleEndian<uint32_t>(ptr)) * kPrime1;
+        hash = std::rotl(hash, 23) * kPrime2 + kPrime3;
+        ptr += 4;
+    }
+    for (; ptr < end; ++ptr) {
+        hash ^= static_cast<unsigned char>(*ptr) * kPrime5;
+        hash = std::rotl(hash, 11) * kPrime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+}    // namespace bot
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace bot {
+
+/// XXH64 by Yann Collet. Stable across compilers, standard libraries and builds, so
+/// it is safe to persist. Four independent lanes keep the main loop pipelined.
+uint64_t XxHash64(std::string_view data, uint64_t seed = 0);
+
+}    // namespace bot
@@ -0,0 +1,11 @@
+#include <gtest/gtest.h>
+
+#include "bootstrap/bootstrap.hpp"
+
+using namespace bot;
+
+TEST(BootstraperTest, AddStages_EveryDependencyIsDeclaredFirst) {
+    Bootstraper bootstrap;
+
+    EXPECT_NO_THROW(bootstrap.AddStages());
+}
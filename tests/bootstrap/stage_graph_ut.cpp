@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <latch>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bootstrap/stage_graph.hpp"
+
+using namespace bot;
+
+TEST(StageGraphTest, Run_RespectsDependencies) {
+    StageGraph graph;
+    std::mutex mutex;
+    std::vector<std::string> order;
+    auto record = [&](std::string name) {
+        return [&, name] {
+            std::lock_guard lock(mutex);
+            order.push_back(name);
+        };
+    };
+
+    graph.Add("env", {}, record("env"));
+    graph.Add("sql", {"env"}, record("sql"));
+    graph.Add("database", {"sql"}, record("database"));
+    graph.Add("bot", {"env"}, record("bot"));
+    graph.Run();
+
+    ASSERT_EQ(order.size(), 4);
+    auto position = [&](const std::string& name) {
+        return std::ranges::find(order, name) - order.begin();
+    };
+    EXPECT_EQ(position("env"), 0);
+    EXPECT_LT(position("sql"), position("database"));
+    EXPECT_EQ(graph.Timings().size(), 4);
+}
+
+TEST(StageGraphTest, Run_IndependentStages_Overlap) {
+    StageGraph graph;
+    std::latch both_started(2);
+
+    graph.Add("root", {}, [] {});
+    graph.Add("left", {"root"}, [&] { both_started.arrive_and_wait(); });
+    graph.Add("right", {"root"}, [&] { both_started.arrive_and_wait(); });
+
+    graph.Run();
+    EXPECT_EQ(graph.Timings().size(), 3);
+}
+
+TEST(StageGraphTest, Run_FailedStage_SkipsDependentsAndRethrows) {
+    StageGraph graph;
+    std::atomic<bool> is_dependent_run = false;
+
+    graph.Add("broken", {}, [] { throw std::runtime_error("no token"); });
+    graph.Add("dependent", {"broken"}, [&] { is_dependent_run = true; });
+
+    EXPECT_THROW(graph.Run(), std::runtime_error);
+    EXPECT_FALSE(is_dependent_run);
+    ASSERT_EQ(graph.Timings().size(), 1);
+    EXPECT_TRUE(graph.Timings().front().is_failed);
+    EXPECT_NE(graph.Report().find("FAILED"), std::string::npos);
+}
+
+TEST(StageGraphTest, Add_UnknownDependency_Throws) {
+    StageGraph graph;
+    EXPECT_THROW(graph.Add("database", {"sql"}, [] {}), std::invalid_argument);
+    graph.Add("sql", {}, [] {});
+    EXPECT_THROW(graph.Add("sql", {}, [] {}), std::invalid_argument);
+}
@@ -0,0 +1,241 @@
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <SQLiteCpp/Transaction.h>
+#include <chrono>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "broadcast/broadcaster.hpp"
+#include "db/migration_manager.hpp"
+#include "db/queries_manager.hpp"
+
+using namespace bot;
+using namespace std::chrono_literals;
+
+namespace {
+
+/// Accepts every message except the ones to blocked chats
+class RecordingTransport : public ISendTransport {
+private:
+    std::mutex mutex_;
+    std::vector<OutgoingMessage> sent_;
+    std::set<int64_t> blocked_;
+    std::chrono::milliseconds latency_;
+
+public:
+    explicit RecordingTransport(std::chrono::milliseconds latency = 0ms)
+        : latency_(latency) {}
+
+    void Block(int64_t chat_id) {
+        std::lock_guard lock(mutex_);
+        blocked_.insert(chat_id);
+    }
+
+    int32_t Send(const OutgoingMessage& message) override {
+        std::this_thread::sleep_for(latency_);
+        std::lock_guard lock(mutex_);
+        if (blocked_.contains(message.chat_id)) {
+            throw std::runtime_error("Forbidden: bot was blocked by the user");
+        }
+        sent_.push_back(message);
+        return static_cast<int32_t>(sent_.size());
+    }
+
+    std::vector<OutgoingMessage> Sent() {
+        std::lock_guard lock(mutex_);
+        return sent_;
+    }
+};
+
+}    // namespace
+
+class BroadcasterTest : public ::testing::Test {
+protected:
+    std::shared_ptr<ConnectionPool> pool_;
+    std::shared_ptr<RecordingTransport> transport_;
+    std::shared_ptr<SendScheduler> scheduler_;
+    BroadcastConfig config_;
+
+    void SetUp() override {
+        auto queries = std::make_shared<QueriesManager>(TEST_SQL_DIR);
+        PoolConfig pool_config;
+        pool_config.path = ":memory:";
+        pool_ = std::make_shared<ConnectionPool>(pool_config, queries);
+        {
+            ConnectionLease writer = pool_->AcquireWriter();
+            MigrationManager(writer.Database(), queries, writer.Statements(), Config{})
+                .Run();
+        }
+        config_.page_size = 4;
+        UseTransport(std::make_shared<RecordingTransport>());
+    }
+
+    void UseTransport(std::shared_ptr<RecordingTransport> transport) {
+        transport_ = std::move(transport);
+        scheduler_ = std::make_shared<SendScheduler>(
+            transport_, SendSchedulerConfig{.global_per_second = 10000,
+                                            .chat_per_second = 1000,
+                                            .senders = 2});
+        scheduler_->Start();
+    }
+
+    /// Users get ids 1..count and tg_id = 1000 + id; every third one is an admin
+    void AddUsers(int count) {
+        ConnectionLease writer = pool_->AcquireWriter();
+        SQLite::Transaction transaction(*writer);
+        SQLite::Statement insert(*writer,
+                                 "INSERT INTO user_(id, username, role, tg_id) "
+                                 "VALUES(?1, 'user' || ?1, ?2, 1000 + ?1)");
+        for (int id = 1; id <= count; ++id) {
+            insert.bind(1, id);
+            insert.bind(2, id % 3 == 0 ? "admin" : "user");
+            insert.exec();
+            insert.reset();
+        }
+        transaction.commit();
+    }
+
+    int64_t Query(const std::string& sql) {
+        return pool_->AcquireReader()->execAndGet(sql).getInt64();
+    }
+};
+
+TEST(RenderBroadcastTest, RoleText_OverridesDefaultAndFillsPlaceholder) {
+    BroadcastMessage message{"Hello, {role}", {{"admin", "{role}: check {role} panel"}}};
+
+    EXPECT_EQ(RenderBroadcast(message, "user"), "Hello, user");
+    EXPECT_EQ(RenderBroadcast(message, "admin"), "admin: check admin panel");
+}
+
+TEST_F(BroadcasterTest, Create_EveryUserWithTgId_ReceivesTextOfTheirRole) {
+    AddUsers(25);
+    pool_->AcquireWriter()->exec("INSERT INTO user_(username) VALUES('no_telegram')");
+
+    Broadcaster broadcaster(pool_, scheduler_, config_);
+    broadcaster.Start();
+    int64_t id = broadcaster.Create({"Schedule changed for {role}", {}});
+    broadcaster.WaitIdle();
+
+    std::map<int64_t, std::string> received;
+    for (const auto& message : transport_->Sent()) {
+        EXPECT_TRUE(received.emplace(message.chat_id, message.text).second);
+    }
+    ASSERT_EQ(received.size(), 25);
+    EXPECT_EQ(received[1003], "Schedule changed for admin");
+    EXPECT_EQ(received[1004], "Schedule changed for user");
+
+    BroadcastStats stats = broadcaster.Stats();
+    EXPECT_EQ(stats.broadcasts_done, 1);
+    EXPECT_EQ(stats.sent, 25);
+    EXPECT_EQ(stats.renders, 2);
+    EXPECT_EQ(Query("SELECT is_done FROM broadcast_ WHERE id = " + std::to_string(id)),
+              1);
+    EXPECT_EQ(Query("SELECT sent FROM broadcast_"), 25);
+    EXPECT_EQ(Query("SELECT last_user_id FROM broadcast_"), 25);
+}
+
+TEST_F(BroadcasterTest, Start_StoredCheckpoint_ResumesAfterIt) {
+    AddUsers(10);
+    Broadcaster broadcaster(pool_, scheduler_, config_);
+    broadcaster.Create({"Resumed", {}});
+    pool_->AcquireWriter()->exec("UPDATE broadcast_ SET last_user_id = 6");
+
+    broadcaster.Start();
+    broadcaster.WaitIdle();
+
+    std::set<int64_t> chats;
+    for (const auto& message : transport_->Sent()) {
+        chats.insert(message.chat_id);
+    }
+    EXPECT_EQ(chats, (std::set<int64_t>{1007, 1008, 1009, 1010}));
+    EXPECT_EQ(Query("SELECT is_done FROM broadcast_"), 1);
+}
+
+TEST_F(BroadcasterTest, Create_BlockedUsers_AreCountedAndSkipped) {
+    AddUsers(9);
+    transport_->Block(1002);
+    transport_->Block(1005);
+
+    Broadcaster broadcaster(pool_, scheduler_, config_);
+    broadcaster.Start();
+    broadcaster.Create({"Hi", {}});
+    broadcaster.WaitIdle();
+
+    EXPECT_EQ(transport_->Sent().size(), 7);
+    EXPECT_EQ(broadcaster.Stats().failed, 2);
+    EXPECT_EQ(Query("SELECT failed FROM broadcast_"), 2);
+    EXPECT_EQ(Query("SELECT is_done FROM broadcast_"), 1);
+}
+
+TEST_F(BroadcasterTest, Stop_MidBroadcast_NextRunDeliversTheRest) {
+    AddUsers(60);
+    UseTransport(std::make_shared<RecordingTransport>(2ms));
+
+    {
+        Broadcaster broadcaster(pool_, scheduler_, config_);
+        broadcaster.Start();
+        broadcaster.Create({"Hi", {}});
+        while (transport_->Sent().size() < 12) {
+            std::this_thread::sleep_for(1ms);
+        }
+        broadcaster.Stop();
+    }
+
+    int64_t checkpoint = Query("SELECT last_user_id FROM broadcast_");
+    EXPECT_EQ(Query("SELECT is_done FROM broadcast_"), 0);
+    EXPECT_GE(checkpoint, 8);
+    EXPECT_LT(checkpoint, 60);
+    scheduler_->Flush();
+
+    std::set<int64_t> delivered;
+    for (const auto& message : transport_->Sent()) {
+        delivered.insert(message.chat_id);
+    }
+    for (int64_t id = 1; id <= checkpoint; ++id) {
+        EXPECT_TRUE(delivered.contains(1000 + id)) << id;
+    }
+
+    Broadcaster resumed(pool_, scheduler_, config_);
+    resumed.Start();
+    resumed.WaitIdle();
+
+    delivered.clear();
+    for (const auto& message : transport_->Sent()) {
+        delivered.insert(message.chat_id);
+    }
+    EXPECT_EQ(delivered.size(), 60);
+    EXPECT_EQ(Query("SELECT is_done FROM broadcast_"), 1);
+}
+
+TEST_F(BroadcasterTest, SchedulerCancelsPage_BroadcastRetriedUntilDone) {
+    AddUsers(60);
+    UseTransport(std::make_shared<RecordingTransport>(2ms));
+    config_.retry_delay = 20ms;
+
+    Broadcaster broadcaster(pool_, scheduler_, config_);
+    broadcaster.Start();
+    broadcaster.Create({"Hi", {}});
+    while (transport_->Sent().size() < 8) {
+        std::this_thread::sleep_for(1ms);
+    }
+    // Queued sends of the pages in flight fail with SendCancelledError
+    scheduler_->Stop();
+    scheduler_->Start();
+    broadcaster.WaitIdle();
+
+    std::set<int64_t> delivered;
+    for (const auto& message : transport_->Sent()) {
+        delivered.insert(message.chat_id);
+    }
+    EXPECT_EQ(delivered.size(), 60);
+    EXPECT_EQ(broadcaster.Stats().broadcasts_done, 1);
+    EXPECT_EQ(Query("SELECT is_done FROM broadcast_"), 1);
+    EXPECT_EQ(Query("SELECT last_user_id FROM broadcast_"), 60);
+}
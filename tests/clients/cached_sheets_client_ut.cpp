@@ -0,0 +1,232 @@
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../db/mock_queries_manager.hpp"
+#include "clients/cached-sheets-client.hpp"
+
+using namespace bot;
+using namespace std::chrono_literals;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+namespace {
+
+class FakeSheetsClient final : public IGoogleSheetsClient {
+private:
+    mutable std::mutex mutex_;
+    mutable std::condition_variable unblocked_;
+    std::string body_ = "v1";
+    std::string etag_;
+    bool is_blocked_ = false;
+
+public:
+    mutable std::atomic<int> requests = 0;
+
+    /// Requests are read by refresh threads, so changes go through the lock
+    void SetBody(std::string body) {
+        std::lock_guard lock(mutex_);
+        body_ = std::move(body);
+    }
+
+    void SetEtag(std::string etag) {
+        std::lock_guard lock(mutex_);
+        etag_ = std::move(etag);
+    }
+
+    /// Holds requests until unblocked
+    void SetBlocked(bool is_blocked) {
+        {
+            std::lock_guard lock(mutex_);
+            is_blocked_ = is_blocked;
+        }
+        unblocked_.notify_all();
+    }
+
+    std::string Pull(const RequestParams&) const override {
+        ++requests;
+        return Wait().first;
+    }
+
+    std::vector<std::string>
+    PullBatch(const std::vector<RequestParams>& params) const override {
+        ++requests;
+        return std::vector<std::string>(params.size(), Wait().first);
+    }
+
+    void PullRows(const RequestParams&, size_t, const RowBatchSink&) const override {}
+
+    ConditionalPull PullIfChanged(const RequestParams&,
+                                  const std::string& known_etag) const override {
+        ++requests;
+        auto [body, etag] = Wait();
+        if (!etag.empty() && known_etag == etag) {
+            return {false, "", etag};
+        }
+        return {true, body, etag};
+    }
+
+private:
+    /// Body and etag once requests are not blocked
+    std::pair<std::string, std::string> Wait() const {
+        std::unique_lock lock(mutex_);
+        unblocked_.wait(lock, [this] { return !is_blocked_; });
+        return {body_, etag_};
+    }
+};
+
+}    // namespace
+
+class CachedSheetsClientTest : public ::testing::Test {
+protected:
+    std::shared_ptr<MockQueriesManager> queries_mock_;
+    std::shared_ptr<ConnectionPool> pool_;
+    std::shared_ptr<FakeSheetsClient> fake_;
+    SheetsCacheConfig config_;
+    RequestParams params_{"sheet", "list", "A", "C"};
+
+    void SetUp() override {
+        queries_mock_ = std::make_shared<NiceMock<MockQueriesManager>>();
+        ON_CALL(*queries_mock_, Get("dao/get_sheet_cache.sql"))
+            .WillByDefault(
+                Return("SELECT body, etag, fetched_at FROM sheet_cache_ WHERE key = ?;"));
+        ON_CALL(*queries_mock_, Get("dao/upsert_sheet_cache.sql"))
+            .WillByDefault(Return("INSERT INTO sheet_cache_(key, body, etag, fetched_at) "
+                                  "VALUES(?1, ?2, ?3, ?4) ON CONFLICT(key) DO UPDATE SET "
+                                  "body = ?2, etag = ?3, fetched_at = ?4;"));
+        ON_CALL(*queries_mock_, Get("dao/touch_sheet_cache.sql"))
+            .WillByDefault(
+                Return("UPDATE sheet_cache_ SET fetched_at = ?2 WHERE key = ?1;"));
+
+        PoolConfig pool_config;
+        pool_config.path = ":memory:";
+        pool_ = std::make_shared<ConnectionPool>(pool_config, queries_mock_);
+        pool_->AcquireWriter()->exec(
+            "CREATE TABLE sheet_cache_ (key TEXT PRIMARY KEY, body TEXT NOT NULL, "
+            "etag TEXT, fetched_at INTEGER NOT NULL);");
+
+        fake_ = std::make_shared<FakeSheetsClient>();
+    }
+};
+
+TEST_F(CachedSheetsClientTest, Pull_FreshEntry_ServedWithoutRequest) {
+    CachedSheetsClient cache(fake_, pool_, config_);
+
+    EXPECT_EQ(cache.Pull(params_), "v1");
+    fake_->SetBody("v2");
+    EXPECT_EQ(cache.Pull(params_), "v1");
+
+    EXPECT_EQ(fake_->requests, 1);
+    SheetsCacheStats stats = cache.Stats(params_);
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.hits, 1);
+}
+
+TEST_F(CachedSheetsClientTest, Pull_StaleEntry_ServedAndRefreshedInBackground) {
+    config_.ttl = 0s;
+    CachedSheetsClient cache(fake_, pool_, config_);
+
+    EXPECT_EQ(cache.Pull(params_), "v1");
+    fake_->SetBody("v2");
+    EXPECT_EQ(cache.Pull(params_), "v1");
+
+    for (int i = 0; i < 200 && cache.Stats(params_).refreshes < 2; ++i) {
+        std::this_thread::sleep_for(5ms);
+    }
+    EXPECT_EQ(cache.Stats(params_).stale_hits, 1);
+    EXPECT_EQ(cache.Stats(params_).refreshes, 2);
+    EXPECT_EQ(cache.Pull(params_), "v2");
+}
+
+TEST_F(CachedSheetsClientTest, Pull_ExpiredWithSameEtag_OnlyTouchesTimestamp) {
+    config_.ttl = 0s;
+    config_.stale_ttl = 0s;
+    fake_->SetEtag("\"rev-1\"");
+    CachedSheetsClient cache(fake_, pool_, config_);
+
+    EXPECT_EQ(cache.Pull(params_), "v1");
+    EXPECT_EQ(cache.Pull(params_), "v1");
+
+    EXPECT_EQ(fake_->requests, 2);
+    EXPECT_EQ(cache.Stats(params_).unchanged_refreshes, 1);
+    EXPECT_EQ(pool_->AcquireReader()
+                  ->execAndGet("SELECT body FROM sheet_cache_;")
+                  .getString(),
+              "v1");
+}
+
+TEST_F(CachedSheetsClientTest, Pull_AfterRestart_LoadsFromTable) {
+    {
+        CachedSheetsClient cache(fake_, pool_, config_);
+        cache.Pull(params_);
+    }
+    fake_->SetBody("v2");
+    CachedSheetsClient restarted(fake_, pool_, config_);
+
+    EXPECT_EQ(restarted.Pull(params_), "v1");
+    EXPECT_EQ(fake_->requests, 1);
+}
+
+TEST_F(CachedSheetsClientTest, PullBatch_OnlyMissingRangesRequested) {
+    CachedSheetsClient cache(fake_, pool_, config_);
+    RequestParams other{"sheet", "list", "D", "F"};
+    cache.Pull(params_);
+
+    std::vector<std::string> bodies = cache.PullBatch({params_, other});
+
+    EXPECT_EQ(bodies, (std::vector<std::string>{"v1", "v1"}));
+    EXPECT_EQ(fake_->requests, 2);
+    EXPECT_EQ(cache.TotalStats().hits, 1);
+}
+
+TEST_F(CachedSheetsClientTest, Pull_ConcurrentMisses_ShareOneRequest) {
+    CachedSheetsClient cache(fake_, pool_, config_);
+    fake_->SetBlocked(true);
+    std::vector<std::string> bodies(4);
+    {
+        std::vector<std::jthread> callers;
+        for (auto& body : bodies) {
+            callers.emplace_back([&cache, &body, this] { body = cache.Pull(params_); });
+        }
+        for (int i = 0; i < 400 && cache.TotalStats().coalesced_misses < 3; ++i) {
+            std::this_thread::sleep_for(5ms);
+        }
+        fake_->SetBlocked(false);
+    }
+
+    EXPECT_EQ(bodies, std::vector<std::string>(4, "v1"));
+    EXPECT_EQ(fake_->requests, 1);
+    EXPECT_EQ(cache.TotalStats().coalesced_misses, 3);
+}
+
+TEST_F(CachedSheetsClientTest, PullBatch_RangeBeingFetched_JoinsThatFetch) {
+    CachedSheetsClient cache(fake_, pool_, config_);
+    RequestParams other{"sheet", "list", "D", "F"};
+    fake_->SetBlocked(true);
+    std::string single;
+    std::vector<std::string> batch;
+    {
+        std::jthread puller([&] { single = cache.Pull(params_); });
+        while (fake_->requests < 1) {
+            std::this_thread::sleep_for(1ms);
+        }
+        std::jthread batcher([&] { batch = cache.PullBatch({params_, other}); });
+        for (int i = 0; i < 400 && cache.TotalStats().coalesced_misses < 1; ++i) {
+            std::this_thread::sleep_for(5ms);
+        }
+        fake_->SetBlocked(false);
+    }
+
+    EXPECT_EQ(single, "v1");
+    EXPECT_EQ(batch, (std::vector<std::string>{"v1", "v1"}));
+    EXPECT_EQ(fake_->requests, 2);
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <mutex>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace bot {
+
+struct FakeResponse {
+    int status = 200;
+    std::string body;
+    std::string headers;    ///< Extra "Name: value\r\n" lines
+};
+
+/// Loopback HTTP/1.1 stand-in for API clients. Connections are kept alive and served on
+/// their own threads, so tests can count how many the client opened.
+class FakeHttpServer final {
+public:
+    /// Called with the request target, e.g. "/v4/spreadsheets/id/values/A!B:C?key=k"
+    using Handler = std::function<FakeResponse(const std::string& target)>;
+
+private:
+    static constexpr int kPollTimeoutMs = 20;
+
+    std::mutex mutex_;
+    Handler handler_;
+    std::vector<std::string> targets_;
+    int connections_ = 0;
+    std::vector<std::jthread> workers_;
+
+    int listen_fd_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> is_stopping_ = false;
+    std::jthread acceptor_;
+
+public:
+    explicit FakeHttpServer(Handler handler) : handler_(std::move(handler)) {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(addr);
+        if (listen_fd_ < 0 ||
+            bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            listen(listen_fd_, 16) != 0 ||
+            getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &length) != 0) {
+            throw std::runtime_error("Failed to start fake HTTP server");
+        }
+        port_ = ntohs(addr.sin_port);
+        acceptor_ = std::jthread([this] { AcceptLoop(); });
+    }
+
+    ~FakeHttpServer() {
+        is_stopping_ = true;
+        acceptor_.join();
+        std::vector<std::jthread> workers;
+        {
+            std::lock_guard lock(mutex_);
+            workers = std::move(workers_);
+        }
+        workers.clear();
+        close(listen_fd_);
+    }
+
+    FakeHttpServer(const FakeHttpServer&) = delete;
+    FakeHttpServer& operator=(const FakeHttpServer&) = delete;
+
+    std::string Url() const { return std::format("http://127.0.0.1:{}", port_); }
+
+    void SetHandler(Handler handler) {
+        std::lock_guard lock(mutex_);
+        handler_ = std::move(handler);
+    }
+
+    std::vector<std::string> Targets() {
+        std::lock_guard lock(mutex_);
+        return targets_;
+    }
+
+    int Connections() {
+        std::lock_guard lock(mutex_);
+        return connections_;
+    }
+
+private:
+    void AcceptLoop() {
+        while (!is_stopping_) {
+            pollfd poll_fd{listen_fd_, POLLIN, 0};
+            if (poll(&poll_fd, 1, kPollTimeoutMs) <= 0) {
+                continue;
+            }
+            int client_fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client_fd < 0) {
+                continue;
+            }
+            std::lock_guard lock(mutex_);
+            ++connections_;
+            workers_.emplace_back([this, client_fd] { Serve(client_fd); });
+        }
+    }
+
+    void Serve(int client_fd) {
+        std::string buffer;
+        while (!is_stopping_) {
+            size_t head_end = buffer.find("\r\n\r\n");
+            if (head_end == std::string::npos) {
+                if (!Read(client_fd, buffer)) {
+                    break;
+                }
+                continue;
+            }
+
+            std::string_view request_line(buffer.data(), buffer.find("\r\n"));
+            request_line.remove_prefix(request_line.find(' ') + 1);
+            std::string target(request_line.substr(0, request_line.find(' ')));
+            buffer.erase(0, head_end + 4);
+
+            Handler handler;
+            {
+                std::lock_guard lock(mutex_);
+                targets_.push_back(target);
+                handler = handler_;
+            }
+            FakeResponse response = handler(target);
+            std::string raw =
+                std::format("HTTP/1.1 {} Fake\r\nContent-Length: {}\r\n{}\r\n{}",
+                            response.status, response.body.size(), response.headers,
+                            response.body);
+            if (send(client_fd, raw.data(), raw.size(), MSG_NOSIGNAL) !=
+                static_cast<ssize_t>(raw.size())) {
+                break;
+            }
+        }
+        close(client_fd);
+    }
+
+    /// False once the peer closed or the server stops
+    bool Read(int client_fd, std::string& buffer) {
+        pollfd poll_fd{client_fd, POLLIN, 0};
+        int ready = poll(&poll_fd, 1, kPollTimeoutMs);
+        if (ready == 0) {
+            return !is_stopping_;
+        }
+        char chunk[4096];
+        ssize_t length = ready > 0 ? read(client_fd, chunk, sizeof(chunk)) : -1;
+        if (length <= 0) {
+            return false;
+        }
+        buffer.append(chunk, static_cast<size_t>(length));
+        return true;
+    }
+};
+
+}    // namespace bot
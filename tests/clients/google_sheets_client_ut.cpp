@@ -0,0 +1,237 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <spdlog/sinks/ostream_sink.h>
+#include <spdlog/spdlog.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "clients/google-sheets-client.hpp"
+#include "fake_http_server.hpp"
+#include "logging/log_limiter.hpp"
+#include "metrics/metrics.hpp"
+
+using namespace bot;
+
+namespace {
+
+FakeResponse Echo(const std::string& target) {
+    return {200, R"({"range":")" + target.substr(0, target.find('?')) + R"("})"};
+}
+
+/// Answers batchGet with one value range per requested range, named after it
+FakeResponse BatchEcho(const std::string& target) {
+    if (target.find("values:batchGet") == std::string::npos) {
+        return Echo(target);
+    }
+    nlohmann::json value_ranges = nlohmann::json::array();
+    for (size_t pos = target.find("ranges="); pos != std::string::npos;
+         pos = target.find("ranges=", pos + 1)) {
+        size_t begin = pos + 7;
+        std::string range = target.substr(begin, target.find('&', begin) - begin);
+        value_ranges.push_back({{"range", range}});
+    }
+    return {200, nlohmann::json{{"valueRanges", value_ranges}}.dump()};
+}
+
+std::string RangeOf(const std::string& body) {
+    return nlohmann::json::parse(body).at("range");
+}
+
+}    // namespace
+
+class GoogleSheetsClientTest : public ::testing::Test {
+protected:
+    FakeHttpServer server_{Echo};
+    RequestParams params_{"sheet", "list", "A", "C"};
+
+    GoogleSheetsClient MakeClient(size_t concurrency = kDefaultBatchConcurrency) {
+        return GoogleSheetsClient("key", server_.Url(), concurrency);
+    }
+};
+
+TEST_F(GoogleSheetsClientTest, Pull_SequentialRequests_ReuseOneConnection) {
+    GoogleSheetsClient client = MakeClient();
+
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(client.Pull(params_),
+                  R"({"range":"/v4/spreadsheets/sheet/values/list%21A%3AC"})");
+    }
+    EXPECT_EQ(server_.Connections(), 1);
+    EXPECT_EQ(server_.Targets().size(), 3U);
+}
+
+TEST_F(GoogleSheetsClientTest, Pull_ConcurrentCallers_AllServedByTheTransferThread) {
+    GoogleSheetsClient client = MakeClient();
+    std::atomic<int> succeeded = 0;
+    {
+        std::vector<std::jthread> callers;
+        for (int i = 0; i < 8; ++i) {
+            callers.emplace_back([&] {
+                if (!client.Pull(params_).empty()) {
+                    ++succeeded;
+                }
+            });
+        }
+    }
+
+    EXPECT_EQ(succeeded, 8);
+    EXPECT_LE(server_.Connections(), 8);
+}
+
+TEST_F(GoogleSheetsClientTest, PullIfChanged_SameEtag_NotModified) {
+    server_.SetHandler([](const std::string&) {
+        return FakeResponse{304, "", "ETag: \"rev-1\"\r\n"};
+    });
+    GoogleSheetsClient client = MakeClient();
+
+    ConditionalPull result = client.PullIfChanged(params_, "\"rev-1\"");
+
+    EXPECT_FALSE(result.is_modified);
+    EXPECT_EQ(result.etag, "\"rev-1\"");
+}
+
+TEST_F(GoogleSheetsClientTest, Pull_ThrowingSink_TransferAbortedAndRethrown) {
+    server_.SetHandler([](const std::string&) {
+        return FakeResponse{200, R"({"values":[["a"],["b"]]})"};
+    });
+    GoogleSheetsClient client = MakeClient();
+
+    EXPECT_THROW(client.PullRows(params_, 1,
+                                 [](std::vector<SheetRow>&&) {
+                                     throw std::runtime_error("sink failed");
+                                 }),
+                 std::runtime_error);
+    EXPECT_EQ(client.Pull(params_), R"({"values":[["a"],["b"]]})");
+}
+
+TEST_F(GoogleSheetsClientTest, PullRows_SlowSink_BufferStaysBounded) {
+    constexpr size_t kRows = 256 * 1024;
+    std::string body = R"({"range":"list!A1:B","majorDimension":"ROWS","values":[)";
+    for (size_t i = 0; i < kRows; ++i) {
+        body += i ? R"(,["name","value"])" : R"(["name","value"])";
+    }
+    body += "]}";
+    server_.SetHandler([&body](const std::string&) { return FakeResponse{200, body}; });
+    GoogleSheetsClient client = MakeClient();
+    Counter& pauses =
+        Metrics().GetCounter("sheets_transfer_pauses_total",
+                             "Transfers paused because the sink lagged");
+    uint64_t pauses_before = pauses.Value();
+
+    size_t rows = 0;
+    client.PullRows(params_, 1000, [&rows](std::vector<SheetRow>&& batch) {
+        rows += batch.size();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    });
+
+    EXPECT_EQ(rows, kRows);
+    EXPECT_GT(pauses.Value(), pauses_before);
+    Histogram::Snapshot buffered =
+        Metrics()
+            .GetHistogram("sheets_buffered_bytes",
+                          "Response bytes buffered for the sink at a time", {}, 1)
+            .Collect();
+    size_t largest = Histogram::kBuckets - 1;
+    while (largest > 0 && buffered.buckets[largest] == 0) {
+        --largest;
+    }
+    EXPECT_LE(Histogram::BucketLowerBound(largest),
+              GoogleSheetsClient::kMaxPendingBytes + CURL_MAX_WRITE_SIZE);
+}
+
+TEST_F(GoogleSheetsClientTest, PullBatch_GroupsBySpreadsheet_KeepsRequestOrder) {
+    server_.SetHandler(BatchEcho);
+    GoogleSheetsClient client = MakeClient();
+
+    std::vector<std::string> bodies = client.PullBatch({{"s1", "list", "A", "B"},
+                                                        {"s2", "my list", "C", "D"},
+                                                        {"s1", "list", "E", "F"}});
+
+    ASSERT_EQ(bodies.size(), 3U);
+    EXPECT_EQ(RangeOf(bodies[0]), "list%21A%3AB");
+    EXPECT_EQ(RangeOf(bodies[1]), "/v4/spreadsheets/s2/values/my%20list%21C%3AD");
+    EXPECT_EQ(RangeOf(bodies[2]), "list%21E%3AF");
+    EXPECT_EQ(server_.Targets().size(), 2U);
+}
+
+TEST_F(GoogleSheetsClientTest, PullBatch_ManySpreadsheets_LimitedConcurrency) {
+    server_.SetHandler(BatchEcho);
+    GoogleSheetsClient client = MakeClient(2);
+    std::vector<RequestParams> params;
+    for (int i = 0; i < 7; ++i) {
+        params.push_back({"s" + std::to_string(i), "list", "A", "B"});
+    }
+
+    std::vector<std::string> bodies = client.PullBatch(params);
+
+    ASSERT_EQ(bodies.size(), 7U);
+    for (int i = 0; i < 7; ++i) {
+        EXPECT_EQ(RangeOf(bodies[i]),
+                  "/v4/spreadsheets/s" + std::to_string(i) + "/values/list%21A%3AB");
+    }
+    EXPECT_LE(server_.Connections(), 2);
+}
+
+TEST_F(GoogleSheetsClientTest, PullBatch_OneSpreadsheetFails_Throws) {
+    server_.SetHandler([](const std::string& target) {
+        return target.find("/s2/") == std::string::npos ? BatchEcho(target)
+                                                        : FakeResponse{500, "{}"};
+    });
+    GoogleSheetsClient client = MakeClient();
+
+    EXPECT_THROW(client.PullBatch({{"s1", "list", "A", "B"},
+                                   {"s2", "list", "A", "B"},
+                                   {"s3", "list", "A", "B"}}),
+                 std::runtime_error);
+    EXPECT_EQ(client.Pull({"s1", "list", "A", "B"}).empty(), false);
+}
+
+TEST_F(GoogleSheetsClientTest, PullBatch_WrongAmountOfRanges_Throws) {
+    server_.SetHandler([](const std::string&) {
+        return FakeResponse{200, R"({"valueRanges":[{}]})"};
+    });
+    GoogleSheetsClient client = MakeClient();
+
+    EXPECT_THROW(client.PullBatch({{"s1", "list", "A", "B"}, {"s1", "list", "C", "D"}}),
+                 std::runtime_error);
+}
+
+TEST_F(GoogleSheetsClientTest, Pull_ErrorResponse_CountedByItsCode) {
+    server_.SetHandler([](const std::string&) { return FakeResponse{403, "{}"}; });
+    GoogleSheetsClient client = MakeClient();
+    Counter& forbidden = Metrics().GetCounter("sheets_responses_total",
+                                              "Google Sheets API responses by HTTP code",
+                                              {{"code", "403"}});
+    uint64_t before = forbidden.Value();
+
+    EXPECT_THROW(client.Pull(params_), std::runtime_error);
+    EXPECT_EQ(forbidden.Value(), before + 1);
+}
+
+TEST_F(GoogleSheetsClientTest, Pull_TraceLog_MasksTheApiKey) {
+    if (!IsLogLevelActive(spdlog::level::trace)) {
+        GTEST_SKIP() << "trace logging is compiled out";
+    }
+    std::ostringstream log;
+    auto logger = std::make_shared<spdlog::logger>(
+        "sheets_test", std::make_shared<spdlog::sinks::ostream_sink_mt>(log));
+    logger->set_pattern("%v");
+    logger->set_level(spdlog::level::trace);
+    std::shared_ptr<spdlog::logger> previous = spdlog::default_logger();
+    spdlog::set_default_logger(logger);
+    GoogleSheetsClient client("secret", server_.Url());
+
+    client.Pull(params_);
+    spdlog::set_default_logger(previous);
+
+    EXPECT_NE(log.str().find("values/list%21A%3AC?key=******\n"), std::string::npos)
+        << log.str();
+    EXPECT_EQ(log.str().find("secret"), std::string::npos);
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "clients/sheet-rows-parser.hpp"
+
+using namespace bot;
+
+namespace {
+
+const std::string kBody = R"({
+  "range": "List!A1:C4",
+  "majorDimension": "ROWS",
+  "values": [
+    ["name", "role", "note"],
+    ["alice", "admin", "likes [brackets] and \"quotes\""],
+    ["bob", 42, true],
+    [],
+    ["carol", "user", "values: [\"x\"]"]
+  ]
+})";
+
+std::vector<std::vector<SheetRow>> Parse(const std::string& body, size_t batch_size,
+                                         size_t chunk_size) {
+    std::vector<std::vector<SheetRow>> batches;
+    SheetRowsParser parser(batch_size, [&](std::vector<SheetRow>&& rows) {
+        batches.push_back(rows);
+    });
+
+    for (size_t pos = 0; pos < body.size(); pos += chunk_size) {
+        parser.Feed(std::string_view(body).substr(pos, chunk_size));
+    }
+    parser.Finish();
+    return batches;
+}
+
+}    // namespace
+
+TEST(SheetRowsParserTest, Feed_WholeBody_EmitsRowsInBatches) {
+    auto batches = Parse(kBody, 2, kBody.size());
+
+    ASSERT_EQ(batches.size(), 3);
+    EXPECT_EQ(batches[0][0], (SheetRow{"name", "role", "note"}));
+    EXPECT_EQ(batches[0][1][2], "likes [brackets] and \"quotes\"");
+    EXPECT_EQ(batches[1][0], (SheetRow{"bob", "42", "true"}));
+    EXPECT_TRUE(batches[1][1].empty());
+    EXPECT_EQ(batches[2], (std::vector<SheetRow>{{"carol", "user", "values: [\"x\"]"}}));
+}
+
+TEST(SheetRowsParserTest, Feed_SingleByteChunks_MatchesWholeBody) {
+    EXPECT_EQ(Parse(kBody, 2, 1), Parse(kBody, 2, kBody.size()));
+    EXPECT_EQ(Parse(kBody, 3, 7), Parse(kBody, 3, kBody.size()));
+}
+
+TEST(SheetRowsParserTest, Feed_NoValues_EmitsNothing) {
+    EXPECT_TRUE(Parse(R"({"range": "List!A1:B2", "majorDimension": "ROWS"})", 4, 5)
+                    .empty());
+}
+
+TEST(SheetRowsParserTest, Finish_TruncatedBody_Throws) {
+    SheetRowsParser parser(4, [](std::vector<SheetRow>&&) {});
+
+    parser.Feed(kBody.substr(0, kBody.find("[\"bob\"")));
+
+    EXPECT_THROW(parser.Finish(), std::runtime_error);
+    EXPECT_EQ(parser.RowsParsed(), 2);
+}
@@ -0,0 +1,71 @@
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+#include "commands/basic_commands.hpp"
+#include "db/migration_manager.hpp"
+#include "db/queries_manager.hpp"
+#include "db/user_cache.hpp"
+
+using namespace bot;
+
+class StartCommandTest : public ::testing::Test {
+protected:
+    DiContainer di_;
+    std::shared_ptr<ConnectionPool> pool_;
+
+    void SetUp() override {
+        auto queries = std::make_shared<QueriesManager>(TEST_SQL_DIR);
+        PoolConfig pool_config;
+        pool_config.path = ":memory:";
+        pool_ = std::make_shared<ConnectionPool>(pool_config, queries);
+        {
+            ConnectionLease writer = pool_->AcquireWriter();
+            MigrationManager(writer.Database(), queries, writer.Statements(), Config{})
+                .Run();
+        }
+        REGISTER(di_, UserCache, pool_);
+        REGISTER(di_, UserWriteBehind, pool_, WriteBehindConfig{},
+                 [cache = GET(di_, UserCache)](const UserRecord& record) {
+                     cache->Invalidate(record);
+                 });
+    }
+
+    TgBot::Message MakeMessage(std::string text, int64_t chat_id, int64_t user_id) {
+        TgBot::Message message;
+        message.text = std::move(text);
+        message.chat = std::make_shared<TgBot::Chat>();
+        message.chat->id = chat_id;
+        message.from = std::make_shared<TgBot::User>();
+        message.from->id = user_id;
+        message.from->username = "alice";
+        return message;
+    }
+
+    int64_t StoredTgId() {
+        GET(di_, UserWriteBehind)->Flush();
+        ConnectionLease reader = pool_->AcquireReader();
+        return reader->execAndGet("SELECT tg_id FROM user_ WHERE username = 'alice'")
+            .getInt64();
+    }
+};
+
+TEST_F(StartCommandTest, Route_DeepLinkInGroup_StoresSenderId) {
+    CommandRouter<StartCommand> router(di_);
+
+    EXPECT_EQ(router.Route(MakeMessage("/start ref_42", -100, 7)), RouteResult::kHandled);
+    EXPECT_EQ(StoredTgId(), 7);
+}
+
+TEST_F(StartCommandTest, Route_KnownSender_NotWrittenAgain) {
+    CommandRouter<StartCommand> router(di_, "", GET(di_, UserCache));
+
+    router.Route(MakeMessage("/start", 7, 7));
+    EXPECT_EQ(StoredTgId(), 7);
+    router.Route(MakeMessage("/start", 7, 7));
+    GET(di_, UserWriteBehind)->Flush();
+
+    EXPECT_EQ(GET(di_, UserWriteBehind)->Stats().rows_written, 1);
+}
@@ -0,0 +1,131 @@
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "commands/command_router.hpp"
+
+using namespace bot;
+
+namespace {
+
+static_assert(ParseCommand("/start@my_bot now", "my_bot")->name == "/start");
+static_assert(ParseCommand("/start@my_bot now")->args == " now");
+static_assert(!ParseCommand("/start@other_bot", "my_bot"));
+static_assert(!ParseCommand("hello /start"));
+static_assert(!ParseCommand("/"));
+
+/// Calls seen by the commands, shared with them through the container
+struct CallLog {
+    std::vector<std::string> calls;
+    int constructed = 0;
+};
+
+struct PingCommand {
+    static constexpr std::string_view kName = "/ping";
+    Scoped<CallLog> log;
+
+    explicit PingCommand(DiContainer& di) : log(Scope<CallLog>(di)) {
+        ++log->constructed;
+    }
+
+    void Handle(const CommandContext& context) { log->calls.emplace_back(context.name); }
+};
+
+struct RoleCommand {
+    static constexpr std::string_view kName = "/role";
+    Scoped<CallLog> log;
+
+    explicit RoleCommand(DiContainer& di) : log(Scope<CallLog>(di)) {}
+
+    void Handle(const CommandContext&, int64_t user_id, std::string_view role,
+                std::optional<int> days) {
+        log->calls.push_back(std::to_string(user_id) + ":" + std::string(role) + ":" +
+                             (days ? std::to_string(*days) : "-"));
+    }
+};
+
+struct NoteCommand {
+    static constexpr std::string_view kName = "/note";
+    Scoped<CallLog> log;
+
+    explicit NoteCommand(DiContainer& di) : log(Scope<CallLog>(di)) {}
+
+    void Handle(const CommandContext&, double weight, RestOfLine text) {
+        log->calls.push_back(std::to_string(weight) + ":" + std::string(text.text));
+    }
+};
+
+using TestRouter = CommandRouter<PingCommand, RoleCommand, NoteCommand>;
+
+static_assert(TestRouter::Contains("/role"));
+static_assert(!TestRouter::Contains("/rol"));
+
+TgBot::Message MakeMessage(std::string text) {
+    TgBot::Message message;
+    message.text = std::move(text);
+    return message;
+}
+
+}    // namespace
+
+class CommandRouterTest : public ::testing::Test {
+protected:
+    DiContainer di_;
+    std::shared_ptr<CallLog> log_;
+    std::unique_ptr<TestRouter> router_;
+
+    void SetUp() override {
+        REGISTER(di_, CallLog);
+        log_ = GET(di_, CallLog);
+        router_ = std::make_unique<TestRouter>(di_, "my_bot");
+    }
+
+    RouteResult Route(std::string text) { return router_->Route(MakeMessage(text)); }
+};
+
+TEST(ArgTokenizerTest, Next_SplitsOnWhitespace_RestKeepsInnerSpaces) {
+    ArgTokenizer tokens("  42\tadmin   some free  text ");
+
+    EXPECT_EQ(tokens.Next(), "42");
+    EXPECT_EQ(tokens.Next(), "admin");
+    EXPECT_EQ(tokens.Rest(), "some free  text ");
+    EXPECT_TRUE(tokens.IsEmpty());
+    EXPECT_EQ(tokens.Next(), std::nullopt);
+}
+
+TEST_F(CommandRouterTest, Construct_EveryCommandResolvesDependenciesOnce) {
+    Route("/ping");
+    Route("/ping");
+
+    EXPECT_EQ(log_->constructed, 1);
+    EXPECT_EQ(log_->calls, (std::vector<std::string>{"/ping", "/ping"}));
+}
+
+TEST_F(CommandRouterTest, Route_TypedArguments_ParsedIntoHandler) {
+    EXPECT_EQ(Route("/role 42 admin 7"), RouteResult::kHandled);
+    EXPECT_EQ(Route("/role@my_bot -5 user"), RouteResult::kHandled);
+    EXPECT_EQ(Route("/note 1.5  buy   milk"), RouteResult::kHandled);
+
+    EXPECT_EQ(log_->calls, (std::vector<std::string>{"42:admin:7", "-5:user:-",
+                                                     "1.500000:buy   milk"}));
+}
+
+TEST_F(CommandRouterTest, Route_BadArguments_HandlerNotCalled) {
+    EXPECT_EQ(Route("/role abc admin"), RouteResult::kBadArguments);
+    EXPECT_EQ(Route("/role 42"), RouteResult::kBadArguments);
+    EXPECT_EQ(Route("/role 42 admin 7 extra"), RouteResult::kBadArguments);
+    EXPECT_EQ(Route("/role 42x admin"), RouteResult::kBadArguments);
+    EXPECT_EQ(Route("/ping now"), RouteResult::kBadArguments);
+    EXPECT_TRUE(log_->calls.empty());
+}
+
+TEST_F(CommandRouterTest, Route_NotOurCommand_Reported) {
+    EXPECT_EQ(Route("hello"), RouteResult::kNotCommand);
+    EXPECT_EQ(Route("/ping@other_bot"), RouteResult::kNotCommand);
+    EXPECT_EQ(Route("/pong"), RouteResult::kUnknownCommand);
+    EXPECT_TRUE(log_->calls.empty());
+}
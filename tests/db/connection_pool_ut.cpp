@@ -0,0 +1,123 @@
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "db/connection_pool.hpp"
+#include "mock_queries_manager.hpp"
+
+using namespace bot;
+using namespace std::chrono_literals;
+using ::testing::NiceMock;
+
+class ConnectionPoolTest : public ::testing::Test {
+protected:
+    std::filesystem::path db_path_;
+    std::shared_ptr<MockQueriesManager> queries_mock_;
+    PoolConfig config_;
+
+    void SetUp() override {
+        db_path_ = std::filesystem::temp_directory_path() / "connection_pool_ut.db";
+        RemoveDatabase();
+        SQLite::Database(db_path_.string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE)
+            .exec("CREATE TABLE user_ (id INTEGER PRIMARY KEY, username TEXT);");
+
+        queries_mock_ = std::make_shared<NiceMock<MockQueriesManager>>();
+        config_.path = db_path_.string();
+        config_.readers = 2;
+        config_.busy_timeout_ms = 100;
+    }
+
+    void TearDown() override { RemoveDatabase(); }
+
+    void RemoveDatabase() {
+        for (const char* suffix : {"", "-wal", "-shm"}) {
+            std::filesystem::remove(db_path_.string() + suffix);
+        }
+    }
+};
+
+TEST_F(ConnectionPoolTest, Constructor_SwitchesDatabaseToWal) {
+    ConnectionPool pool(config_, queries_mock_);
+
+    auto reader = pool.AcquireReader();
+    EXPECT_EQ(reader->execAndGet("PRAGMA journal_mode;").getString(), "wal");
+    EXPECT_FALSE(reader.IsWriter());
+}
+
+TEST_F(ConnectionPoolTest, AcquireReader_DuringWriteTransaction_ReadsLastCommit) {
+    ConnectionPool pool(config_, queries_mock_);
+    {
+        auto writer = pool.AcquireWriter();
+        writer->exec("INSERT INTO user_ (username) VALUES ('alice');");
+    }
+
+    auto writer = pool.AcquireWriter();
+    SQLite::Transaction transaction(*writer);
+    writer->exec("INSERT INTO user_ (username) VALUES ('bob');");
+
+    auto reader = pool.AcquireReader();
+    EXPECT_EQ(reader->execAndGet("SELECT COUNT(*) FROM user_;").getInt(), 1);
+}
+
+TEST_F(ConnectionPoolTest, AcquireReader_IsReadOnly) {
+    ConnectionPool pool(config_, queries_mock_);
+
+    auto reader = pool.AcquireReader();
+    EXPECT_THROW(reader->exec("INSERT INTO user_ (username) VALUES ('eve');"),
+                 SQLite::Exception);
+}
+
+TEST_F(ConnectionPoolTest, Lease_Destroyed_ReturnsConnection) {
+    ConnectionPool pool(config_, queries_mock_);
+    {
+        auto first = pool.AcquireReader();
+        auto second = std::move(first);
+        EXPECT_EQ(pool.IdleReaders(), 1);
+    }
+    EXPECT_EQ(pool.IdleReaders(), 2);
+}
+
+TEST_F(ConnectionPoolTest, AcquireReader_AllBorrowed_WaitsForReturn) {
+    ConnectionPool pool(config_, queries_mock_);
+
+    auto first = std::make_unique<ConnectionLease>(pool.AcquireReader());
+    auto second = pool.AcquireReader();
+
+    std::atomic<bool> acquired{false};
+    std::thread waiter([&] {
+        auto third = pool.AcquireReader();
+        acquired = true;
+    });
+
+    std::this_thread::sleep_for(20ms);
+    EXPECT_FALSE(acquired);
+
+    first.reset();
+    waiter.join();
+    EXPECT_TRUE(acquired);
+}
+
+TEST_F(ConnectionPoolTest, WriterLease_ReleasedOnOtherThread_CanBeAcquiredAgain) {
+    ConnectionPool pool(config_, queries_mock_);
+
+    ConnectionLease writer = pool.AcquireWriter();
+    std::thread([lease = std::move(writer)]() mutable {
+        lease->exec("CREATE TABLE moved (id INTEGER);");
+    }).join();
+
+    EXPECT_TRUE(pool.AcquireWriter()->tableExists("moved"));
+}
+
+TEST(ConnectionPoolMemoryTest, AcquireReader_InMemory_UsesWriter) {
+    PoolConfig config;
+    config.path = ":memory:";
+    ConnectionPool pool(config, std::make_shared<NiceMock<MockQueriesManager>>());
+
+    EXPECT_TRUE(pool.AcquireReader().IsWriter());
+}
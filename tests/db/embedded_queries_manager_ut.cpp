@@ -0,0 +1,45 @@
+#include <algorithm>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "db/embedded_queries_manager.hpp"
+#include "db/embedded_sql.hpp"
+
+using namespace bot;
+
+TEST(EmbeddedQueriesManagerTest, GetView_KnownScript_IsNulTerminated) {
+    if (!HasEmbeddedScripts()) {
+        GTEST_SKIP() << "Built with BOT_EMBED_SQL=OFF";
+    }
+    EmbeddedQueriesManager manager;
+
+    ScriptView view = manager.GetView("internal/create_version_table.sql");
+    std::string_view script = view.Text();
+
+    EXPECT_NE(script.find("CREATE TABLE"), std::string_view::npos);
+    EXPECT_EQ(script.data()[script.size()], '\0');
+    EXPECT_EQ(manager.Get("internal/create_version_table.sql"), script);
+}
+
+TEST(EmbeddedQueriesManagerTest, GetView_UnknownScript_Throws) {
+    EmbeddedQueriesManager manager;
+    EXPECT_THROW(manager.GetView("dao/missing.sql"), std::runtime_error);
+}
+
+TEST(EmbeddedQueriesManagerTest, ListSubdirFiles_ReturnsSortedMigrations) {
+    if (!HasEmbeddedScripts()) {
+        GTEST_SKIP() << "Built with BOT_EMBED_SQL=OFF";
+    }
+    EmbeddedQueriesManager manager;
+
+    std::vector<std::filesystem::path> migrations =
+        manager.ListSubdirFiles("migrations/");
+
+    ASSERT_FALSE(migrations.empty());
+    EXPECT_EQ(migrations.front(), "000_schema.sql");
+    EXPECT_TRUE(std::ranges::is_sorted(migrations));
+    EXPECT_EQ(manager.ListSubdirFiles("").size(), EmbeddedScripts().size());
+}
@@ -8,19 +8,13 @@
 #include <vector>
 
 #include "db/migration_manager.hpp"
+#include "mock_queries_manager.hpp"
 
 using namespace bot;
 using ::testing::_;
 using ::testing::NiceMock;
 using ::testing::Return;
 
-class MockQueriesManager : public IQueriesManager {
-public:
-    MOCK_METHOD(std::string, Get, (const std::string& path), (override));
-    MOCK_METHOD(std::vector<std::filesystem::path>, ListSubdirFiles,
-                (const std::filesystem::path& subdir), (override));
-};
-
 class MigrationManagerTest : public ::testing::Test {
 protected:
     std::shared_ptr<SQLite::Database> db_;
@@ -40,7 +34,8 @@ protected:
         test_config_.create_version_table = kSysDir_ + "/create.sql";
         test_config_.get_current_version = kSysDir_ + "/get.sql";
         test_config_.insert_version_record = kSysDir_ + "/insert.sql";
-        test_config_.check_migration_hash = kSysDir_ + "/check.sql";
+        test_config_.get_applied_migrations = kSysDir_ + "/applied.sql";
+        test_config_.update_migration_hash = kSysDir_ + "/update_hash.sql";
 
         SetupSystemQueries();
     }
@@ -57,21 +52,25 @@ protected:
             .WillRepeatedly(Return(
                 "INSERT INTO schema_version (version, name, hash) VALUES (?, ?, ?);"));
 
-        EXPECT_CALL(*queries_mock_, Get(test_config_.check_migration_hash))
-            .WillRepeatedly(Return("SELECT COUNT(*) FROM schema_version WHERE version = "
-                                   "? AND name = ? AND hash = ?;"));
+        EXPECT_CALL(*queries_mock_, Get(test_config_.get_applied_migrations))
+            .WillRepeatedly(Return("SELECT version, name, hash FROM schema_version;"));
+
+        EXPECT_CALL(*queries_mock_, Get(test_config_.update_migration_hash))
+            .WillRepeatedly(Return("UPDATE schema_version SET hash = ?1 "
+                                   "WHERE version = ?2 AND name = ?3;"));
     }
 
-    std::string CalculateHash(const std::string& script) {
+    std::string CalculateLegacyHash(const std::string& script) {
         std::hash<std::string> hasher;
         return std::format("{:016x}", hasher(script));
     }
 
     void ManualInsertVersion(int version, const std::string& name,
-                             const std::string& script_content) {
+                             const std::string& script_content, bool is_legacy = true) {
         db_->exec("CREATE TABLE IF NOT EXISTS schema_version (version INTEGER PRIMARY "
                   "KEY, name TEXT, hash TEXT);");
-        std::string hash = CalculateHash(script_content);
+        std::string hash = is_legacy ? CalculateLegacyHash(script_content)
+                                     : FormatMigrationHash(script_content);
         SQLite::Statement insert(*db_, "INSERT INTO schema_version VALUES (?, ?, ?)");
         insert.bind(1, version);
         insert.bind(2, name);
@@ -147,3 +146,72 @@ TEST_F(MigrationManagerTest, Run_BadSql_RollsBackTransaction) {
     EXPECT_THROW(manager.Run(), SQLite::Exception);
     EXPECT_FALSE(db_->tableExists("broken_table"));
 }
+
+TEST_F(MigrationManagerTest, Run_LegacyHash_RewrittenToStableHash) {
+    std::string script_v1 = "CREATE TABLE users (id INTEGER);";
+    ManualInsertVersion(1, "001_init.sql", script_v1);
+
+    EXPECT_CALL(*queries_mock_, ListSubdirFiles(_))
+        .WillRepeatedly(Return(std::vector<std::filesystem::path>{"001_init.sql"}));
+    EXPECT_CALL(*queries_mock_, Get(test_config_.migrations_dir + "001_init.sql"))
+        .WillRepeatedly(Return(script_v1));
+
+    MigrationManager(db_, queries_mock_, test_config_).Run();
+
+    std::string stored =
+        db_->execAndGet("SELECT hash FROM schema_version WHERE version = 1").getString();
+    EXPECT_EQ(stored, FormatMigrationHash(script_v1));
+    EXPECT_TRUE(stored.starts_with("xxh64:"));
+
+    EXPECT_NO_THROW(MigrationManager(db_, queries_mock_, test_config_).Run());
+}
+
+TEST_F(MigrationManagerTest, Run_StableHashMismatch_ThrowsException) {
+    ManualInsertVersion(1, "001_init.sql", "ORIGINAL SQL", false);
+
+    EXPECT_CALL(*queries_mock_, ListSubdirFiles(_))
+        .WillOnce(Return(std::vector<std::filesystem::path>{"001_init.sql"}));
+    EXPECT_CALL(*queries_mock_, Get(test_config_.migrations_dir + "001_init.sql"))
+        .WillOnce(Return("MODIFIED SQL"));
+
+    MigrationManager manager(db_, queries_mock_, test_config_);
+
+    EXPECT_THROW(manager.Run(), std::invalid_argument);
+}
+
+TEST_F(MigrationManagerTest, Run_ManyAppliedMigrations_ValidatedInOnePass) {
+    std::vector<std::filesystem::path> files;
+    for (int version = 0; version < 300; ++version) {
+        std::string name = std::format("{:03}_step.sql", version);
+        std::string script = std::format("SELECT {};", version);
+        ManualInsertVersion(version, name, script, false);
+        files.emplace_back(name);
+        EXPECT_CALL(*queries_mock_, Get(test_config_.migrations_dir + name))
+            .WillOnce(Return(script));
+    }
+    EXPECT_CALL(*queries_mock_, ListSubdirFiles(_)).WillOnce(Return(files));
+    EXPECT_CALL(*queries_mock_, Get(test_config_.get_applied_migrations))
+        .Times(1)
+        .WillOnce(Return("SELECT version, name, hash FROM schema_version;"));
+
+    MigrationManager manager(db_, queries_mock_, test_config_);
+
+    EXPECT_NO_THROW(manager.Run());
+}
+
+TEST_F(MigrationManagerTest, Run_OnlineMigration_LeftForBackground) {
+    std::vector<std::filesystem::path> files = {"001_init.sql",
+                                                "002_backfill.online.sql"};
+
+    EXPECT_CALL(*queries_mock_, ListSubdirFiles(_)).WillOnce(Return(files));
+    EXPECT_CALL(*queries_mock_, Get(test_config_.migrations_dir + "001_init.sql"))
+        .WillOnce(Return("CREATE TABLE users (id INTEGER);"));
+    EXPECT_CALL(*queries_mock_,
+                Get(test_config_.migrations_dir + "002_backfill.online.sql"))
+        .Times(0);
+
+    MigrationManager manager(db_, queries_mock_, test_config_);
+    manager.Run();
+
+    EXPECT_EQ(db_->execAndGet("SELECT MAX(version) FROM schema_version").getInt(), 1);
+}
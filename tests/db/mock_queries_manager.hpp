@@ -0,0 +1,21 @@
+#pragma once
+
+#include <filesystem>
+#include <gmock/gmock.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "db/queries_manager.hpp"
+
+namespace bot {
+
+class MockQueriesManager : public IQueriesManager {
+public:
+    MOCK_METHOD(std::string, Get, (const std::string& path), (override));
+    MOCK_METHOD(ScriptView, GetView, (std::string_view path), (override));
+    MOCK_METHOD(std::vector<std::filesystem::path>, ListSubdirFiles,
+                (const std::filesystem::path& subdir), (override));
+};
+
+}    // namespace bot
@@ -0,0 +1,137 @@
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <chrono>
+#include <filesystem>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/migration_manager.hpp"
+#include "db/online_migration_runner.hpp"
+#include "mock_queries_manager.hpp"
+
+using namespace bot;
+using namespace std::chrono_literals;
+using ::testing::_;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+namespace {
+
+const std::string kBackfill = "UPDATE user_ SET role = 'user' WHERE id IN ("
+                              "SELECT id FROM user_ WHERE id > :last_key "
+                              "ORDER BY id LIMIT :chunk_size) RETURNING id;";
+
+}    // namespace
+
+class OnlineMigrationRunnerTest : public ::testing::Test {
+protected:
+    std::shared_ptr<MockQueriesManager> queries_mock_;
+    std::shared_ptr<ConnectionPool> pool_;
+    OnlineMigrationConfig config_;
+
+    void SetUp() override {
+        queries_mock_ = std::make_shared<NiceMock<MockQueriesManager>>();
+        ON_CALL(*queries_mock_, Get(config_.create_progress_table))
+            .WillByDefault(Return("CREATE TABLE IF NOT EXISTS online_migrations_("
+                                  "name TEXT PRIMARY KEY, hash TEXT NOT NULL, "
+                                  "last_key INTEGER NOT NULL DEFAULT -1, "
+                                  "rows_done INTEGER NOT NULL DEFAULT 0, "
+                                  "is_done INTEGER NOT NULL DEFAULT 0);"));
+        ON_CALL(*queries_mock_, Get(config_.insert_progress))
+            .WillByDefault(Return("INSERT OR IGNORE INTO online_migrations_(name, hash) "
+                                  "VALUES(?1, ?2);"));
+        ON_CALL(*queries_mock_, Get(config_.get_progress))
+            .WillByDefault(Return("SELECT hash, last_key, is_done "
+                                  "FROM online_migrations_ WHERE name = ?;"));
+        ON_CALL(*queries_mock_, Get(config_.update_progress))
+            .WillByDefault(Return("UPDATE online_migrations_ SET last_key = ?2, "
+                                  "rows_done = rows_done + ?3, is_done = ?4 "
+                                  "WHERE name = ?1;"));
+        ON_CALL(*queries_mock_, Get("migrations/005_backfill.online.sql"))
+            .WillByDefault(Return(kBackfill));
+        ON_CALL(*queries_mock_, ListSubdirFiles(_))
+            .WillByDefault(Return(std::vector<std::filesystem::path>{
+                "004_add_role.sql", "005_backfill.online.sql"}));
+
+        PoolConfig pool_config;
+        pool_config.path = ":memory:";
+        pool_ = std::make_shared<ConnectionPool>(pool_config, queries_mock_);
+        pool_->AcquireWriter()->exec(
+            "CREATE TABLE user_ (id INTEGER PRIMARY KEY, role TEXT);"
+            "WITH RECURSIVE seq(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM seq "
+            "WHERE n < 1000) INSERT INTO user_(id) SELECT n FROM seq;");
+
+        config_.chunk_size = 100;
+        config_.min_chunk_size = 100;
+        config_.max_chunk_size = 100;
+        config_.pause = 0ms;
+    }
+
+    int64_t Query(const std::string& sql) {
+        return pool_->AcquireReader()->execAndGet(sql).getInt64();
+    }
+};
+
+TEST_F(OnlineMigrationRunnerTest, Run_BackfillsInChunksAndRecordsProgress) {
+    OnlineMigrationRunner runner(pool_, queries_mock_, config_);
+    runner.Start();
+    runner.Wait();
+
+    EXPECT_EQ(Query("SELECT COUNT(*) FROM user_ WHERE role IS NULL"), 0);
+    EXPECT_EQ(Query("SELECT rows_done FROM online_migrations_"), 1000);
+    EXPECT_EQ(Query("SELECT is_done FROM online_migrations_"), 1);
+
+    OnlineMigrationStats stats = runner.Stats();
+    EXPECT_EQ(stats.migrations_done, 1);
+    EXPECT_EQ(stats.chunks, 11);
+    EXPECT_EQ(stats.rows, 1000);
+}
+
+TEST_F(OnlineMigrationRunnerTest, Run_InterruptedMigration_ResumesFromLastKey) {
+    pool_->AcquireWriter()->exec(
+        queries_mock_->Get(config_.create_progress_table) +
+        "INSERT INTO online_migrations_(name, hash, last_key) VALUES("
+        "'005_backfill.online.sql', '" +
+        FormatMigrationHash(kBackfill) + "', 600);");
+
+    OnlineMigrationRunner runner(pool_, queries_mock_, config_);
+    runner.Start();
+    runner.Wait();
+
+    EXPECT_EQ(Query("SELECT COUNT(*) FROM user_ WHERE role IS NULL"), 600);
+    EXPECT_EQ(runner.Stats().rows, 400);
+}
+
+TEST_F(OnlineMigrationRunnerTest, Run_ChangedScript_Skipped) {
+    pool_->AcquireWriter()->exec(
+        queries_mock_->Get(config_.create_progress_table) +
+        "INSERT INTO online_migrations_(name, hash) VALUES("
+        "'005_backfill.online.sql', 'xxh64:0000000000000000');");
+
+    OnlineMigrationRunner runner(pool_, queries_mock_, config_);
+    runner.Start();
+    runner.Wait();
+
+    EXPECT_EQ(Query("SELECT COUNT(*) FROM user_ WHERE role IS NULL"), 1000);
+    EXPECT_EQ(runner.Stats().migrations_skipped, 1);
+}
+
+TEST(OnlineMigrationTest, IsOnlineMigration_ChecksSuffix) {
+    EXPECT_TRUE(IsOnlineMigration("005_backfill.online.sql"));
+    EXPECT_FALSE(IsOnlineMigration("004_add_role.sql"));
+}
+
+TEST_F(OnlineMigrationRunnerTest, Run_ChunkHook_CalledForEveryChangedChunk) {
+    std::vector<std::string> chunks;
+    OnlineMigrationRunner runner(pool_, queries_mock_, config_,
+                                 [&chunks](const std::string& name) {
+                                     chunks.push_back(name);
+                                 });
+    runner.Start();
+    runner.Wait();
+
+    ASSERT_EQ(chunks.size(), 10);
+    EXPECT_EQ(chunks.front(), "005_backfill.online.sql");
+}
@@ -0,0 +1,198 @@
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "db/queries_manager.hpp"
+#include "db/sql_dir_watcher.hpp"
+#include "db/statement_cache.hpp"
+
+using namespace bot;
+
+static_assert(!std::is_copy_constructible_v<QueriesManager>);
+static_assert(!std::is_copy_assignable_v<QueriesManager>);
+
+class QueriesManagerTest : public ::testing::Test {
+protected:
+    std::filesystem::path sql_dir_;
+
+    void SetUp() override {
+        sql_dir_ = std::filesystem::temp_directory_path() / "queries_manager_ut";
+        std::filesystem::remove_all(sql_dir_);
+
+        WriteScript("migrations/001_b.sql", "SELECT 1;");
+        WriteScript("migrations/000_a.sql", "SELECT 0;");
+        WriteScript("migrations/nested/002_c.sql", "SELECT 2;");
+        WriteScript("internal/get.sql", "SELECT MAX(version) FROM versions_;");
+        WriteScript("internal/readme.txt", "not a script");
+    }
+
+    void TearDown() override { std::filesystem::remove_all(sql_dir_); }
+
+    void WriteScript(const std::filesystem::path& path, const std::string& content) {
+        std::filesystem::create_directories((sql_dir_ / path).parent_path());
+        std::ofstream(sql_dir_ / path) << content;
+    }
+};
+
+TEST_F(QueriesManagerTest, GetView_KnownScript_ReturnsNulTerminatedView) {
+    QueriesManager manager(sql_dir_);
+
+    ScriptView view = manager.GetView("internal/get.sql");
+    std::string_view script = view.Text();
+
+    EXPECT_EQ(script, "SELECT MAX(version) FROM versions_;");
+    EXPECT_EQ(script.data()[script.size()], '\0');
+    ScriptView again = manager.GetView("internal/get.sql");
+    EXPECT_EQ(again.Text().data(), script.data());
+    EXPECT_EQ(manager.Get("migrations/000_a.sql"), "SELECT 0;");
+}
+
+TEST_F(QueriesManagerTest, GetView_UnknownScript_Throws) {
+    QueriesManager manager(sql_dir_);
+
+    EXPECT_THROW(manager.GetView("internal/readme.txt"), std::runtime_error);
+    EXPECT_THROW(manager.Get("internal/missing.sql"), std::runtime_error);
+}
+
+TEST_F(QueriesManagerTest, ListSubdirFiles_ReturnsSortedRelativePaths) {
+    QueriesManager manager(sql_dir_);
+
+    std::vector<std::filesystem::path> expected = {"000_a.sql", "001_b.sql",
+                                                   "nested/002_c.sql"};
+
+    EXPECT_EQ(manager.ListSubdirFiles("migrations"), expected);
+    EXPECT_EQ(manager.ListSubdirFiles("migrations/"), expected);
+    EXPECT_EQ(manager.ListSubdirFiles("internal"),
+              std::vector<std::filesystem::path>{"get.sql"});
+    EXPECT_TRUE(manager.ListSubdirFiles("unknown").empty());
+}
+
+TEST_F(QueriesManagerTest, Reload_ChangedScript_PublishesNewRevision) {
+    QueriesManager manager(sql_dir_);
+    ScriptView old_view = manager.GetView("migrations/000_a.sql");
+
+    EXPECT_FALSE(manager.Reload());
+    WriteScript("migrations/000_a.sql", "SELECT 10;");
+    EXPECT_TRUE(manager.Reload());
+
+    EXPECT_EQ(manager.Get("migrations/000_a.sql"), "SELECT 10;");
+    EXPECT_EQ(old_view.Text(), "SELECT 0;");
+    EXPECT_EQ(manager.Generation(), 1);
+    EXPECT_EQ(manager.Revision("migrations/000_a.sql"), 1);
+    EXPECT_EQ(manager.Revision("internal/get.sql"), 0);
+}
+
+TEST_F(QueriesManagerTest, Reload_RemovedScript_NoLongerFound) {
+    QueriesManager manager(sql_dir_);
+
+    std::filesystem::remove(sql_dir_ / "internal/get.sql");
+    EXPECT_TRUE(manager.Reload());
+
+    EXPECT_THROW(manager.GetView("internal/get.sql"), std::runtime_error);
+    EXPECT_TRUE(manager.ListSubdirFiles("internal").empty());
+}
+
+TEST_F(QueriesManagerTest, Reload_CachedStatement_PreparedAgain) {
+    WriteScript("dao/value.sql", "SELECT 1;");
+    auto manager = std::make_shared<QueriesManager>(sql_dir_);
+    auto db = std::make_shared<SQLite::Database>(":memory:", SQLite::OPEN_READWRITE |
+                                                                 SQLite::OPEN_CREATE);
+    StatementCache cache(db, manager);
+
+    auto statement = cache.Acquire("dao/value.sql");
+    statement->executeStep();
+    EXPECT_EQ(statement->getColumn(0).getInt(), 1);
+
+    WriteScript("dao/value.sql", "SELECT 2;");
+    manager->Reload();
+
+    auto reloaded = cache.Acquire("dao/value.sql");
+    reloaded->executeStep();
+    EXPECT_EQ(reloaded->getColumn(0).getInt(), 2);
+    EXPECT_EQ(cache.Misses(), 2);
+}
+
+TEST_F(QueriesManagerTest, Reload_HeldView_KeepsItsSnapshotAlive) {
+    QueriesManager manager(sql_dir_);
+    ScriptView old_view = manager.GetView("migrations/000_a.sql");
+
+    for (int i = 1; i <= 20; ++i) {
+        WriteScript("migrations/000_a.sql", "SELECT " + std::to_string(10 + i) + ";");
+        ASSERT_TRUE(manager.Reload());
+    }
+
+    EXPECT_EQ(old_view.Text(), "SELECT 0;");
+    EXPECT_EQ(manager.Get("migrations/000_a.sql"), "SELECT 30;");
+}
+
+TEST_F(QueriesManagerTest, Reload_ConcurrentLookups_SeeWholeScripts) {
+    QueriesManager manager(sql_dir_);
+    std::atomic<bool> is_done{false};
+    std::atomic<int> torn{0};
+    std::thread reader([&] {
+        while (!is_done) {
+            ScriptView view = manager.GetView("migrations/000_a.sql");
+            std::string_view text = view.Text();
+            if (!text.starts_with("SELECT ") || !text.ends_with(";")) {
+                ++torn;
+            }
+        }
+    });
+
+    for (int i = 1; i <= 50; ++i) {
+        // Renamed into place, so a reload never reads a half-written file
+        WriteScript("migrations/000_a.tmp", "SELECT " + std::to_string(i) + ";");
+        std::filesystem::rename(sql_dir_ / "migrations/000_a.tmp",
+                                sql_dir_ / "migrations/000_a.sql");
+        manager.Reload();
+    }
+    is_done = true;
+    reader.join();
+
+    EXPECT_EQ(torn, 0);
+}
+
+TEST_F(QueriesManagerTest, SqlDirWatcher_FileWritten_CallsOnChangeOnce) {
+    int changes = 0;
+    SqlDirWatcher watcher(sql_dir_, [&] { ++changes; }, std::chrono::milliseconds(0),
+                          false);
+
+    WriteScript("migrations/003_d.sql", "SELECT 3;");
+    WriteScript("migrations/004_e.sql", "SELECT 4;");
+
+    EXPECT_TRUE(watcher.Poll(std::chrono::seconds(1)));
+    EXPECT_FALSE(watcher.Poll(std::chrono::milliseconds(0)));
+    EXPECT_EQ(changes, 1);
+}
+
+TEST_F(QueriesManagerTest, SqlDirWatcher_WithinDebounce_WaitsForQuietPeriod) {
+    int changes = 0;
+    SqlDirWatcher watcher(sql_dir_, [&] { ++changes; }, std::chrono::hours(1), false);
+
+    WriteScript("migrations/003_d.sql", "SELECT 3;");
+
+    EXPECT_FALSE(watcher.Poll(std::chrono::seconds(1)));
+    EXPECT_EQ(changes, 0);
+}
+
+TEST_F(QueriesManagerTest, SqlDirWatcher_NewSubdir_Watched) {
+    int changes = 0;
+    SqlDirWatcher watcher(sql_dir_, [&] { ++changes; }, std::chrono::milliseconds(0),
+                          false);
+
+    std::filesystem::create_directories(sql_dir_ / "views");
+    EXPECT_TRUE(watcher.Poll(std::chrono::seconds(1)));
+    WriteScript("views/active.sql", "SELECT 5;");
+    EXPECT_TRUE(watcher.Poll(std::chrono::seconds(1)));
+
+    EXPECT_EQ(changes, 2);
+}
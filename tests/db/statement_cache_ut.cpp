@@ -0,0 +1,92 @@
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+#include "db/statement_cache.hpp"
+#include "mock_queries_manager.hpp"
+
+using namespace bot;
+using ::testing::_;
+using ::testing::AnyNumber;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+class StatementCacheTest : public ::testing::Test {
+protected:
+    std::shared_ptr<SQLite::Database> db_;
+    std::shared_ptr<MockQueriesManager> queries_mock_;
+
+    void SetUp() override {
+        db_ = std::make_shared<SQLite::Database>(":memory:", SQLite::OPEN_READWRITE |
+                                                                 SQLite::OPEN_CREATE);
+        db_->exec("CREATE TABLE user_ (id INTEGER PRIMARY KEY, username TEXT);");
+        db_->exec("INSERT INTO user_ (username) VALUES ('alice'), ('bob');");
+
+        queries_mock_ = std::make_shared<NiceMock<MockQueriesManager>>();
+        ON_CALL(*queries_mock_, Get("count.sql"))
+            .WillByDefault(Return("SELECT COUNT(*) FROM user_ WHERE username = ?;"));
+        ON_CALL(*queries_mock_, Get("max.sql"))
+            .WillByDefault(Return("SELECT MAX(id) FROM user_;"));
+        ON_CALL(*queries_mock_, Get("min.sql"))
+            .WillByDefault(Return("SELECT MIN(id) FROM user_;"));
+    }
+};
+
+TEST_F(StatementCacheTest, Acquire_SamePath_PreparesOnce) {
+    EXPECT_CALL(*queries_mock_, Get("count.sql")).Times(1);
+
+    StatementCache cache(db_, queries_mock_);
+
+    for (int i = 0; i < 3; ++i) {
+        auto count = cache.Acquire("count.sql");
+        count->bind(1, "alice");
+        ASSERT_TRUE(count->executeStep());
+        EXPECT_EQ(count->getColumn(0).getInt(), 1);
+    }
+
+    EXPECT_EQ(cache.Misses(), 1);
+    EXPECT_EQ(cache.Hits(), 2);
+}
+
+TEST_F(StatementCacheTest, Acquire_Hit_ReturnsResetStatement) {
+    StatementCache cache(db_, queries_mock_);
+
+    auto first = cache.Acquire("count.sql");
+    first->bind(1, "alice");
+    first->executeStep();
+
+    auto second = cache.Acquire("count.sql");
+    ASSERT_TRUE(second->executeStep());
+    EXPECT_EQ(second->getColumn(0).getInt(), 0);
+}
+
+TEST_F(StatementCacheTest, Acquire_OverCapacity_EvictsLeastRecentlyUsed) {
+    EXPECT_CALL(*queries_mock_, Get(_)).Times(AnyNumber());
+    EXPECT_CALL(*queries_mock_, Get("count.sql")).Times(2);
+
+    StatementCache cache(db_, queries_mock_, 2);
+
+    cache.Acquire("count.sql");
+    cache.Acquire("max.sql");
+    cache.Acquire("count.sql");
+    cache.Acquire("min.sql");
+    EXPECT_EQ(cache.Size(), 2);
+
+    cache.Acquire("max.sql");
+    cache.Acquire("count.sql");
+
+    EXPECT_EQ(cache.Hits(), 1);
+    EXPECT_EQ(cache.Misses(), 5);
+}
+
+TEST_F(StatementCacheTest, Acquire_EvictedStatement_StaysUsable) {
+    StatementCache cache(db_, queries_mock_, 1);
+
+    auto max = cache.Acquire("max.sql");
+    cache.Acquire("min.sql");
+
+    ASSERT_TRUE(max->executeStep());
+    EXPECT_EQ(max->getColumn(0).getInt(), 2);
+}
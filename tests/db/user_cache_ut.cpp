@@ -0,0 +1,149 @@
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <chrono>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "db/migration_manager.hpp"
+#include "db/queries_manager.hpp"
+#include "db/user_cache.hpp"
+#include "db/user_write_behind.hpp"
+
+using namespace bot;
+using namespace std::chrono_literals;
+
+class UserCacheTest : public ::testing::Test {
+protected:
+    std::shared_ptr<ConnectionPool> pool_;
+    UserCacheConfig config_;
+
+    void SetUp() override {
+        auto queries = std::make_shared<QueriesManager>(TEST_SQL_DIR);
+        PoolConfig pool_config;
+        pool_config.path = ":memory:";
+        pool_ = std::make_shared<ConnectionPool>(pool_config, queries);
+        {
+            ConnectionLease writer = pool_->AcquireWriter();
+            MigrationManager(writer.Database(), queries, writer.Statements(), Config{})
+                .Run();
+        }
+        AddUser("alice", "admin", 101);
+        AddUser("bob", "user", 102);
+    }
+
+    void AddUser(const std::string& username, const std::string& role, int64_t tg_id) {
+        ConnectionLease writer = pool_->AcquireWriter();
+        SQLite::Statement insert(
+            *writer, "INSERT INTO user_(username, role, tg_id) VALUES(?, ?, ?)");
+        insert.bind(1, username);
+        insert.bind(2, role);
+        insert.bind(3, tg_id);
+        insert.exec();
+    }
+
+    void Exec(const std::string& sql) { pool_->AcquireWriter()->exec(sql); }
+};
+
+TEST_F(UserCacheTest, WarmUp_LoadsUsers_LookupsSkipDatabase) {
+    UserCache cache(pool_, config_);
+    EXPECT_EQ(cache.WarmUp(), 2);
+    Exec("DELETE FROM user_");
+
+    auto alice = cache.FindByTgId(101);
+    ASSERT_TRUE(alice);
+    EXPECT_EQ(alice->username, "alice");
+    EXPECT_EQ(alice->role, "admin");
+    EXPECT_EQ(cache.FindByUsername("bob")->tg_id, 102);
+
+    UserCacheStats stats = cache.Stats();
+    EXPECT_EQ(stats.users, 2);
+    EXPECT_EQ(stats.hits, 2);
+    EXPECT_EQ(stats.misses, 0);
+}
+
+TEST_F(UserCacheTest, Find_Miss_ReadsThroughAndCaches) {
+    UserCache cache(pool_, config_);
+
+    EXPECT_EQ(cache.FindByUsername("alice")->id, 1);
+    EXPECT_EQ(cache.FindByTgId(101)->username, "alice");
+
+    UserCacheStats stats = cache.Stats();
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.hits, 1);
+}
+
+TEST_F(UserCacheTest, Find_UnknownUser_IsRememberedUntilInvalidated) {
+    UserCache cache(pool_, config_);
+
+    EXPECT_FALSE(cache.FindByTgId(999));
+    AddUser("carol", "user", 999);
+    EXPECT_FALSE(cache.FindByTgId(999));
+    EXPECT_EQ(cache.Stats().negative_hits, 1);
+
+    cache.Invalidate({"carol", std::nullopt, std::nullopt, 999});
+    ASSERT_TRUE(cache.FindByTgId(999));
+    EXPECT_EQ(cache.FindByTgId(999)->username, "carol");
+}
+
+TEST_F(UserCacheTest, Find_NegativeTtlPassed_QueriesAgain) {
+    config_.negative_ttl = 0s;
+    UserCache cache(pool_, config_);
+
+    EXPECT_FALSE(cache.FindByUsername("dave"));
+    AddUser("dave", "user", 104);
+
+    EXPECT_TRUE(cache.FindByUsername("dave"));
+    EXPECT_EQ(cache.Stats().misses, 2);
+}
+
+TEST_F(UserCacheTest, WriteBehindHook_RoleChange_InvalidatesUser) {
+    auto cache = std::make_shared<UserCache>(pool_, config_);
+    cache->WarmUp();
+    auto invalidate = [cache](const UserRecord& record) { cache->Invalidate(record); };
+    UserWriteBehind writes(pool_, {}, invalidate);
+
+    EXPECT_EQ(cache->FindByTgId(102)->role, "user");
+    writes.Upsert({"bob", std::nullopt, "admin"}).get();
+
+    EXPECT_EQ(cache->FindByTgId(102)->role, "admin");
+    EXPECT_EQ(cache->FindByUsername("bob")->role, "admin");
+}
+
+TEST_F(UserCacheTest, InvalidateAll_BulkUpdate_IsVisible) {
+    UserCache cache(pool_, config_);
+    cache.WarmUp();
+    Exec("UPDATE user_ SET role = 'guest'");
+
+    EXPECT_EQ(cache.FindByUsername("alice")->role, "admin");
+    cache.InvalidateAll();
+    EXPECT_EQ(cache.FindByUsername("alice")->role, "guest");
+}
+
+TEST_F(UserCacheTest, Store_OverMaxUsers_KeepsCacheBounded) {
+    config_.max_users = 2;
+    AddUser("erin", "user", 105);
+    UserCache cache(pool_, config_);
+
+    EXPECT_EQ(cache.WarmUp(), 2);
+    EXPECT_TRUE(cache.FindByUsername("alice"));
+    EXPECT_EQ(cache.Stats().users, 2);
+}
+
+TEST_F(UserCacheTest, Store_OverMaxUsers_EvictsLeastRecentlyUsed) {
+    config_.max_users = 2;
+    AddUser("erin", "user", 105);
+    UserCache cache(pool_, config_);
+    cache.FindByUsername("alice");
+    cache.FindByUsername("bob");
+
+    cache.FindByUsername("alice");
+    cache.FindByUsername("erin");
+    Exec("DELETE FROM user_");
+
+    EXPECT_TRUE(cache.FindByUsername("alice"));
+    EXPECT_TRUE(cache.FindByUsername("erin"));
+    EXPECT_FALSE(cache.FindByUsername("bob"));
+    EXPECT_EQ(cache.Stats().users, 2);
+}
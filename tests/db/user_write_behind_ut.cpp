@@ -0,0 +1,177 @@
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <chrono>
+#include <future>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/user_write_behind.hpp"
+#include "metrics/metrics.hpp"
+#include "mock_queries_manager.hpp"
+
+using namespace bot;
+using namespace std::chrono_literals;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+class UserWriteBehindTest : public ::testing::Test {
+protected:
+    std::shared_ptr<MockQueriesManager> queries_mock_;
+    std::shared_ptr<ConnectionPool> pool_;
+    WriteBehindConfig config_;
+
+    void SetUp() override {
+        queries_mock_ = std::make_shared<NiceMock<MockQueriesManager>>();
+        ON_CALL(*queries_mock_, Get("dao/upsert_user.sql"))
+            .WillByDefault(Return("INSERT INTO user_(username, email, role, tg_id) "
+                                  "VALUES(?1, ?2, COALESCE(?3, 'user'), ?4) "
+                                  "ON CONFLICT(username) DO UPDATE SET "
+                                  "email = COALESCE(?2, email), "
+                                  "role = COALESCE(?3, role), "
+                                  "tg_id = COALESCE(?4, tg_id);"));
+
+        PoolConfig pool_config;
+        pool_config.path = ":memory:";
+        pool_ = std::make_shared<ConnectionPool>(pool_config, queries_mock_);
+        pool_->AcquireWriter()->exec(
+            "CREATE TABLE user_ (id INTEGER PRIMARY KEY, username TEXT NOT NULL UNIQUE, "
+            "email TEXT, role TEXT DEFAULT 'user', tg_id INTEGER);");
+
+        config_.max_batch = 4;
+        config_.flush_interval = 10s;
+    }
+
+    std::string Query(const std::string& sql) {
+        return pool_->AcquireReader()->execAndGet(sql).getString();
+    }
+};
+
+TEST_F(UserWriteBehindTest, Upsert_SameUsername_CoalescesIntoOneRow) {
+    UserWriteBehind writes(pool_, config_);
+
+    auto first = writes.Upsert({"alice", "a@example.com", std::nullopt});
+    auto second = writes.Upsert({"alice", std::nullopt, "admin"});
+    auto third = writes.Upsert({"alice", "alice@example.com", std::nullopt});
+    writes.Flush();
+
+    first.get();
+    second.get();
+    third.get();
+
+    EXPECT_EQ(Query("SELECT email || ':' || role FROM user_ WHERE username = 'alice'"),
+              "alice@example.com:admin");
+
+    WriteBehindStats stats = writes.Stats();
+    EXPECT_EQ(stats.flushes, 1);
+    EXPECT_EQ(stats.rows_written, 1);
+    EXPECT_EQ(stats.writes_coalesced, 2);
+}
+
+TEST_F(UserWriteBehindTest, Upsert_ExistingRow_KeepsUnsetFields) {
+    UserWriteBehind writes(pool_, config_);
+
+    writes.Upsert({"bob", "bob@example.com", "admin"});
+    writes.Flush();
+    auto update = writes.Upsert({"bob", std::nullopt, "user"});
+    writes.Flush();
+    update.get();
+
+    EXPECT_EQ(Query("SELECT email || ':' || role FROM user_ WHERE username = 'bob'"),
+              "bob@example.com:user");
+}
+
+TEST_F(UserWriteBehindTest, Upsert_TgId_IsKeptByLaterWrites) {
+    UserWriteBehind writes(pool_, config_);
+
+    writes.Upsert({"erin", std::nullopt, std::nullopt, 4242});
+    writes.Flush();
+    auto update = writes.Upsert({"erin", "erin@example.com", std::nullopt});
+    writes.Flush();
+    update.get();
+
+    EXPECT_EQ(Query("SELECT tg_id FROM user_ WHERE username = 'erin'"), "4242");
+}
+
+TEST_F(UserWriteBehindTest, Upsert_BatchFull_FlushesWithoutWaitingForTimer) {
+    UserWriteBehind writes(pool_, config_);
+
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 4; ++i) {
+        futures.push_back(writes.Upsert({"user" + std::to_string(i), {}, {}}));
+    }
+
+    for (auto& future : futures) {
+        ASSERT_EQ(future.wait_for(5s), std::future_status::ready);
+    }
+    EXPECT_EQ(Query("SELECT COUNT(*) FROM user_"), "4");
+    EXPECT_EQ(writes.Stats().max_batch_size, 4);
+}
+
+TEST_F(UserWriteBehindTest, Upsert_IntervalPassed_Flushes) {
+    config_.flush_interval = 10ms;
+    UserWriteBehind writes(pool_, config_);
+
+    auto future = writes.Upsert({"carol", {}, {}});
+
+    ASSERT_EQ(future.wait_for(5s), std::future_status::ready);
+    EXPECT_EQ(Query("SELECT role FROM user_ WHERE username = 'carol'"), "user");
+}
+
+TEST_F(UserWriteBehindTest, Upsert_FailedFlush_PropagatesError) {
+    pool_->AcquireWriter()->exec("DROP TABLE user_;");
+    UserWriteBehind writes(pool_, config_);
+
+    auto future = writes.Upsert({"dave", {}, {}});
+    writes.Flush();
+
+    EXPECT_THROW(future.get(), SQLite::Exception);
+    EXPECT_EQ(writes.Stats().failed_flushes, 1);
+}
+
+TEST_F(UserWriteBehindTest, Upsert_OneRowFails_OnlyItsFutureGetsTheError) {
+    pool_->AcquireWriter()->exec(
+        "CREATE TRIGGER reject_mallory BEFORE INSERT ON user_ "
+        "WHEN NEW.username = 'mallory' BEGIN SELECT RAISE(ABORT, 'rejected'); END;");
+    std::vector<std::string> written;
+    UserWriteBehind writes(pool_, config_, [&written](const UserRecord& record) {
+        written.push_back(record.username);
+    });
+
+    auto alice = writes.Upsert({"alice", {}, {}});
+    auto mallory = writes.Upsert({"mallory", {}, {}});
+    auto bob = writes.Upsert({"bob", {}, {}});
+    writes.Flush();
+
+    EXPECT_NO_THROW(alice.get());
+    EXPECT_THROW(mallory.get(), SQLite::Exception);
+    EXPECT_NO_THROW(bob.get());
+    EXPECT_EQ(Query("SELECT group_concat(username) FROM user_"), "alice,bob");
+    EXPECT_EQ(written, (std::vector<std::string>{"alice", "bob"}));
+
+    WriteBehindStats stats = writes.Stats();
+    EXPECT_EQ(stats.failed_flushes, 1);
+    EXPECT_EQ(stats.failed_rows, 1);
+    EXPECT_EQ(stats.rows_written, 2);
+}
+
+TEST_F(UserWriteBehindTest, Flush_RecordsDurationAndBatchSize) {
+    Histogram& duration = Metrics().GetHistogram("user_write_flush_duration_seconds",
+                                                 "User write-behind flush latency");
+    Histogram& batch_size = Metrics().GetHistogram(
+        "user_write_batch_size", "Rows per user write-behind flush", {}, 1);
+    Histogram::Snapshot duration_before = duration.Collect();
+    Histogram::Snapshot batch_before = batch_size.Collect();
+    UserWriteBehind writes(pool_, config_);
+
+    writes.Upsert({"alice", {}, {}});
+    writes.Upsert({"bob", {}, {}});
+    writes.Upsert({"carol", {}, {}});
+    writes.Flush();
+
+    EXPECT_EQ(duration.Collect().count, duration_before.count + 1);
+    Histogram::Snapshot batch_after = batch_size.Collect();
+    EXPECT_EQ(batch_after.count, batch_before.count + 1);
+    EXPECT_EQ(batch_after.sum, batch_before.sum + 3);
+}
@@ -0,0 +1,90 @@
+#include <atomic>
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "di/di.hpp"
+
+using namespace bot;
+
+namespace {
+
+struct ICounter {
+    virtual ~ICounter() = default;
+    virtual int Value() const = 0;
+};
+
+struct Counter final : ICounter {
+    explicit Counter(int value) : value(value) {}
+    int Value() const override { return value; }
+    int value;
+};
+
+struct Consumer {
+    explicit Consumer(std::shared_ptr<ICounter> counter) : counter(std::move(counter)) {}
+    std::shared_ptr<ICounter> counter;
+};
+
+}    // namespace
+
+TEST(DiContainerTest, Get_RegisteredInterface_ReturnsSameInstance) {
+    DiContainer ctx;
+    REGISTER_I(ctx, ICounter, Counter, 7);
+    REGISTER(ctx, Consumer, GET(ctx, ICounter));
+
+    auto consumer = GET(ctx, Consumer);
+
+    EXPECT_EQ(consumer->counter->Value(), 7);
+    EXPECT_EQ(consumer->counter, GET(ctx, ICounter));
+    EXPECT_EQ(consumer, GET(ctx, Consumer));
+}
+
+TEST(DiContainerTest, Get_ConcurrentFirstResolution_BuildsOnce) {
+    DiContainer ctx;
+    std::atomic<int> builds = 0;
+    ctx.Register<ICounter>([&](DiContainer&) {
+        ++builds;
+        return std::make_shared<Counter>(1);
+    });
+
+    std::vector<std::shared_ptr<ICounter>> resolved(8);
+    {
+        std::vector<std::jthread> threads;
+        for (size_t i = 0; i < resolved.size(); ++i) {
+            threads.emplace_back([&, i] { resolved[i] = GET(ctx, ICounter); });
+        }
+    }
+
+    EXPECT_EQ(builds, 1);
+    for (const auto& counter : resolved) {
+        EXPECT_EQ(counter, resolved.front());
+    }
+}
+
+TEST(DiContainerTest, Get_Unregistered_Throws) {
+    DiContainer ctx;
+    EXPECT_THROW(GET(ctx, Consumer), std::runtime_error);
+}
+
+TEST(DiContainerTest, Register_Twice_Throws) {
+    DiContainer ctx;
+    REGISTER_I(ctx, ICounter, Counter, 1);
+    EXPECT_THROW(REGISTER_I(ctx, ICounter, Counter, 2), std::runtime_error);
+}
+
+TEST(DiContainerTest, Get_FactoryThrows_RetriedOnNextCall) {
+    DiContainer ctx;
+    bool is_failing = true;
+    ctx.Register<ICounter>([&](DiContainer&) -> std::shared_ptr<void> {
+        if (is_failing) {
+            throw std::runtime_error("not ready");
+        }
+        return std::make_shared<Counter>(3);
+    });
+
+    EXPECT_THROW(GET(ctx, ICounter), std::runtime_error);
+    is_failing = false;
+    EXPECT_EQ(Scope<ICounter>(ctx)->Value(), 3);
+}
@@ -0,0 +1,124 @@
+#include <chrono>
+#include <gtest/gtest.h>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <spdlog/details/log_msg.h>
+#include <spdlog/sinks/base_sink.h>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "logging/async_sink.hpp"
+#include "logging/log_limiter.hpp"
+
+using namespace bot;
+
+namespace {
+
+class CollectingSink final : public spdlog::sinks::base_sink<std::mutex> {
+public:
+    std::vector<std::string> messages;
+    std::latch* gate = nullptr;    ///< When set, the first record blocks on it
+
+protected:
+    void sink_it_(const spdlog::details::log_msg& msg) override {
+        if (gate) {
+            std::exchange(gate, nullptr)->wait();
+        }
+        messages.emplace_back(msg.payload.data(), msg.payload.size());
+    }
+
+    void flush_() override {}
+};
+
+spdlog::details::log_msg Message(const std::string& text) {
+    return spdlog::details::log_msg("test", spdlog::level::info, text);
+}
+
+}    // namespace
+
+TEST(AsyncSinkTest, Flush_WritesEveryRecordInOrder) {
+    auto collector = std::make_shared<CollectingSink>();
+    AsyncSink sink(collector, 1024);
+
+    for (int i = 0; i < 1000; ++i) {
+        sink.log(Message("message " + std::to_string(i)));
+    }
+    sink.flush();
+
+    ASSERT_EQ(collector->messages.size(), 1000U);
+    EXPECT_EQ(collector->messages.front(), "message 0");
+    EXPECT_EQ(collector->messages.back(), "message 999");
+    EXPECT_EQ(sink.Dropped(), 0U);
+}
+
+TEST(AsyncSinkTest, ConcurrentProducers_NothingLost) {
+    auto collector = std::make_shared<CollectingSink>();
+    {
+        AsyncSink sink(collector, 1 << 16);
+        std::vector<std::jthread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&] {
+                for (int i = 0; i < 5000; ++i) {
+                    sink.log(Message("x"));
+                }
+            });
+        }
+    }
+
+    EXPECT_EQ(collector->messages.size(), 20000U);
+}
+
+TEST(AsyncSinkTest, FullQueue_DropsAndReports) {
+    auto collector = std::make_shared<CollectingSink>();
+    std::latch gate(1);
+    collector->gate = &gate;
+    uint64_t dropped = 0;
+    {
+        AsyncSink sink(collector, 4);
+        for (int i = 0; i < 100; ++i) {
+            sink.log(Message("message"));
+        }
+        dropped = sink.Dropped();
+        gate.count_down();
+    }
+
+    EXPECT_GT(dropped, 0U);
+    ASSERT_EQ(collector->messages.size(), 100 - dropped + 1);
+    EXPECT_EQ(collector->messages.back(),
+              "Dropped " + std::to_string(dropped) + " log messages, the queue is full");
+}
+
+TEST(LogRateLimiterTest, AllowsBurstThenCountsSuppressed) {
+    LogRateLimiter limiter(0.001, 3);
+
+    EXPECT_TRUE(limiter.Allow());
+    EXPECT_TRUE(limiter.Allow());
+    EXPECT_TRUE(limiter.Allow());
+    EXPECT_FALSE(limiter.Allow());
+    EXPECT_FALSE(limiter.Allow());
+
+    EXPECT_EQ(limiter.TakeSuppressed(), 2U);
+    EXPECT_EQ(limiter.TakeSuppressed(), 0U);
+}
+
+TEST(LogRateLimiterTest, RefillsOverTime) {
+    LogRateLimiter limiter(1000);
+
+    EXPECT_TRUE(limiter.Allow());
+    EXPECT_FALSE(limiter.Allow());
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    EXPECT_TRUE(limiter.Allow());
+}
+
+TEST(LogSamplerTest, AllowsFirstOfEveryN) {
+    LogSampler sampler(3);
+    std::vector<bool> allowed;
+    for (int i = 0; i < 7; ++i) {
+        allowed.push_back(sampler.Allow());
+    }
+
+    EXPECT_EQ(allowed, (std::vector<bool>{true, false, false, true, false, false, true}));
+}
@@ -0,0 +1,151 @@
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "metrics/metrics.hpp"
+#include "metrics/metrics_server.hpp"
+
+using namespace bot;
+
+namespace {
+
+std::string HttpGet(uint16_t port, const std::string& path) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return "";
+    }
+
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    send(fd, request.data(), request.size(), 0);
+
+    std::string response;
+    char buffer[4096];
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        response.append(buffer, static_cast<size_t>(length));
+    }
+    close(fd);
+    return response;
+}
+
+}    // namespace
+
+TEST(MetricsTest, Counter_SumsAllThreads) {
+    Counter counter;
+    std::vector<std::jthread> threads;
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&] {
+            for (int j = 0; j < 10000; ++j) {
+                counter.Add();
+            }
+        });
+    }
+    threads.clear();
+
+    EXPECT_EQ(counter.Value(), 80000U);
+}
+
+TEST(MetricsTest, Histogram_BucketBoundsAreMonotonic) {
+    for (size_t bucket = 1; bucket < Histogram::kBuckets; ++bucket) {
+        uint64_t lower = Histogram::BucketLowerBound(bucket);
+        ASSERT_LT(Histogram::BucketLowerBound(bucket - 1), lower);
+        ASSERT_EQ(Histogram::BucketOf(lower), bucket);
+        ASSERT_EQ(Histogram::BucketOf(lower - 1), bucket - 1);
+    }
+    EXPECT_EQ(Histogram::BucketOf(UINT64_MAX), Histogram::kBuckets - 1);
+}
+
+TEST(MetricsTest, Histogram_QuantilesWithinBucketError) {
+    Histogram histogram;
+    for (uint64_t value = 1; value <= 100000; ++value) {
+        histogram.Record(value);
+    }
+
+    Histogram::Snapshot snapshot = histogram.Collect();
+    EXPECT_EQ(snapshot.count, 100000U);
+    EXPECT_EQ(snapshot.sum, 100000ULL * 100001 / 2);
+    for (double q : {0.5, 0.9, 0.99}) {
+        double expected = q * 100000;
+        EXPECT_NEAR(static_cast<double>(snapshot.Quantile(q)), expected, expected * 0.125)
+            << "q = " << q;
+    }
+    EXPECT_EQ(Histogram::Snapshot{}.Quantile(0.5), 0U);
+}
+
+TEST(MetricsTest, Registry_ReturnsSameSeriesForSameLabels) {
+    MetricsRegistry registry;
+    MetricLabels ok = {{"code", "200"}};
+    Counter& first = registry.GetCounter("requests_total", "Requests", ok);
+    Counter& second = registry.GetCounter("requests_total", "Requests", ok);
+    Counter& other = registry.GetCounter("requests_total", "Requests", {{"code", "500"}});
+
+    EXPECT_EQ(&first, &second);
+    EXPECT_NE(&first, &other);
+}
+
+TEST(MetricsTest, Render_PrometheusTextFormat) {
+    MetricsRegistry registry;
+    registry.GetCounter("requests_total", "Requests", {{"code", "200"}}).Add(3);
+    registry.GetGauge("queue_depth", "Queue depth").Set(-2);
+    Histogram& latency = registry.GetHistogram("latency_seconds", "Latency");
+    latency.Record(std::chrono::milliseconds(10));
+    registry.GetCounter("escaped_total", "Escaping", {{"path", "a\"b\\c"}});
+
+    std::string text = registry.Render();
+
+    EXPECT_NE(text.find("# TYPE requests_total counter\n"), std::string::npos);
+    EXPECT_NE(text.find("requests_total{code=\"200\"} 3\n"), std::string::npos);
+    EXPECT_NE(text.find("# TYPE queue_depth gauge\nqueue_depth -2\n"), std::string::npos);
+    EXPECT_NE(text.find("# TYPE latency_seconds summary\n"), std::string::npos);
+    EXPECT_NE(text.find("latency_seconds{quantile=\"0.99\"} 0.0"), std::string::npos);
+    EXPECT_NE(text.find("latency_seconds_sum 0.01"), std::string::npos);
+    EXPECT_NE(text.find("latency_seconds_count 1\n"), std::string::npos);
+    EXPECT_NE(text.find("escaped_total{path=\"a\\\"b\\\\c\"} 0\n"), std::string::npos);
+}
+
+TEST(MetricsServerTest, ServesMetricsOnEphemeralPort) {
+    MetricsRegistry registry;
+    registry.GetCounter("served_total", "Served").Add(7);
+    MetricsServer server(registry, "127.0.0.1", 0);
+    ASSERT_NE(server.Port(), 0);
+
+    std::string response = HttpGet(server.Port(), "/metrics");
+    EXPECT_TRUE(response.starts_with("HTTP/1.0 200 OK\r\n"));
+    EXPECT_NE(response.find("text/plain; version=0.0.4"), std::string::npos);
+    EXPECT_NE(response.find("served_total 7\n"), std::string::npos);
+
+    EXPECT_TRUE(HttpGet(server.Port(), "/other").starts_with("HTTP/1.0 404"));
+}
+
+TEST(MetricsServerTest, AddRoute_ServesHandlerOutput) {
+    MetricsRegistry registry;
+    MetricsServer server(registry, "127.0.0.1", 0);
+    server.AddRoute("/debug/trace", "application/json", [] { return "{}"; });
+    server.AddRoute("/debug/fail", "text/plain",
+                    []() -> std::string { throw std::runtime_error("broken"); });
+
+    std::string response = HttpGet(server.Port(), "/debug/trace");
+    EXPECT_TRUE(response.starts_with("HTTP/1.0 200 OK\r\n"));
+    EXPECT_NE(response.find("application/json"), std::string::npos);
+    EXPECT_TRUE(response.ends_with("\r\n\r\n{}"));
+
+    EXPECT_TRUE(HttpGet(server.Port(), "/debug/fail").starts_with("HTTP/1.0 500"));
+}
+
+TEST(MetricsServerTest, InvalidAddress_Throws) {
+    MetricsRegistry registry;
+    EXPECT_THROW(MetricsServer(registry, "not-an-address", 0), std::invalid_argument);
+}
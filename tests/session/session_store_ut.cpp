@@ -0,0 +1,153 @@
+#include <chrono>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "db/migration_manager.hpp"
+#include "db/queries_manager.hpp"
+#include "session/session_store.hpp"
+
+using namespace bot;
+using namespace std::chrono_literals;
+
+class SessionStoreTest : public ::testing::Test {
+protected:
+    std::shared_ptr<ConnectionPool> pool_;
+    SessionStoreConfig config_;
+
+    void SetUp() override {
+        auto queries = std::make_shared<QueriesManager>(TEST_SQL_DIR);
+        PoolConfig pool_config;
+        pool_config.path = ":memory:";
+        pool_ = std::make_shared<ConnectionPool>(pool_config, queries);
+        {
+            ConnectionLease writer = pool_->AcquireWriter();
+            MigrationManager(writer.Database(), queries, writer.Statements(), Config{})
+                .Run();
+        }
+        config_.snapshot_interval = 10ms;
+    }
+
+    int64_t Query(const std::string& sql) {
+        return pool_->AcquireReader()->execAndGet(sql).getInt64();
+    }
+};
+
+TEST_F(SessionStoreTest, Set_ThenGet_ReturnsStateFromMemory) {
+    SessionStore sessions(pool_, config_);
+
+    EXPECT_FALSE(sessions.Get(1));
+    sessions.Set(1, {"await_email", R"({"role":"admin"})"});
+    sessions.Set(-100500, {"await_role", ""});
+
+    auto state = sessions.Get(1);
+    ASSERT_TRUE(state);
+    EXPECT_EQ(state->state, "await_email");
+    EXPECT_EQ(state->data, R"({"role":"admin"})");
+    EXPECT_EQ(sessions.Get(-100500)->state, "await_role");
+    EXPECT_EQ(Query("SELECT COUNT(*) FROM session_"), 0);
+
+    SessionStats stats = sessions.Stats();
+    EXPECT_EQ(stats.sessions, 2);
+    EXPECT_EQ(stats.hits, 2);
+    EXPECT_EQ(stats.misses, 1);
+}
+
+TEST_F(SessionStoreTest, Snapshot_WritesOnlyChangedChats) {
+    SessionStore sessions(pool_, config_);
+    for (int64_t chat_id = 1; chat_id <= 10; ++chat_id) {
+        sessions.Set(chat_id, {"start", ""});
+    }
+
+    EXPECT_EQ(sessions.Snapshot(), 10);
+    EXPECT_EQ(sessions.Snapshot(), 0);
+
+    sessions.Set(3, {"await_email", ""});
+    sessions.Erase(4);
+    EXPECT_EQ(sessions.Snapshot(), 2);
+    EXPECT_EQ(Query("SELECT COUNT(*) FROM session_"), 9);
+    EXPECT_EQ(Query("SELECT COUNT(*) FROM session_ WHERE state = 'await_email'"), 1);
+}
+
+TEST_F(SessionStoreTest, Restore_AfterRestart_LoadsSnapshot) {
+    {
+        SessionStore sessions(pool_, config_);
+        sessions.Start();
+        sessions.Set(7, {"await_role", "x"});
+        sessions.Set(8, {"await_email", ""});
+        sessions.Erase(8);
+    }
+
+    SessionStore restored(pool_, config_);
+    EXPECT_EQ(restored.Restore(), 1);
+    ASSERT_TRUE(restored.Get(7));
+    EXPECT_EQ(restored.Get(7)->data, "x");
+    EXPECT_FALSE(restored.Get(8));
+}
+
+TEST_F(SessionStoreTest, Start_Periodically_SnapshotsInBackground) {
+    SessionStore sessions(pool_, config_);
+    sessions.Start();
+    sessions.Set(1, {"start", ""});
+
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (Query("SELECT COUNT(*) FROM session_") == 0 &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(5ms);
+    }
+    EXPECT_EQ(Query("SELECT COUNT(*) FROM session_"), 1);
+}
+
+TEST_F(SessionStoreTest, Get_AfterTtl_ExpiresAndSnapshotDeletesRow) {
+    config_.ttl = 0s;
+    SessionStore sessions(pool_, config_);
+    pool_->AcquireWriter()->exec(
+        "INSERT INTO session_(chat_id, state, expires_at) VALUES(5, 'old', 1)");
+
+    sessions.Set(1, {"start", ""});
+    EXPECT_FALSE(sessions.Get(1));
+    sessions.Snapshot();
+
+    EXPECT_EQ(Query("SELECT COUNT(*) FROM session_"), 0);
+    EXPECT_EQ(sessions.Stats().sessions, 0);
+}
+
+TEST_F(SessionStoreTest, Set_OverCapacity_EvictsOldestOfShard) {
+    config_.max_sessions = kSessionShards * 2;
+    SessionStore sessions(pool_, config_);
+
+    // Multiples of kSessionShards share one shard
+    sessions.Set(kSessionShards, {"start", ""});
+    sessions.Set(2 * kSessionShards, {"start", ""});
+    sessions.Set(kSessionShards, {"touched", ""});
+    sessions.Set(3 * kSessionShards, {"start", ""});
+
+    EXPECT_FALSE(sessions.Get(2 * kSessionShards));
+    EXPECT_EQ(sessions.Get(kSessionShards)->state, "touched");
+    EXPECT_TRUE(sessions.Get(3 * kSessionShards));
+    EXPECT_EQ(sessions.Stats().evictions, 1);
+}
+
+TEST_F(SessionStoreTest, Set_ManyThreads_KeepsEveryChat) {
+    SessionStore sessions(pool_, config_);
+    std::vector<std::thread> threads;
+    for (int64_t t = 0; t < 4; ++t) {
+        threads.emplace_back([&sessions, t] {
+            for (int64_t i = 0; i < 1000; ++i) {
+                int64_t chat_id = t * 1000 + i;
+                sessions.Set(chat_id, {std::to_string(chat_id), ""});
+                sessions.Get(chat_id);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(sessions.Stats().sessions, 4000);
+    EXPECT_EQ(sessions.Get(2345)->state, "2345");
+    EXPECT_EQ(sessions.Snapshot(), 4000);
+}
@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <gtest/gtest.h>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "tg/send_scheduler.hpp"
+
+using namespace bot;
+using namespace std::chrono_literals;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Behaves like the Bot API under flood control: a request over the global or the
+/// per-chat limit of the sliding window is refused with retry_after
+class FakeBotApi : public ISendTransport {
+public:
+    struct Call {
+        Clock::time_point at;
+        OutgoingMessage message;
+    };
+
+private:
+    std::mutex mutex_;
+    size_t global_limit_;
+    size_t chat_limit_;
+    Clock::duration window_;
+    std::deque<Clock::time_point> recent_;
+    std::map<int64_t, std::deque<Clock::time_point>> recent_per_chat_;
+    std::vector<Call> calls_;
+    std::vector<Clock::time_point> refused_;
+    std::deque<std::chrono::milliseconds> scripted_retry_after_;
+    int32_t next_message_id_ = 1;
+
+public:
+    FakeBotApi(size_t global_limit, size_t chat_limit, Clock::duration window)
+        : global_limit_(global_limit), chat_limit_(chat_limit), window_(window) {}
+
+    void RefuseNext(std::chrono::milliseconds retry_after) {
+        std::lock_guard lock(mutex_);
+        scripted_retry_after_.push_back(retry_after);
+    }
+
+    int32_t Send(const OutgoingMessage& message) override {
+        std::lock_guard lock(mutex_);
+        Clock::time_point now = Clock::now();
+        if (message.text == "fail") {
+            throw std::runtime_error("Bad Request: chat not found");
+        }
+        if (!scripted_retry_after_.empty()) {
+            auto retry_after = scripted_retry_after_.front();
+            scripted_retry_after_.pop_front();
+            refused_.push_back(now);
+            throw RetryAfterError(retry_after);
+        }
+
+        auto& chat = recent_per_chat_[message.chat_id];
+        for (auto* recent : {&recent_, &chat}) {
+            while (!recent->empty() && recent->front() <= now - window_) {
+                recent->pop_front();
+            }
+        }
+        if (recent_.size() >= global_limit_ || chat.size() >= chat_limit_) {
+            refused_.push_back(now);
+            throw RetryAfterError(std::chrono::duration_cast<std::chrono::milliseconds>(
+                window_));
+        }
+        recent_.push_back(now);
+        chat.push_back(now);
+        calls_.push_back({now, message});
+        return message.message_id != 0 ? message.message_id : next_message_id_++;
+    }
+
+    std::vector<Call> Calls() {
+        std::lock_guard lock(mutex_);
+        return calls_;
+    }
+
+    std::vector<Clock::time_point> Refused() {
+        std::lock_guard lock(mutex_);
+        return refused_;
+    }
+};
+
+OutgoingMessage Text(int64_t chat_id, std::string text) {
+    return OutgoingMessage{chat_id, std::move(text)};
+}
+
+OutgoingMessage Edit(int64_t chat_id, int32_t message_id, std::string text) {
+    return OutgoingMessage{chat_id, std::move(text), message_id};
+}
+
+}    // namespace
+
+TEST(TokenBucketTest, TryTake_Burst_RefillsAtRate) {
+    TokenBucket bucket(10, 2);
+    Clock::time_point now = Clock::now();
+
+    EXPECT_TRUE(bucket.TryTake(now));
+    EXPECT_TRUE(bucket.TryTake(now));
+    EXPECT_FALSE(bucket.TryTake(now));
+    EXPECT_EQ(bucket.ReadyAt(), now + 100ms);
+    EXPECT_FALSE(bucket.TryTake(now + 99ms));
+    EXPECT_TRUE(bucket.TryTake(now + 100ms));
+}
+
+TEST(TokenBucketTest, Block_NoTokensUntilDeadline) {
+    TokenBucket bucket(1000);
+    Clock::time_point now = Clock::now();
+
+    bucket.Block(now + 1s);
+
+    EXPECT_FALSE(bucket.TryTake(now + 999ms));
+    EXPECT_TRUE(bucket.TryTake(now + 1s));
+}
+
+TEST(SendSchedulerTest, ParseRetryAfter_BotApiDescription_ReturnsSeconds) {
+    EXPECT_EQ(ParseRetryAfter("Too Many Requests: retry after 35"), 35s);
+    EXPECT_EQ(ParseRetryAfter("Bad Request: chat not found"), std::nullopt);
+    EXPECT_EQ(ParseRetryAfter("Too Many Requests: retry after soon"), std::nullopt);
+}
+
+TEST(SendSchedulerTest, Enqueue_ManyChats_StaysUnderFloodLimits) {
+    const int kChats = 12;
+    const int kMessagesPerChat = 5;
+    // The fake allows 140/s globally and 40/s per chat, the scheduler asks for less
+    auto api = std::make_shared<FakeBotApi>(14, 4, 100ms);
+    SendScheduler scheduler(api, {.global_per_second = 100,
+                                  .chat_per_second = 20,
+                                  .group_per_minute = 1200,
+                                  .senders = 4});
+
+    std::vector<std::future<int32_t>> futures;
+    for (int i = 0; i < kMessagesPerChat; ++i) {
+        for (int chat = 1; chat <= kChats; ++chat) {
+            futures.push_back(scheduler.Enqueue(
+                Text(chat % 2 == 0 ? chat : -chat, std::to_string(i))));
+        }
+    }
+
+    Clock::time_point start = Clock::now();
+    scheduler.Start();
+    scheduler.Flush();
+    auto elapsed = Clock::now() - start;
+
+    for (auto& future : futures) {
+        EXPECT_GT(future.get(), 0);
+    }
+    EXPECT_TRUE(api->Refused().empty());
+    // 60 messages at 100/s leave within about 0.6s
+    EXPECT_GE(elapsed, 550ms);
+    EXPECT_LT(elapsed, 3s);
+
+    std::map<int64_t, std::vector<std::string>> per_chat;
+    for (const auto& call : api->Calls()) {
+        per_chat[call.message.chat_id].push_back(call.message.text);
+    }
+    ASSERT_EQ(per_chat.size(), kChats);
+    for (const auto& [chat, texts] : per_chat) {
+        EXPECT_EQ(texts, (std::vector<std::string>{"0", "1", "2", "3", "4"})) << chat;
+    }
+
+    auto stats = scheduler.Stats();
+    EXPECT_EQ(stats.sent, kChats * kMessagesPerChat);
+    EXPECT_EQ(stats.pending, 0);
+}
+
+TEST(SendSchedulerTest, Enqueue_InteractiveAfterBulk_IsSentFirst) {
+    auto api = std::make_shared<FakeBotApi>(100, 100, 1s);
+    SendScheduler scheduler(api, {.global_per_second = 200, .senders = 1});
+
+    for (int chat = 1; chat <= 10; ++chat) {
+        scheduler.Enqueue(Text(chat, "bulk"), SendPriority::kBulk);
+    }
+    scheduler.Enqueue(Text(11, "reply"), SendPriority::kInteractive);
+
+    scheduler.Start();
+    scheduler.Flush();
+
+    auto calls = api->Calls();
+    ASSERT_EQ(calls.size(), 11);
+    EXPECT_EQ(calls.front().message.text, "reply");
+}
+
+TEST(SendSchedulerTest, Enqueue_EditsOfOneMessage_AreCoalesced) {
+    auto api = std::make_shared<FakeBotApi>(100, 100, 1s);
+    SendScheduler scheduler(api, {.chat_per_second = 20});
+
+    auto sent = scheduler.Enqueue(Text(1, "progress"));
+    std::vector<std::future<int32_t>> edits;
+    for (int i = 1; i <= 5; ++i) {
+        edits.push_back(scheduler.Enqueue(Edit(1, 7, "progress " + std::to_string(i))));
+    }
+
+    scheduler.Start();
+    scheduler.Flush();
+
+    auto calls = api->Calls();
+    ASSERT_EQ(calls.size(), 2);
+    EXPECT_EQ(calls[0].message.text, "progress");
+    EXPECT_EQ(calls[1].message.text, "progress 5");
+    EXPECT_EQ(calls[1].message.message_id, 7);
+    EXPECT_GT(sent.get(), 0);
+    for (auto& edit : edits) {
+        EXPECT_EQ(edit.get(), 7);
+    }
+    EXPECT_EQ(scheduler.Stats().coalesced, 4);
+}
+
+TEST(SendSchedulerTest, Send_RetryAfter_PausesAndResendsInOrder) {
+    auto api = std::make_shared<FakeBotApi>(100, 100, 1s);
+    api->RefuseNext(150ms);
+    SendScheduler scheduler(
+        api, {.global_per_second = 200, .chat_per_second = 50, .senders = 1});
+
+    auto first = scheduler.Enqueue(Text(1, "first"));
+    auto second = scheduler.Enqueue(Text(2, "second"));
+    scheduler.Start();
+    scheduler.Flush();
+
+    EXPECT_GT(first.get(), 0);
+    EXPECT_GT(second.get(), 0);
+
+    auto refused = api->Refused();
+    auto calls = api->Calls();
+    ASSERT_EQ(refused.size(), 1);
+    ASSERT_EQ(calls.size(), 2);
+    EXPECT_EQ(calls[0].message.text, "first");
+    for (const auto& call : calls) {
+        EXPECT_GE(call.at - refused.front(), 150ms);
+    }
+    EXPECT_EQ(scheduler.Stats().retried, 1);
+}
+
+TEST(SendSchedulerTest, Send_TransportError_FailsOnlyThatMessage) {
+    auto api = std::make_shared<FakeBotApi>(100, 100, 1s);
+    SendScheduler scheduler(api, {.global_per_second = 200, .chat_per_second = 50});
+    scheduler.Start();
+
+    auto failed = scheduler.Enqueue(Text(1, "fail"));
+    auto sent = scheduler.Enqueue(Text(1, "ok"));
+    scheduler.Flush();
+
+    EXPECT_THROW(failed.get(), std::runtime_error);
+    EXPECT_GT(sent.get(), 0);
+    EXPECT_EQ(scheduler.Stats().failed, 1);
+}
+
+TEST(SendSchedulerTest, Stop_QueuedMessages_AreFailed) {
+    auto api = std::make_shared<FakeBotApi>(100, 100, 1s);
+    SendScheduler scheduler(api);
+
+    auto queued = scheduler.Enqueue(Text(1, "never sent"));
+    scheduler.Stop();
+    auto rejected = scheduler.Enqueue(Text(1, "too late"));
+
+    EXPECT_THROW(queued.get(), SendCancelledError);
+    EXPECT_THROW(rejected.get(), SendCancelledError);
+    EXPECT_TRUE(api->Calls().empty());
+}
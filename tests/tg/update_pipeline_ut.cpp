@@ -0,0 +1,228 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <gtest/gtest.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "tg/update_pipeline.hpp"
+
+using namespace bot;
+using namespace std::chrono_literals;
+
+namespace {
+
+TgBot::Update::Ptr MakeUpdate(int32_t update_id, int64_t chat_id) {
+    auto update = std::make_shared<TgBot::Update>();
+    update->updateId = update_id;
+    update->message = std::make_shared<TgBot::Message>();
+    update->message->chat = std::make_shared<TgBot::Chat>();
+    update->message->chat->id = chat_id;
+    return update;
+}
+
+/// Hands out prepared batches, then behaves like an idle long poll
+class FakeUpdateSource : public IUpdateSource {
+private:
+    std::mutex mutex_;
+    std::deque<std::vector<TgBot::Update::Ptr>> batches_;
+
+public:
+    void Push(std::vector<TgBot::Update::Ptr> batch) {
+        std::lock_guard lock(mutex_);
+        batches_.push_back(std::move(batch));
+    }
+
+    std::vector<TgBot::Update::Ptr> Poll() override {
+        {
+            std::lock_guard lock(mutex_);
+            if (!batches_.empty()) {
+                auto batch = std::move(batches_.front());
+                batches_.pop_front();
+                return batch;
+            }
+        }
+        std::this_thread::sleep_for(1ms);
+        return {};
+    }
+};
+
+}    // namespace
+
+TEST(UpdatePipelineTest, Run_ManyChats_KeepsPerChatOrder) {
+    const int kChats = 16;
+    const int kUpdatesPerChat = 50;
+
+    auto source = std::make_shared<FakeUpdateSource>();
+    for (int i = 0; i < kUpdatesPerChat; ++i) {
+        std::vector<TgBot::Update::Ptr> batch;
+        for (int chat = 0; chat < kChats; ++chat) {
+            batch.push_back(MakeUpdate(i, chat));
+        }
+        source->Push(std::move(batch));
+    }
+
+    std::mutex mutex;
+    std::map<int64_t, std::vector<int32_t>> seen;
+    std::atomic<int> in_flight_per_chat[kChats] = {};
+    std::atomic<bool> overlapped{false};
+
+    UpdatePipeline pipeline(
+        source,
+        [&](const TgBot::Update::Ptr& update) {
+            int64_t chat = GetChatId(update);
+            if (in_flight_per_chat[chat]++ != 0) {
+                overlapped = true;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(update->updateId % 7));
+            {
+                std::lock_guard lock(mutex);
+                seen[chat].push_back(update->updateId);
+            }
+            --in_flight_per_chat[chat];
+        },
+        PipelineConfig{4, 64});
+
+    std::thread reader([&] { pipeline.Run(); });
+    while (pipeline.Stats().processed < kChats * kUpdatesPerChat) {
+        std::this_thread::sleep_for(1ms);
+    }
+    pipeline.Stop();
+    reader.join();
+
+    EXPECT_FALSE(overlapped);
+    ASSERT_EQ(seen.size(), kChats);
+    for (const auto& [chat, ids] : seen) {
+        ASSERT_EQ(ids.size(), kUpdatesPerChat);
+        for (int i = 0; i < kUpdatesPerChat; ++i) {
+            EXPECT_EQ(ids[i], i) << "chat = " << chat;
+        }
+    }
+
+    PipelineStats stats = pipeline.Stats();
+    EXPECT_EQ(stats.failed, 0);
+    EXPECT_LE(stats.max_queue_depth, 64);
+    EXPECT_EQ(stats.queue_depth, 0);
+}
+
+TEST(UpdatePipelineTest, Submit_SlowChat_DoesNotStallOtherChats) {
+    std::atomic<bool> release_slow{false};
+    std::atomic<int> fast_done{0};
+
+    UpdatePipeline pipeline(
+        std::make_shared<FakeUpdateSource>(),
+        [&](const TgBot::Update::Ptr& update) {
+            if (GetChatId(update) == 1) {
+                while (!release_slow) {
+                    std::this_thread::sleep_for(1ms);
+                }
+            } else {
+                ++fast_done;
+            }
+        },
+        PipelineConfig{2, 16});
+    pipeline.Start();
+
+    ASSERT_TRUE(pipeline.Submit(MakeUpdate(1, 1)));
+    ASSERT_TRUE(pipeline.Submit(MakeUpdate(2, 1)));
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_TRUE(pipeline.Submit(MakeUpdate(10 + i, 2)));
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (fast_done < 5 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_EQ(fast_done, 5);
+    EXPECT_EQ(pipeline.Stats().queue_depth, 2);
+
+    release_slow = true;
+    pipeline.Stop();
+    EXPECT_EQ(pipeline.Stats().processed, 7);
+}
+
+TEST(UpdatePipelineTest, Submit_FullQueue_AppliesBackpressure) {
+    std::atomic<bool> release{false};
+
+    UpdatePipeline pipeline(
+        std::make_shared<FakeUpdateSource>(),
+        [&](const TgBot::Update::Ptr&) {
+            while (!release) {
+                std::this_thread::sleep_for(1ms);
+            }
+        },
+        PipelineConfig{1, 2});
+    pipeline.Start();
+
+    std::thread producer([&] {
+        for (int i = 0; i < 6; ++i) {
+            pipeline.Submit(MakeUpdate(i, i));
+        }
+    });
+
+    std::this_thread::sleep_for(20ms);
+    EXPECT_EQ(pipeline.Stats().queue_depth, 2);
+    EXPECT_GT(pipeline.Stats().backpressure_waits, 0);
+
+    release = true;
+    producer.join();
+    pipeline.Stop();
+
+    EXPECT_EQ(pipeline.Stats().processed, 6);
+    EXPECT_EQ(pipeline.Stats().max_queue_depth, 2);
+}
+
+TEST(UpdatePipelineTest, Submit_HandlerThrows_CountsFailure) {
+    UpdatePipeline pipeline(
+        std::make_shared<FakeUpdateSource>(),
+        [](const TgBot::Update::Ptr&) { throw std::runtime_error("boom"); },
+        PipelineConfig{1, 4});
+    pipeline.Start();
+
+    pipeline.Submit(MakeUpdate(1, 1));
+    pipeline.WaitIdle();
+
+    EXPECT_EQ(pipeline.Stats().failed, 1);
+    EXPECT_EQ(pipeline.Stats().processed, 1);
+}
+
+TEST(UpdatePipelineTest, Stop_ProducerWaitingForSlot_ReturnsAtOnce) {
+    std::atomic<bool> release{false};
+    UpdatePipeline pipeline(
+        std::make_shared<FakeUpdateSource>(),
+        [&](const TgBot::Update::Ptr&) {
+            while (!release) {
+                std::this_thread::sleep_for(1ms);
+            }
+        },
+        PipelineConfig{1, 1});
+    pipeline.Start();
+    ASSERT_TRUE(pipeline.Submit(MakeUpdate(1, 1)));
+
+    std::atomic<bool> is_returned{false};
+    bool is_submitted = true;
+    std::thread producer([&] {
+        is_submitted = pipeline.Submit(MakeUpdate(2, 2));
+        is_returned = true;
+    });
+    while (pipeline.Stats().backpressure_waits == 0) {
+        std::this_thread::sleep_for(1ms);
+    }
+    std::thread stopper([&] { pipeline.Stop(); });
+
+    // The handler is still busy, so no slot frees up to wake the producer
+    for (int i = 0; i < 2000 && !is_returned; ++i) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_TRUE(is_returned);
+
+    release = true;
+    producer.join();
+    stopper.join();
+    EXPECT_FALSE(is_submitted);
+    EXPECT_EQ(pipeline.Stats().processed, 1);
+}
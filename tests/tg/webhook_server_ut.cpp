@@ -0,0 +1,158 @@
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "tg/webhook_server.hpp"
+
+using namespace bot;
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+namespace {
+
+constexpr const char* kSecret = "s3cret";
+
+/// Blocking HTTP/1.1 client holding one keep-alive connection
+class Client {
+private:
+    asio::io_context io_context_;
+    beast::tcp_stream stream_{io_context_};
+    beast::flat_buffer buffer_;
+
+public:
+    explicit Client(uint16_t port) {
+        stream_.connect({asio::ip::make_address("127.0.0.1"), port});
+    }
+
+    http::response<http::string_body> Send(http::verb method, const std::string& target,
+                                           const std::string& body,
+                                           const std::string& secret = kSecret) {
+        http::request<http::string_body> request{method, target, 11};
+        request.set(http::field::host, "127.0.0.1");
+        request.set(http::field::content_type, "application/json");
+        if (!secret.empty()) {
+            request.set("X-Telegram-Bot-Api-Secret-Token", secret);
+        }
+        request.body() = body;
+        request.prepare_payload();
+        http::write(stream_, request);
+
+        http::response<http::string_body> response;
+        http::read(stream_, buffer_, response);
+        return response;
+    }
+
+    http::response<http::string_body> Post(const std::string& body,
+                                           const std::string& secret = kSecret) {
+        return Send(http::verb::post, "/telegram/webhook", body, secret);
+    }
+};
+
+}    // namespace
+
+class WebhookServerTest : public ::testing::Test {
+protected:
+    std::mutex mutex_;
+    std::vector<int32_t> received_;
+    bool is_accepting_ = true;
+    std::unique_ptr<WebhookServer> server_;
+
+    void SetUp() override {
+        WebhookConfig config;
+        config.address = "127.0.0.1";
+        config.port = 0;
+        config.secret_token = kSecret;
+        config.threads = 2;
+        auto sink = [this](TgBot::Update::Ptr update) {
+            std::lock_guard lock(mutex_);
+            if (!is_accepting_) {
+                return false;
+            }
+            received_.push_back(update->updateId);
+            return true;
+        };
+        server_ = std::make_unique<WebhookServer>(config, sink);
+        server_->Start();
+    }
+
+    std::vector<int32_t> Received() {
+        std::lock_guard lock(mutex_);
+        return received_;
+    }
+};
+
+TEST(WebhookServerConfigTest, Construct_WithoutSecret_Throws) {
+    EXPECT_THROW(WebhookServer({}, [](TgBot::Update::Ptr) { return true; }),
+                 std::invalid_argument);
+}
+
+TEST_F(WebhookServerTest, Post_ValidSecret_UpdateReachesSink) {
+    Client client(server_->Port());
+
+    EXPECT_EQ(client.Post(R"({"update_id": 7})").result(), http::status::ok);
+    EXPECT_EQ(Received(), std::vector<int32_t>{7});
+    EXPECT_EQ(server_->Stats().accepted, 1);
+}
+
+TEST_F(WebhookServerTest, Post_KeepAlive_ServesRequestsOnOneConnection) {
+    Client client(server_->Port());
+
+    for (int32_t id = 1; id <= 3; ++id) {
+        auto response = client.Post(R"({"update_id": )" + std::to_string(id) + "}");
+        EXPECT_EQ(response.result(), http::status::ok);
+        EXPECT_TRUE(response.keep_alive());
+    }
+    EXPECT_EQ(Received(), (std::vector<int32_t>{1, 2, 3}));
+}
+
+TEST_F(WebhookServerTest, Post_WrongOrMissingSecret_Unauthorized) {
+    Client client(server_->Port());
+
+    EXPECT_EQ(client.Post(R"({"update_id": 1})", "guess").result(),
+              http::status::unauthorized);
+    EXPECT_EQ(client.Post(R"({"update_id": 1})", "").result(),
+              http::status::unauthorized);
+    EXPECT_TRUE(Received().empty());
+    EXPECT_EQ(server_->Stats().unauthorized, 2);
+}
+
+TEST_F(WebhookServerTest, Post_MalformedJson_BadRequest) {
+    Client client(server_->Port());
+
+    EXPECT_EQ(client.Post("{not json").result(), http::status::bad_request);
+    EXPECT_EQ(server_->Stats().bad_requests, 1);
+    EXPECT_EQ(client.Post(R"({"update_id": 2})").result(), http::status::ok);
+}
+
+TEST_F(WebhookServerTest, Send_WrongMethodOrPath_Rejected) {
+    Client client(server_->Port());
+
+    EXPECT_EQ(client.Send(http::verb::get, "/telegram/webhook", "").result(),
+              http::status::method_not_allowed);
+    EXPECT_EQ(client.Send(http::verb::post, "/other", R"({"update_id": 1})").result(),
+              http::status::not_found);
+    EXPECT_TRUE(Received().empty());
+}
+
+TEST_F(WebhookServerTest, Post_SinkRefuses_ServiceUnavailable) {
+    {
+        std::lock_guard lock(mutex_);
+        is_accepting_ = false;
+    }
+    Client client(server_->Port());
+
+    EXPECT_EQ(client.Post(R"({"update_id": 1})").result(),
+              http::status::service_unavailable);
+    EXPECT_EQ(server_->Stats().overloaded, 1);
+}
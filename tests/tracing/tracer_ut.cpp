@@ -0,0 +1,166 @@
+#include <chrono>
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tracing/tracer.hpp"
+
+using namespace bot;
+
+namespace {
+
+TracerConfig AlwaysSample(size_t buffer_spans = 128) {
+    return TracerConfig{1.0, buffer_spans};
+}
+
+}    // namespace
+
+TEST(TracerTest, ChildSpans_ShareTraceAndNest) {
+    Tracer tracer(AlwaysSample());
+    {
+        Span root = Span::Root("update", tracer);
+        Span child("sheets", tracer);
+        Span grandchild("sqlite", tracer);
+        grandchild.SetDetail("SELECT 1");
+    }
+
+    std::vector<SpanRecord> spans = tracer.Collect();
+    ASSERT_EQ(spans.size(), 3U);
+    EXPECT_EQ(std::string(spans[0].name), "update");
+    EXPECT_EQ(spans[0].parent_id, 0U);
+    EXPECT_EQ(spans[1].parent_id, spans[0].span_id);
+    EXPECT_EQ(spans[2].parent_id, spans[1].span_id);
+    EXPECT_EQ(spans[2].detail, "SELECT 1");
+    for (const auto& span : spans) {
+        EXPECT_EQ(span.trace_id, spans[0].trace_id);
+    }
+    EXPECT_GE(spans[0].duration_ns, spans[1].duration_ns);
+    EXPECT_FALSE(CurrentTraceContext().IsSampled());
+}
+
+TEST(TracerTest, NoTrace_SpansAreNotRecorded) {
+    Tracer tracer(TracerConfig{0.0, 128});
+    {
+        Span root = Span::Root("update", tracer);
+        Span child("sheets", tracer);
+        EXPECT_FALSE(root.IsRecording());
+        EXPECT_FALSE(child.IsRecording());
+    }
+    {
+        Span orphan("sqlite", tracer);
+        EXPECT_FALSE(orphan.IsRecording());
+    }
+
+    EXPECT_TRUE(tracer.Collect().empty());
+}
+
+TEST(TracerTest, SampleRate_RecordsAboutThatShare) {
+    Tracer tracer(TracerConfig{0.25, 1 << 14});
+    for (int i = 0; i < 8000; ++i) {
+        Span root = Span::Root("update", tracer);
+    }
+
+    size_t recorded = tracer.Collect().size();
+    EXPECT_GT(recorded, 1600U);
+    EXPECT_LT(recorded, 2400U);
+}
+
+TEST(TracerTest, ScopedContext_CarriesTraceIntoThread) {
+    Tracer tracer(AlwaysSample());
+    {
+        Span root = Span::Root("batch", tracer);
+        TraceContext context = CurrentTraceContext();
+        std::jthread worker([&] {
+            ScopedTraceContext scope(context);
+            Span span("request", tracer);
+            RecordFinishedSpan("sqlite", std::chrono::microseconds(5), "SELECT 1",
+                               tracer);
+        });
+    }
+
+    std::vector<SpanRecord> spans = tracer.Collect();
+    ASSERT_EQ(spans.size(), 3U);
+    for (const auto& span : spans) {
+        EXPECT_EQ(span.trace_id, spans[0].trace_id);
+    }
+    EXPECT_NE(spans[0].thread_id, spans[1].thread_id);
+}
+
+TEST(TracerTest, FullBuffer_KeepsNewestSpans) {
+    Tracer tracer(AlwaysSample(4));
+    for (int i = 0; i < 10; ++i) {
+        Span root = Span::Root("update", tracer);
+        root.SetDetail(std::to_string(i));
+    }
+
+    std::vector<SpanRecord> spans = tracer.Collect();
+    ASSERT_EQ(spans.size(), 4U);
+    EXPECT_EQ(spans.front().detail, "6");
+    EXPECT_EQ(spans.back().detail, "9");
+}
+
+TEST(TracerTest, ExitedThreads_RingIsReusedNotGrown) {
+    Tracer tracer(AlwaysSample(4));
+    for (int i = 0; i < 10; ++i) {
+        std::jthread([&tracer, i] {
+            Span root = Span::Root("batch", tracer);
+            root.SetDetail(std::to_string(i));
+        }).join();
+    }
+
+    std::vector<SpanRecord> spans = tracer.Collect();
+    ASSERT_EQ(spans.size(), 4U);
+    EXPECT_EQ(spans.front().detail, "6");
+    EXPECT_EQ(spans.back().detail, "9");
+    EXPECT_NE(spans.front().thread_id, spans.back().thread_id);
+}
+
+TEST(TracerTest, Collect_OrdersBySequenceNotClock) {
+    Tracer tracer(AlwaysSample());
+    {
+        Span root = Span::Root("update", tracer);
+        // Same start_ns as the root on a coarse clock, it must still sort after it
+        RecordFinishedSpan("sqlite", std::chrono::nanoseconds(0), "", tracer);
+    }
+
+    std::vector<SpanRecord> spans = tracer.Collect();
+    ASSERT_EQ(spans.size(), 2U);
+    EXPECT_EQ(std::string(spans[0].name), "update");
+    EXPECT_LT(spans[0].sequence, spans[1].sequence);
+}
+
+TEST(TracerTest, ExportChromeJson_CompleteEvents) {
+    Tracer tracer(AlwaysSample());
+    {
+        Span root = Span::Root("update", tracer);
+        Span child("sqlite", tracer);
+        child.SetDetail("SELECT 1");
+    }
+
+    auto json = nlohmann::json::parse(tracer.ExportChromeJson());
+    const auto& events = json.at("traceEvents");
+    ASSERT_EQ(events.size(), 2U);
+    EXPECT_EQ(events[0].at("ph"), "X");
+    EXPECT_EQ(events[0].at("name"), "update");
+    EXPECT_EQ(events[1].at("args").at("detail"), "SELECT 1");
+    EXPECT_EQ(events[1].at("args").at("parent_id"), events[0].at("args").at("span_id"));
+}
+
+TEST(TracerTest, ExportOtlpJson_ResourceSpans) {
+    Tracer tracer(AlwaysSample());
+    {
+        Span root = Span::Root("update", tracer);
+        Span child("sqlite", tracer);
+    }
+
+    auto json = nlohmann::json::parse(tracer.ExportOtlpJson());
+    const auto& spans = json.at("resourceSpans")[0].at("scopeSpans")[0].at("spans");
+    ASSERT_EQ(spans.size(), 2U);
+    EXPECT_EQ(spans[0].at("traceId").get<std::string>().size(), 32U);
+    EXPECT_EQ(spans[0].at("spanId").get<std::string>().size(), 16U);
+    EXPECT_FALSE(spans[0].contains("parentSpanId"));
+    EXPECT_EQ(spans[1].at("parentSpanId"), spans[0].at("spanId"));
+}
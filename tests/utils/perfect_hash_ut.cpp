@@ -0,0 +1,56 @@
+#include <array>
+#include <format>
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utils/perfect_hash.hpp"
+
+using namespace bot;
+
+namespace {
+
+constexpr PerfectHashMap<int, 4> kCommands({{
+    {"/start", 1},
+    {"/help", 2},
+    {"/stop", 3},
+    {"/settings", 4},
+}});
+
+static_assert(*kCommands.Find("/help") == 2);
+static_assert(kCommands.Find("/unknown") == nullptr);
+
+}    // namespace
+
+TEST(PerfectHashMapTest, Find_EveryKey_ReturnsItsValue) {
+    EXPECT_EQ(*kCommands.Find("/start"), 1);
+    EXPECT_EQ(*kCommands.Find("/stop"), 3);
+    EXPECT_EQ(*kCommands.Find("/settings"), 4);
+    EXPECT_FALSE(kCommands.Contains("/star"));
+    EXPECT_FALSE(kCommands.Contains(""));
+}
+
+TEST(PerfectHashMapTest, Find_ManyKeys_NoCollisions) {
+    std::vector<std::string> keys;
+    for (int i = 0; i < 200; ++i) {
+        keys.push_back(std::format("migrations/{:03}_step.sql", i));
+    }
+    std::array<std::pair<std::string_view, int>, 200> entries;
+    for (int i = 0; i < 200; ++i) {
+        entries[i] = {keys[i], i};
+    }
+
+    PerfectHashMap<int, 200> map(entries);
+
+    for (int i = 0; i < 200; ++i) {
+        ASSERT_NE(map.Find(keys[i]), nullptr);
+        EXPECT_EQ(*map.Find(keys[i]), i);
+    }
+    EXPECT_EQ(map.Find("migrations/200_step.sql"), nullptr);
+}
+
+TEST(PerfectHashMapTest, Empty_FindsNothing) {
+    constexpr PerfectHashMap<int, 0> kEmpty({});
+    EXPECT_EQ(kEmpty.Find("anything"), nullptr);
+}
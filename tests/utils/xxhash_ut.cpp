@@ -0,0 +1,20 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include "utils/xxhash.hpp"
+
+using namespace bot;
+
+TEST(XxHash64Test, MatchesReferenceVectors) {
+    EXPECT_EQ(XxHash64(""), 0xEF46DB3751D8E999ULL);
+    EXPECT_EQ(XxHash64("abc"), 0x44BC2CF5AD770999ULL);
+}
+
+TEST(XxHash64Test, LongInput_DependsOnEveryByteAndSeed) {
+    std::string data(1000, 'x');
+    uint64_t hash = XxHash64(data);
+
+    data[517] = 'y';
+    EXPECT_NE(XxHash64(data), hash);
+    EXPECT_NE(XxHash64(data, 1), XxHash64(data));
+}